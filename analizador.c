@@ -0,0 +1,338 @@
+/*
+ analizador.c - Análisis offline de trazas de ejecución (opción -t del emulador)
+
+ Lee trazas en cualquiera de los dos formatos (con -z se salta directamente al
+ fotograma clave más cercano) y en una sola pasada calcula:
+ - Mezcla de instrucciones: cuántas veces se ejecutó cada una, y los ciclos
+   emulados según el modelo de ciclos de cpu.h
+ - Mapa de calor de memoria: accesos al dato (ST, LD, ADD y la ALU) por
+   dirección efectiva, y cada palabra de los bloques de MOVE/FILL
+ - Comportamiento de los saltos: por cada BR/BZ/JSR, veces tomado y aciertos
+   de un predictor de 1 bit (repetir lo que hizo la última vez); por cada
+   RTS, aciertos de una pila de direcciones de vuelta (RAS) de
+   PROFUNDIDAD_RAS entradas, a la que cada JSR apila su dirección de vuelta
+
+ Con un mapa de fuente (-f, ensamblador -g) las instrucciones y direcciones
+ se muestran como "suma_v1.asm:3 ADD ACC,[7]".
+
+ Compilar (desde la raíz del repositorio):
+   gcc -O2 analizador.c cpu.c traza.c grabacion.c historial.c puntos.c mapa.c -o analizador -pthread
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "cpu.h"
+#include "mapa.h"
+
+#define NUM_OPCODES 32
+#define NUM_EXTENDIDAS 4
+#define PALABRAS_FILA 64          // Direcciones por fila del mapa de calor
+#define TOP_DIRECCIONES 10
+#define PROFUNDIDAD_RAS 16        // Entradas de la pila de direcciones de vuelta
+
+
+// ESTADÍSTICAS
+// ============
+
+typedef struct {
+    uint64_t ejecutados;
+    uint64_t tomados;
+    uint64_t aciertos;            // Predictor de 1 bit (RTS: la RAS)
+    uint16_t raw;                 // Palabra de la instrucción (BR, BZ, JSR o RTS)
+    uint8_t ultimo;               // Último resultado (1 = tomado)
+    uint8_t visto;
+} EstadisticaSalto;
+
+typedef struct {
+    uint64_t total;
+    uint64_t ciclos;
+    uint8_t ciclos_latencia[32];      // Las de la CPU que generó la traza (-c)
+    uint64_t opcodes[NUM_OPCODES];
+    uint64_t extendidas[NUM_EXTENDIDAS];
+    uint64_t accesos[MEM_SIZE];
+    EstadisticaSalto saltos[MEM_SIZE];
+    uint64_t retornos, aciertos_ras;
+    uint16_t ras[PROFUNDIDAD_RAS];    // Circular: al llenarse se pisa la entrada más antigua
+    unsigned ras_cima, ras_llenas;
+} Analisis;
+
+/*
+ Pila de direcciones de vuelta, como la de un procesador: JSR apila la
+ dirección de la instrucción siguiente y RTS predice que vuelve a la cima.
+ Si se vacía (más RTS que JSR, o una recursión más profunda que la pila) la
+ predicción falla.
+ */
+static void ras_apilar(Analisis *a, uint16_t vuelta)
+{
+    a->ras[a->ras_cima++ % PROFUNDIDAD_RAS] = vuelta;
+    if (a->ras_llenas < PROFUNDIDAD_RAS) a->ras_llenas++;
+}
+
+static int32_t ras_desapilar(Analisis *a)
+{
+    if (!a->ras_llenas) return -1;
+    a->ras_llenas--;
+    return a->ras[--a->ras_cima % PROFUNDIDAD_RAS];
+}
+
+static const char *nombre_instruccion(uint16_t raw)
+{
+    uint8_t opcode = (raw >> OPCODE_SHIFT) & OPCODE_MASK;
+    if (opcode != 7) return instruction_set[opcode].name;
+    return extended_set[(raw >> EXT_SHIFT) & EXT_MASK].name;
+}
+
+/*
+ Acumula un registro. siguiente_pc es el PC del registro que le sigue
+ (o -1 si es el último), para saber si un salto se tomó.
+ */
+static void acumular(Analisis *a, const RegistroTraza *r, int32_t siguiente_pc)
+{
+    uint8_t opcode = (r->raw >> OPCODE_SHIFT) & OPCODE_MASK;
+    uint16_t ea = r->eff_addr & (MEM_SIZE - 1);
+
+    a->total++;
+    a->ciclos += ciclos_instruccion(a->ciclos_latencia, r->raw) + ciclos_extra(r->raw, r->acc, r->x);
+    a->opcodes[opcode]++;
+    if (opcode == 7) a->extendidas[(r->raw >> EXT_SHIFT) & EXT_MASK]++;
+    if (instruccion_lee_dato(r->raw) || instruccion_escribe_dato(r->raw)) a->accesos[ea]++;
+    if (instruccion_bloque(r->raw)) {
+        // ACC y X no cambian al ejecutarlos: el registro guarda los de la instrucción
+        uint8_t reg = (r->raw >> 8) & 1;
+        unsigned n = bloque_palabras(reg, r->acc, r->x);
+        uint16_t origen = reg ? r->acc : r->x;
+        for (unsigned i = 0; i < n; i++) {
+            a->accesos[(ea + i) & (MEM_SIZE - 1)]++;
+            if (opcode == 19) a->accesos[(origen + i) & (MEM_SIZE - 1)]++;
+        }
+    }
+
+    uint16_t siguiente = (r->pc + palabras_instruccion(r->raw)) & (MEM_SIZE - 1);
+    int llamada = opcode == 15 && instruccion_apila(r->raw);
+    int retorno = opcode == 7 && instruccion_desapila(r->raw);
+    int32_t prediccion = -1;
+    if (llamada) ras_apilar(a, siguiente);
+    if (retorno) prediccion = ras_desapilar(a);
+
+    if ((opcode == 3 || opcode == 4 || llamada || retorno) && siguiente_pc >= 0) {
+        EstadisticaSalto *s = &a->saltos[r->pc & (MEM_SIZE - 1)];
+        uint8_t tomado = siguiente_pc != siguiente;
+        s->ejecutados++;
+        s->tomados += tomado;
+        if (retorno) {
+            uint8_t acierto = prediccion == siguiente_pc;
+            s->aciertos += acierto;
+            a->retornos++;
+            a->aciertos_ras += acierto;
+        } else {
+            s->aciertos += s->visto && s->ultimo == tomado;
+        }
+        s->ultimo = tomado;
+        s->visto = 1;
+        s->raw = r->raw;
+    }
+}
+
+
+// INFORMES
+// ========
+
+static void informe_mezcla(const Analisis *a)
+{
+    printf("MEZCLA DE INSTRUCCIONES (%llu)\n", (unsigned long long)a->total);
+    for (int op = 0; op < NUM_OPCODES; op++) {
+        if (op == 7) {
+            for (int ext = 0; ext < NUM_EXTENDIDAS; ext++) {
+                if (!a->extendidas[ext]) continue;
+                printf("  %-6s %12llu  %6.2f%%\n", extended_set[ext].name,
+                       (unsigned long long)a->extendidas[ext],
+                       100.0 * a->extendidas[ext] / a->total);
+            }
+        } else if (a->opcodes[op]) {
+            printf("  %-6s %12llu  %6.2f%%\n", instruction_set[op].name,
+                   (unsigned long long)a->opcodes[op], 100.0 * a->opcodes[op] / a->total);
+        }
+    }
+    if (a->total) {
+        printf("  Ciclos: %llu (%.2f por instrucción)\n", (unsigned long long)a->ciclos,
+               (double)a->ciclos / a->total);
+    }
+}
+
+static void informe_memoria(const Analisis *a, const MapaFuente *mapa)
+{
+    static const char escala[] = " .:-=+*#%@";
+    uint64_t max = 0;
+    for (int i = 0; i < MEM_SIZE; i++) {
+        if (a->accesos[i] > max) max = a->accesos[i];
+    }
+    printf("\nMAPA DE CALOR DE MEMORIA (accesos al dato, %d palabras por fila, '@' = %llu)\n",
+           PALABRAS_FILA, (unsigned long long)max);
+    if (!max) return;
+
+    // Solo las filas con algún acceso; escala lineal en 10 niveles
+    for (int fila = 0; fila < MEM_SIZE; fila += PALABRAS_FILA) {
+        int usada = 0;
+        for (int i = fila; i < fila + PALABRAS_FILA; i++) usada |= a->accesos[i] != 0;
+        if (!usada) continue;
+
+        printf("  %04d |", fila);
+        for (int i = fila; i < fila + PALABRAS_FILA; i++) {
+            uint64_t n = a->accesos[i];
+            putchar(n ? escala[1 + (n * 8 + max - 1) / max] : escala[0]);
+        }
+        printf("|\n");
+    }
+
+    printf("  Direcciones más accedidas:\n");
+    static uint8_t elegida[MEM_SIZE];
+    memset(elegida, 0, sizeof(elegida));
+    for (int k = 0; k < TOP_DIRECCIONES; k++) {
+        int mejor = -1;
+        for (int i = 0; i < MEM_SIZE; i++) {
+            if (!elegida[i] && a->accesos[i] && (mejor < 0 || a->accesos[i] > a->accesos[mejor])) {
+                mejor = i;
+            }
+        }
+        if (mejor < 0) break;
+        elegida[mejor] = 1;
+        const char *ubicacion = mapa_ubicacion(mapa, (uint16_t)mejor);
+        printf("    mem[%d]: %llu%s%s\n", mejor, (unsigned long long)a->accesos[mejor],
+               ubicacion ? "  " : "", ubicacion ? ubicacion : "");
+    }
+}
+
+static void informe_saltos(const Analisis *a, const MapaFuente *mapa)
+{
+    uint64_t total = 0, aciertos = 0;
+    printf("\nSALTOS (predictor de 1 bit; RTS: pila de direcciones de vuelta de %d entradas)\n",
+           PROFUNDIDAD_RAS);
+    printf("  %-6s %-4s %12s %9s %9s\n", "pc", "inst", "ejecutados", "tomados", "aciertos");
+    for (int pc = 0; pc < MEM_SIZE; pc++) {
+        const EstadisticaSalto *s = &a->saltos[pc];
+        if (!s->ejecutados) continue;
+        total += s->ejecutados;
+        aciertos += s->aciertos;
+        const char *ubicacion = mapa_ubicacion(mapa, (uint16_t)pc);
+        printf("  %-6d %-4s %12llu %8.2f%% %8.2f%%%s%s\n", pc, nombre_instruccion(s->raw),
+               (unsigned long long)s->ejecutados, 100.0 * s->tomados / s->ejecutados,
+               100.0 * s->aciertos / s->ejecutados, ubicacion ? "  " : "", ubicacion ? ubicacion : "");
+    }
+    if (total) {
+        printf("  Total: %llu saltos, %.2f%% de aciertos\n",
+               (unsigned long long)total, 100.0 * aciertos / total);
+    }
+    if (a->retornos) {
+        printf("  Retornos: %llu, %.2f%% de aciertos de la pila de direcciones de vuelta\n",
+               (unsigned long long)a->retornos, 100.0 * a->aciertos_ras / a->retornos);
+    }
+}
+
+static void mostrar_registro(uint64_t indice, const RegistroTraza *r, const MapaFuente *mapa)
+{
+    const char *ubicacion = mapa_ubicacion(mapa, r->pc);
+    if (ubicacion) {
+        printf("%10llu  pc=%-4d %-28s ea=%-4d acc=%-5d x=%-5d z=%d\n",
+               (unsigned long long)indice, r->pc, ubicacion, r->eff_addr, r->acc, r->x,
+               (r->flags & TRAZA_FLAG_Z) != 0);
+        return;
+    }
+    printf("%10llu  pc=%-4d 0x%04X %-5s ea=%-4d acc=%-5d x=%-5d z=%d\n",
+           (unsigned long long)indice, r->pc, r->raw, nombre_instruccion(r->raw),
+           r->eff_addr, r->acc, r->x, (r->flags & TRAZA_FLAG_Z) != 0);
+}
+
+
+// PROGRAMA PRINCIPAL
+// ==================
+
+static void uso(const char *prog)
+{
+    printf("Uso: %s [opciones] <traza>\n", prog);
+    printf("  -d, --desde <n>     Empieza en la instrucción n (salta por el índice)\n");
+    printf("  -n, --cuenta <n>    Analiza como mucho n instrucciones\n");
+    printf("  -m, --mostrar <n>   Lista las primeras n instrucciones analizadas\n");
+    printf("  -f, --fuente <mapa> Mapa de fuente (ensamblador -g) para mostrar las líneas del .asm\n");
+    printf("  -c, --ciclos <mul=N,div=N,mod=N>  Latencia de MUL/DIV/MOD (como en el emulador)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option opciones[] = {
+        {"desde", required_argument, NULL, 'd'},
+        {"cuenta", required_argument, NULL, 'n'},
+        {"mostrar", required_argument, NULL, 'm'},
+        {"fuente", required_argument, NULL, 'f'},
+        {"ciclos", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+
+    static Analisis analisis;
+    memcpy(analisis.ciclos_latencia, ciclos_latencia_defecto, sizeof(analisis.ciclos_latencia));
+
+    uint64_t desde = 0, cuenta = UINT64_MAX, mostrar = 0;
+    MapaFuente *mapa = NULL;
+    int c;
+    while ((c = getopt_long(argc, argv, "d:n:m:f:c:", opciones, NULL)) != -1) {
+        switch (c) {
+        case 'd': desde = strtoull(optarg, NULL, 0); break;
+        case 'n': cuenta = strtoull(optarg, NULL, 0); break;
+        case 'm': mostrar = strtoull(optarg, NULL, 0); break;
+        case 'f':
+            mapa_destruir(mapa);
+            if (!(mapa = mapa_cargar(optarg))) return 1;
+            break;
+        case 'c':
+            if (ciclos_configurar(analisis.ciclos_latencia, optarg) < 0) {
+                printf("Error: latencias no válidas '%s' (p. ej. mul=4,div=12)\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            uso(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        uso(argv[0]);
+        return 1;
+    }
+
+    LectorTraza *lector = lector_abrir(argv[optind]);
+    if (!lector) return 1;
+    if (lector_saltar(lector, desde) < 0) {
+        printf("Error: la traza no llega a la instrucción %llu\n", (unsigned long long)desde);
+        lector_cerrar(lector);
+        return 1;
+    }
+
+    RegistroTraza actual, siguiente;
+    uint64_t leidos = 0;
+    int estado = lector_siguiente(lector, &actual);
+
+    // Un registro de adelanto: el PC siguiente dice si un salto se tomó
+    while (estado > 0 && leidos < cuenta) {
+        if (leidos < mostrar) mostrar_registro(desde + leidos, &actual, mapa);
+        leidos++;
+        estado = lector_siguiente(lector, &siguiente);
+        acumular(&analisis, &actual, estado > 0 ? siguiente.pc : -1);
+        actual = siguiente;
+    }
+    if (estado < 0) {
+        printf("Error: traza corrupta tras la instrucción %llu\n",
+               (unsigned long long)(desde + leidos));
+    }
+    if (mostrar) printf("\n");
+
+    informe_mezcla(&analisis);
+    informe_memoria(&analisis, mapa);
+    informe_saltos(&analisis, mapa);
+
+    lector_cerrar(lector);
+    mapa_destruir(mapa);
+    return estado < 0;
+}
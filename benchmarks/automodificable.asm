@@ -0,0 +1,49 @@
+; Benchmark: código automodificable
+; La instrucción en mem[6] ("ADD X,[40]") se reescribe en cada vuelta para
+; apuntar al siguiente elemento de mem[40..55]. 6500 repeticiones.
+
+LD ACC,[24]        // 0: repetición: restaurar la instrucción parcheada
+ST ACC,[6]         // 1
+LD ACC,[25]        // 2: contador = N
+ST ACC,[26]        // 3
+CLR X              // 4: suma = 0
+LD ACC,[6]         // 5: bucle: ACC = instrucción parcheada
+ADD X,[40]         // 6: (parcheada) X += mem[40 + i]
+ADD ACC,[27]       // 7: siguiente dirección
+ST ACC,[6]         // 8
+LD ACC,[26]        // 9
+DEC ACC            // 10
+BZ [14]            // 11
+ST ACC,[26]        // 12
+BR [5]             // 13
+ST X,[28]          // 14: guardar resultado
+LD ACC,[29]        // 15: repeticiones restantes
+DEC ACC            // 16
+BZ [20]            // 17
+ST ACC,[29]        // 18
+BR [0]             // 19
+HALT               // 20
+
+mem[24] = 0x428    ; Plantilla: ADD X,[40]
+mem[25] = 16       ; N (elementos)
+mem[26] = 0        ; Contador
+mem[27] = 1        ; Constante 1
+mem[28] = 0        ; Resultado
+mem[29] = 6500     ; Repeticiones
+
+mem[40] = 1
+mem[41] = 4
+mem[42] = 7
+mem[43] = 10
+mem[44] = 13
+mem[45] = 16
+mem[46] = 19
+mem[47] = 22
+mem[48] = 25
+mem[49] = 28
+mem[50] = 31
+mem[51] = 34
+mem[52] = 37
+mem[53] = 40
+mem[54] = 43
+mem[55] = 46
@@ -0,0 +1,254 @@
+# bench.py - Harness de benchmarks del emulador
+#
+# Ensambla cada carga de trabajo de benchmarks/*.asm, la ejecuta N veces con
+# cada motor del emulador (./emulador -l) y escribe en JSON la mediana de MIPS,
+# las instrucciones ejecutadas y el tiempo, junto con su varianza.
+#
+# Cada medición se añade también al historial (benchmarks/historial.jsonl),
+# una línea JSON por commit, motor y carga con las muestras en bruto.
+# --comparar busca regresiones entre dos commits del historial con
+# intervalos de confianza bootstrap.
+#
+# Uso:
+#   python benchmarks/bench.py [--runs N] [--motores debug,batch] [cargas...]
+#   python benchmarks/bench.py --comparar <commit_base> [--con <commit_nuevo>]
+import argparse
+import json
+import os
+import platform
+import random
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+DIR_BENCH = os.path.dirname(os.path.abspath(__file__))
+DIR_RAIZ = os.path.dirname(DIR_BENCH)
+sys.path.insert(0, DIR_RAIZ)
+
+from ensamblador import ensamblar_archivo  # noqa: E402
+
+HISTORIAL = os.path.join(DIR_BENCH, "historial.jsonl")
+
+# Línea que escribe el emulador en stderr con -s (ciclos solo si hay contadores)
+PATRON_STATS = re.compile(r'motor=(\S+) instrucciones=(\d+) tiempo_ns=(\d+) mips=([\d.]+)'
+                          r'(?: ciclos=(\d+))?')
+
+# Métricas comparadas: nombre -> True si un valor mayor es mejor
+METRICAS = {"mips": True, "ciclos_instr": False}
+
+
+def listar_motores(emulador):
+    salida = subprocess.run([emulador, "-l"], capture_output=True, text=True, check=True)
+    return salida.stdout.split()
+
+
+def listar_cargas():
+    return sorted(os.path.splitext(f)[0] for f in os.listdir(DIR_BENCH) if f.endswith(".asm"))
+
+
+def ensamblar(carga, dir_salida):
+    archivo_bin = os.path.join(dir_salida, carga + ".bin")
+    with open(archivo_bin, "w") as out:
+        out.write(ensamblar_archivo(os.path.join(DIR_BENCH, carga + ".asm")) + "\n")
+    return archivo_bin
+
+
+def ejecutar(emulador, motor, archivo_bin):
+    """Una ejecución; stdin vacío para que la pausa del motor debug no bloquee."""
+    proc = subprocess.run([emulador, "-e", motor, "-s", archivo_bin],
+                          stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                          stderr=subprocess.PIPE, text=True)
+    match = PATRON_STATS.search(proc.stderr)
+    if proc.returncode != 0 or not match:
+        raise RuntimeError(f"{archivo_bin} ({motor}) falló: {proc.stderr.strip()}")
+    muestra = {"instrucciones": int(match.group(2)), "tiempo_ns": int(match.group(3)),
+               "mips": float(match.group(4))}
+    if match.group(5) and muestra["instrucciones"]:
+        muestra["ciclos_instr"] = int(match.group(5)) / muestra["instrucciones"]
+    return muestra
+
+
+def resumir(muestras, clave):
+    valores = [m[clave] for m in muestras]
+    return {
+        "mediana": statistics.median(valores),
+        "media": statistics.fmean(valores),
+        "varianza": statistics.variance(valores) if len(valores) > 1 else 0.0,
+        "min": min(valores),
+        "max": max(valores),
+    }
+
+
+def medir(emulador, motores, cargas, runs):
+    resultados = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for carga in cargas:
+            archivo_bin = ensamblar(carga, tmp)
+            for motor in motores:
+                muestras = [ejecutar(emulador, motor, archivo_bin) for _ in range(runs)]
+                instrucciones = {m["instrucciones"] for m in muestras}
+                if len(instrucciones) != 1:
+                    raise RuntimeError(f"{carga} ({motor}): ejecución no determinista {instrucciones}")
+                resultado = {
+                    "carga": carga,
+                    "motor": motor,
+                    "runs": runs,
+                    "instrucciones": instrucciones.pop(),
+                    "mips": resumir(muestras, "mips"),
+                    "tiempo_ns": resumir(muestras, "tiempo_ns"),
+                    "muestras": {clave: [m[clave] for m in muestras]
+                                 for clave in ("mips", "tiempo_ns", "ciclos_instr")
+                                 if all(clave in m for m in muestras)},
+                }
+                if "ciclos_instr" in resultado["muestras"]:
+                    resultado["ciclos_instr"] = resumir(muestras, "ciclos_instr")
+                resultados.append(resultado)
+                print(f"  {carga:<18} {motor:<8} {resultados[-1]['mips']['mediana']:10.3f} MIPS",
+                      file=sys.stderr)
+    return resultados
+
+
+# HISTORIAL
+# =========
+
+def commit_actual():
+    """Commit de HEAD, con sufijo -dirty si hay cambios sin confirmar."""
+    try:
+        commit = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=DIR_RAIZ,
+                                capture_output=True, text=True, check=True).stdout.strip()
+        cambios = subprocess.run(["git", "status", "--porcelain", "--untracked-files=no"],
+                                 cwd=DIR_RAIZ, capture_output=True, text=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "desconocido"
+    return commit + ("-dirty" if cambios else "")
+
+
+def guardar_historial(ruta, resultados):
+    base = {"commit": commit_actual(), "fecha": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "maquina": platform.node()}
+    with open(ruta, "a") as out:
+        for r in resultados:
+            entrada = dict(base, carga=r["carga"], motor=r["motor"],
+                           instrucciones=r["instrucciones"], muestras=r["muestras"])
+            out.write(json.dumps(entrada) + "\n")
+    return base["commit"]
+
+
+def leer_historial(ruta):
+    with open(ruta) as f:
+        return [json.loads(linea) for linea in f if linea.strip()]
+
+
+def mismo_commit(registrado, pedido):
+    """Acepta prefijos del hash; las mediciones -dirty solo si se piden explícitamente."""
+    hash_reg, _, sufijo_reg = registrado.partition("-")
+    hash_ped, _, sufijo_ped = pedido.partition("-")
+    return hash_reg.startswith(hash_ped) and sufijo_reg == sufijo_ped
+
+
+def muestras_de(historial, commit):
+    """Junta las muestras de todas las mediciones de un commit."""
+    por_clave = {}
+    for e in historial:
+        if mismo_commit(e["commit"], commit):
+            destino = por_clave.setdefault((e["carga"], e["motor"]), {})
+            for metrica, valores in e["muestras"].items():
+                destino.setdefault(metrica, []).extend(valores)
+    return por_clave
+
+
+# COMPARACIÓN CON BOOTSTRAP
+# ========================
+
+def intervalo_bootstrap(base, nuevo, remuestreos=2000, confianza=0.95, semilla=1):
+    """IC del cociente de medianas nuevo/base, remuestreando cada lado con reemplazo."""
+    rng = random.Random(semilla)
+    cocientes = []
+    for _ in range(remuestreos):
+        mb = statistics.median(rng.choices(base, k=len(base)))
+        mn = statistics.median(rng.choices(nuevo, k=len(nuevo)))
+        if mb:
+            cocientes.append(mn / mb)
+    cocientes.sort()
+    alfa = (1 - confianza) / 2
+    bajo = cocientes[int(alfa * (len(cocientes) - 1))]
+    alto = cocientes[int((1 - alfa) * (len(cocientes) - 1))]
+    return statistics.median(nuevo) / statistics.median(base), bajo, alto
+
+
+def comparar(historial, commit_base, commit_nuevo, umbral):
+    base = muestras_de(historial, commit_base)
+    nuevo = muestras_de(historial, commit_nuevo)
+    if not base or not nuevo:
+        raise SystemExit(f"Sin mediciones en el historial para {commit_base if not base else commit_nuevo}")
+
+    regresiones = 0
+    print(f"{'carga':<18} {'motor':<8} {'metrica':<13} {'cambio':>8}  IC95%")
+    for clave in sorted(base.keys() & nuevo.keys()):
+        for metrica, mayor_mejor in METRICAS.items():
+            a, b = base[clave].get(metrica), nuevo[clave].get(metrica)
+            if not a or not b:
+                continue
+            cociente, bajo, alto = intervalo_bootstrap(a, b)
+            # Regresión: todo el IC cae del lado malo y el cambio supera el umbral
+            if mayor_mejor:
+                peor = alto < 1.0 and cociente < 1.0 - umbral
+            else:
+                peor = bajo > 1.0 and cociente > 1.0 + umbral
+            regresiones += peor
+            print(f"{clave[0]:<18} {clave[1]:<8} {metrica:<13} {(cociente - 1) * 100:+7.1f}%"
+                  f"  [{(bajo - 1) * 100:+.1f}%, {(alto - 1) * 100:+.1f}%]"
+                  + ("  <-- REGRESIÓN" if peor else ""))
+    return regresiones
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmarks del emulador")
+    parser.add_argument("cargas", nargs="*", help="cargas a ejecutar (por defecto todas)")
+    parser.add_argument("--runs", type=int, default=5, help="ejecuciones por carga y motor")
+    parser.add_argument("--motores", help="lista separada por comas (por defecto todos)")
+    parser.add_argument("--emulador", default=os.path.join(DIR_RAIZ, "emulador"))
+    parser.add_argument("--salida", help="archivo JSON de salida (por defecto stdout)")
+    parser.add_argument("--historial", default=HISTORIAL, help="archivo de historial (JSON Lines)")
+    parser.add_argument("--sin-historial", action="store_true", help="no añadir al historial")
+    parser.add_argument("--comparar", metavar="BASE", help="commit base a comparar")
+    parser.add_argument("--con", metavar="NUEVO",
+                        help="commit a comparar con BASE (por defecto el último del historial)")
+    parser.add_argument("--umbral", type=float, default=0.02,
+                        help="cambio mínimo para considerar regresión (por defecto 0.02 = 2%%)")
+    args = parser.parse_args()
+
+    if args.comparar:
+        # Solo se comparan mediciones de esta máquina: las de otras no son comparables
+        historial = [e for e in leer_historial(args.historial) if e.get("maquina") == platform.node()]
+        if not historial:
+            raise SystemExit(f"Sin mediciones en el historial para la máquina {platform.node()}")
+        nuevo = args.con or historial[-1]["commit"]
+        print(f"Comparando {args.comparar} -> {nuevo}")
+        regresiones = comparar(historial, args.comparar, nuevo, args.umbral)
+        print(f"{regresiones} regresión(es) significativa(s)")
+        sys.exit(1 if regresiones else 0)
+
+    motores = args.motores.split(",") if args.motores else listar_motores(args.emulador)
+    cargas = args.cargas or listar_cargas()
+
+    informe = {
+        "emulador": args.emulador,
+        "resultados": medir(args.emulador, motores, cargas, args.runs),
+    }
+    if not args.sin_historial:
+        informe["commit"] = guardar_historial(args.historial, informe["resultados"])
+
+    texto = json.dumps(informe, indent=2)
+    if args.salida:
+        with open(args.salida, "w") as out:
+            out.write(texto + "\n")
+    else:
+        print(texto)
+
+
+if __name__ == "__main__":
+    main()
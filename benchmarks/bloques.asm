@@ -0,0 +1,34 @@
+; Benchmark: línea de retardo con MOVE/FILL
+; Un buffer de 512 palabras en mem[1024..1535] se llena con FILL y en cada
+; repetición se desplaza una posición con un MOVE solapado
+; (mem[1025..1535] = mem[1024..1534]), entra por mem[1024] el número de
+; repetición y el buffer se copia a mem[2048..2559] con otro MOVE. Se suma
+; la palabra que sale (mem[2559]). 50000 repeticiones (800002 instrucciones,
+; ~51M palabras copiadas)
+
+LD X,[40]          // 0: X = 512
+LD ACC,[41]        // 1: valor inicial
+FILL ACC,[1024]    // 2: buffer = 7 (formato largo)
+LD X,[42]          // 4: repetición: X = 511
+LD ACC,#1024       // 5: origen (literal largo)
+MOVE ACC,[1025]    // 7: desplaza el buffer una posición
+LD ACC,[43]        // 9: entra el número de repetición
+ST ACC,[1024]      // 10
+LD X,[40]          // 12: X = 512
+LD ACC,#1024       // 13
+MOVE ACC,[2048]    // 15: copia del buffer
+LD ACC,[44]        // 17: suma += palabra que sale
+ADD ACC,[2559]     // 18
+ST ACC,[44]        // 20
+LD ACC,[43]        // 21: repeticiones restantes
+DEC ACC            // 22
+BZ [26]            // 23
+ST ACC,[43]        // 24
+BR [4]             // 25
+HALT               // 26
+
+mem[40] = 512      ; Palabras del buffer
+mem[41] = 7        ; Valor inicial del buffer
+mem[42] = 511      ; Palabras que se desplazan
+mem[43] = 50000    ; Repeticiones (y valor que entra)
+mem[44] = 0        ; Suma de las salidas (60705)
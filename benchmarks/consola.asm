@@ -0,0 +1,33 @@
+; Benchmark: texto por la consola de E/S (CONSOLA_SALIDA, mem[3776])
+; Escribe 15000 veces "Hola, mundo\n" recorriendo la cadena con
+; direccionamiento indexado (~1M instrucciones, 180 KB de salida)
+
+CLR X            // 0: línea: X = 0
+LD ACC,[41+X]    // 1: carácter: ACC = texto[X]
+BZ [7]           // 2: fin de la cadena
+ST ACC,[3776]    // 3: CONSOLA_SALIDA (formato largo, 2 palabras)
+ADD X,#1         // 5
+BR [1]           // 6
+LD ACC,[40]      // 7: repeticiones restantes
+DEC ACC          // 8
+BZ [12]          // 9
+ST ACC,[40]      // 10
+BR [0]           // 11
+HALT             // 12
+
+mem[40] = 15000  ; Repeticiones
+
+; "Hola, mundo\n" terminada en 0
+mem[41] = 72
+mem[42] = 111
+mem[43] = 108
+mem[44] = 97
+mem[45] = 44
+mem[46] = 32
+mem[47] = 109
+mem[48] = 117
+mem[49] = 110
+mem[50] = 100
+mem[51] = 111
+mem[52] = 10
+mem[53] = 0
@@ -0,0 +1,15 @@
+; Benchmark: bucles de cuenta atrás anidados
+; 100 vueltas externas x 3333 internas de DEC/BZ/BR (~1M instrucciones)
+
+LD ACC,[20]    // 0: ACC = vueltas externas
+LD X,[21]      // 1: externo: X = vueltas internas
+DEC X          // 2: interno
+BZ [5]         // 3
+BR [2]         // 4
+DEC ACC        // 5
+BZ [8]         // 6
+BR [1]         // 7
+HALT           // 8
+
+mem[20] = 100     ; Vueltas externas
+mem[21] = 3333    ; Vueltas internas
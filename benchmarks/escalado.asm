@@ -0,0 +1,59 @@
+; Benchmark: escalado de un array con MUL/DIV/MOD
+; y[i] = x[i] * 5 / 3 para 32 elementos (x en mem[40..71], y en mem[104..135])
+; y suma de y[i] % 7, 3000 repeticiones (~1M instrucciones)
+
+LD X,[32]          // 0: repetición: X = N
+LD ACC,[39+X]      // 1: bucle: x[i]
+MUL ACC,#5         // 2
+DIV ACC,#3         // 3
+ST ACC,[103+X]     // 4: y[i] (formato largo)
+MOD ACC,#7         // 6
+ADD ACC,[33]       // 7: suma += y[i] % 7
+ST ACC,[33]        // 8
+DEC X              // 9
+BZ [12]            // 10
+BR [1]             // 11
+LD ACC,[35]        // 12: repeticiones restantes
+DEC ACC            // 13
+BZ [17]            // 14
+ST ACC,[35]        // 15
+BR [0]             // 16
+HALT               // 17
+
+mem[32] = 32       ; N (elementos del array)
+mem[33] = 0        ; Suma de los restos (25856)
+mem[35] = 3000     ; Repeticiones
+
+; Array x[1..32] = 97, 194, ..., 3104 (y[1] = 161, y[32] = 5173)
+mem[40] = 97
+mem[41] = 194
+mem[42] = 291
+mem[43] = 388
+mem[44] = 485
+mem[45] = 582
+mem[46] = 679
+mem[47] = 776
+mem[48] = 873
+mem[49] = 970
+mem[50] = 1067
+mem[51] = 1164
+mem[52] = 1261
+mem[53] = 1358
+mem[54] = 1455
+mem[55] = 1552
+mem[56] = 1649
+mem[57] = 1746
+mem[58] = 1843
+mem[59] = 1940
+mem[60] = 2037
+mem[61] = 2134
+mem[62] = 2231
+mem[63] = 2328
+mem[64] = 2425
+mem[65] = 2522
+mem[66] = 2619
+mem[67] = 2716
+mem[68] = 2813
+mem[69] = 2910
+mem[70] = 3007
+mem[71] = 3104
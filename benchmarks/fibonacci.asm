@@ -0,0 +1,29 @@
+; Benchmark: tabla de Fibonacci con direccionamiento indexado
+; Rellena f[2..25] (mem[42..65]) a partir de f[0] = 0, f[1] = 1, 4500 repeticiones
+
+CLR X              // 0: repetición: X = 0
+LD ACC,[32]        // 1: contador = N
+ST ACC,[31]        // 2
+LD ACC,[40+X]      // 3: bucle: ACC = f[i]
+ADD ACC,[41+X]     // 4: ACC += f[i + 1]
+ST ACC,[42+X]      // 5: f[i + 2] = ACC
+ADD X,[30]         // 6: X++
+LD ACC,[31]        // 7
+DEC ACC            // 8
+BZ [12]            // 9
+ST ACC,[31]        // 10
+BR [3]             // 11
+LD ACC,[33]        // 12: repeticiones restantes
+DEC ACC            // 13
+BZ [17]            // 14
+ST ACC,[33]        // 15
+BR [0]             // 16
+HALT               // 17
+
+mem[30] = 1        ; Constante 1
+mem[31] = 0        ; Contador
+mem[32] = 24       ; N (términos a calcular)
+mem[33] = 4500     ; Repeticiones
+
+mem[40] = 0        ; f[0]
+mem[41] = 1        ; f[1]
@@ -0,0 +1,72 @@
+; Benchmark: recorrido de una lista enlazada con direccionamiento indirecto
+; 20 nodos dispersos en mem[68..193], cada nodo = [siguiente, valor].
+; Suma los valores de la lista, 5300 repeticiones.
+
+LD ACC,[29]        // 0: repetición: P = cabeza
+ST ACC,[26]        // 1
+ADD ACC,[27]       // 2
+ST ACC,[25]        // 3: V = P + 1
+LD ACC,[[25]]      // 4: bucle: ACC = valor del nodo
+ADD ACC,[24]       // 5
+ST ACC,[24]        // 6: suma += valor
+LD ACC,[[26]]      // 7: ACC = siguiente
+BZ [13]            // 8: fin de la lista
+ST ACC,[26]        // 9: P = siguiente
+ADD ACC,[27]       // 10
+ST ACC,[25]        // 11: V = P + 1
+BR [4]             // 12
+LD ACC,[28]        // 13: repeticiones restantes
+DEC ACC            // 14
+BZ [18]            // 15
+ST ACC,[28]        // 16
+BR [0]             // 17
+HALT               // 18
+
+mem[24] = 0        ; Suma
+mem[25] = 0        ; V: puntero al valor del nodo actual
+mem[26] = 0        ; P: puntero al nodo actual
+mem[27] = 1        ; Constante 1
+mem[28] = 5300     ; Repeticiones
+mem[29] = 146      ; Cabeza de la lista
+
+; Nodos: mem[n] = siguiente, mem[n + 1] = valor
+mem[146] = 102
+mem[147] = 1
+mem[102] = 164
+mem[103] = 2
+mem[164] = 76
+mem[165] = 3
+mem[76] = 82
+mem[77] = 4
+mem[82] = 168
+mem[83] = 5
+mem[168] = 132
+mem[169] = 6
+mem[132] = 192
+mem[133] = 7
+mem[192] = 110
+mem[193] = 8
+mem[110] = 138
+mem[111] = 9
+mem[138] = 70
+mem[139] = 10
+mem[70] = 128
+mem[71] = 11
+mem[128] = 90
+mem[129] = 12
+mem[90] = 68
+mem[91] = 13
+mem[68] = 74
+mem[69] = 14
+mem[74] = 118
+mem[75] = 15
+mem[118] = 116
+mem[119] = 16
+mem[116] = 72
+mem[117] = 17
+mem[72] = 94
+mem[73] = 18
+mem[94] = 170
+mem[95] = 19
+mem[170] = 0
+mem[171] = 20
@@ -0,0 +1,73 @@
+; Benchmark: memcpy con direccionamiento indirecto indexado
+; Copia 16 palabras de mem[64..79] a mem[80..95], 10000 repeticiones.
+; La tabla de punteros intercala origen/destino a partir de mem[32]:
+;   mem[30 + X] = puntero origen, mem[31 + X] = puntero destino (X = 32, 30, ..., 2)
+
+LD X,[28]          // 0: repetición: X = 2 * N
+LD ACC,[[30+X]]    // 1: bucle: ACC = *origen
+ST ACC,[[31+X]]    // 2: *destino = ACC
+DEC X              // 3
+DEC X              // 4
+BZ [7]             // 5
+BR [1]             // 6
+LD ACC,[29]        // 7: repeticiones restantes
+DEC ACC            // 8
+BZ [12]            // 9
+ST ACC,[29]        // 10
+BR [0]             // 11
+HALT               // 12
+
+mem[28] = 32       ; 2 * N
+mem[29] = 10000    ; Repeticiones
+
+; Tabla de punteros (origen, destino)
+mem[32] = 64
+mem[33] = 80
+mem[34] = 65
+mem[35] = 81
+mem[36] = 66
+mem[37] = 82
+mem[38] = 67
+mem[39] = 83
+mem[40] = 68
+mem[41] = 84
+mem[42] = 69
+mem[43] = 85
+mem[44] = 70
+mem[45] = 86
+mem[46] = 71
+mem[47] = 87
+mem[48] = 72
+mem[49] = 88
+mem[50] = 73
+mem[51] = 89
+mem[52] = 74
+mem[53] = 90
+mem[54] = 75
+mem[55] = 91
+mem[56] = 76
+mem[57] = 92
+mem[58] = 77
+mem[59] = 93
+mem[60] = 78
+mem[61] = 94
+mem[62] = 79
+mem[63] = 95
+
+; Buffer origen
+mem[64] = 256
+mem[65] = 263
+mem[66] = 270
+mem[67] = 277
+mem[68] = 284
+mem[69] = 291
+mem[70] = 298
+mem[71] = 305
+mem[72] = 312
+mem[73] = 319
+mem[74] = 326
+mem[75] = 333
+mem[76] = 340
+mem[77] = 347
+mem[78] = 354
+mem[79] = 361
@@ -0,0 +1,256 @@
+/*
+ micro.c - Microbenchmarks del núcleo del emulador
+
+ Mide el coste por llamada (ns y, si hay contadores de hardware, ciclos,
+ instrucciones y saltos mal predichos) de:
+ - fetch_and_decode para cada modo de direccionamiento y en formato largo
+ - el despacho por tabla a través de instruction_set/extended_set/immediate_set
+ - MOVE y FILL de un bloque de 512 palabras
+ - un paso completo de execute_instruction
+ - printCPUState y printCPUChanges, que el motor debug/incremental llama en cada paso
+
+ Compilar y ejecutar (desde la raíz del repositorio):
+   gcc -O2 -I. cpu.c traza.c grabacion.c historial.c puntos.c benchmarks/micro.c -o micro -pthread
+   ./micro [filtro]
+
+ Escribe una línea por benchmark en stderr, p. ej.:
+   bench=fetch_decode/indirecto llamadas=... ns=2.10 ciclos=7.9 instr=21.0 fallos_salto=0.00
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "contadores.h"
+
+#define REPETICIONES 7              // Se informa la mediana de las repeticiones
+#define TIEMPO_MIN_NS 20000000ull   // Cada repetición dura al menos 20 ms
+#define NUM_OPS_MEZCLA 1024
+
+static volatile uint16_t sumidero;  // Evita que el compilador elimine el trabajo
+static Contadores contadores;
+static int hay_contadores;
+
+typedef void (*CuerpoBench)(CPU *cpu, uint64_t n, const void *arg);
+
+typedef struct {
+    uint64_t ns;
+    LecturaContadores c;
+} Muestra;
+
+
+// CUERPOS DE LOS BENCHMARKS
+// =========================
+
+static void bench_fetch_decode(CPU *cpu, uint64_t n, const void *arg)
+{
+    InstructionContext ctx;
+    uint16_t acum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        fetch_and_decode(cpu, &ctx);
+        acum ^= ctx.eff_addr;
+    }
+    sumidero = acum;
+}
+
+static void bench_despacho(CPU *cpu, uint64_t n, const void *arg)
+{
+    const Instruction *ins = arg;
+    for (uint64_t i = 0; i < n; i++) {
+        ins->execute(cpu, 1, 40);
+    }
+    sumidero = cpu->acc;
+}
+
+static void bench_despacho_mezcla(CPU *cpu, uint64_t n, const void *arg)
+{
+    const uint8_t *ops = arg;
+    for (uint64_t i = 0; i < n; i++) {
+        instruction_set[ops[i % NUM_OPS_MEZCLA]].execute(cpu, 1, 40);
+    }
+    sumidero = cpu->acc;
+}
+
+static void bench_execute(CPU *cpu, uint64_t n, const void *arg)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        execute_instruction(cpu);
+    }
+    sumidero = cpu->acc;
+}
+
+static void bench_print(CPU *cpu, uint64_t n, const void *arg)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        printCPUState(cpu);
+    }
+    fflush(stdout);
+}
+
+// Un paso típico: cambian PC, ACC y una palabra de memoria
+static void bench_print_changes(CPU *cpu, uint64_t n, const void *arg)
+{
+    static CPU prev;
+    prev = *cpu;
+    for (uint64_t i = 0; i < n; i++) {
+        cpu->pc++;
+        cpu->acc++;
+        cpu->mem[cpu->mem_hwm / 2]++;
+        printCPUChanges(cpu, &prev);
+    }
+    fflush(stdout);
+}
+
+
+// MEDICIÓN
+// ========
+
+static int comparar_muestras(const void *a, const void *b)
+{
+    const Muestra *x = a, *y = b;
+    return (x->ns > y->ns) - (x->ns < y->ns);
+}
+
+static Muestra medir_lote(CuerpoBench cuerpo, CPU *cpu, uint64_t n, const void *arg)
+{
+    Muestra m;
+    LecturaContadores antes, despues;
+
+    contadores_leer(&contadores, &antes);
+    uint64_t t0 = reloj_ns();
+    cuerpo(cpu, n, arg);
+    m.ns = reloj_ns() - t0;
+    contadores_leer(&contadores, &despues);
+
+    m.c.ciclos = despues.ciclos - antes.ciclos;
+    m.c.instrucciones = despues.instrucciones - antes.instrucciones;
+    m.c.fallos_salto = despues.fallos_salto - antes.fallos_salto;
+    return m;
+}
+
+/*
+ Calibra el número de llamadas para que un lote dure TIEMPO_MIN_NS,
+ mide REPETICIONES lotes y escribe la mediana por llamada.
+ */
+static void medir(const char *filtro, const char *nombre, CuerpoBench cuerpo,
+                  CPU *cpu, const void *arg)
+{
+    if (filtro && !strstr(nombre, filtro)) return;
+
+    uint64_t n = 1;
+    while (medir_lote(cuerpo, cpu, n, arg).ns < TIEMPO_MIN_NS / 10 && n < (1ull << 40)) {
+        n *= 2;
+    }
+    n *= 10;
+
+    Muestra muestras[REPETICIONES];
+    for (int r = 0; r < REPETICIONES; r++) {
+        muestras[r] = medir_lote(cuerpo, cpu, n, arg);
+    }
+    qsort(muestras, REPETICIONES, sizeof(Muestra), comparar_muestras);
+    Muestra *med = &muestras[REPETICIONES / 2];
+
+    fprintf(stderr, "bench=%s llamadas=%llu ns=%.3f", nombre, (unsigned long long)n,
+            (double)med->ns / n);
+    if (hay_contadores) {
+        fprintf(stderr, " ciclos=%.2f instr=%.2f fallos_salto=%.4f",
+                (double)med->c.ciclos / n, (double)med->c.instrucciones / n,
+                (double)med->c.fallos_salto / n);
+    }
+    fprintf(stderr, "\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *filtro = argc > 1 ? argv[1] : NULL;
+    static CPU cpu;
+
+    // printCPUState escribe en stdout: se descarta para medir solo su coste
+    if (!freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Error: no se pudo redirigir stdout\n");
+        return 1;
+    }
+
+    hay_contadores = contadores_abrir(&contadores);
+    if (!hay_contadores) {
+        fprintf(stderr, "# contadores de hardware no disponibles, solo tiempo\n");
+    }
+
+    // fetch_and_decode: LD ACC con cada modo, cd = 10, X = 5
+    static const char *modos[] = {"directo", "indirecto", "indexado", "indirecto_indexado"};
+    for (int modo = 0; modo < 4; modo++) {
+        char nombre[64];
+        resetCPU(&cpu);
+        cpu.mem[0] = (1 << OPCODE_SHIFT) | (1 << 8) | (modo << 6) | 10;
+        cpu.mem[10] = 20;
+        cpu.mem[15] = 30;
+        cpu.x = 5;
+        snprintf(nombre, sizeof(nombre), "fetch_decode/%s", modos[modo]);
+        medir(filtro, nombre, bench_fetch_decode, &cpu, NULL);
+    }
+
+    // Formato largo: LD ACC,[2000] (la dirección en la segunda palabra)
+    resetCPU(&cpu);
+    cpu.mem[0] = LARGO_BIT | (1 << OPCODE_SHIFT) | (1 << 8);
+    cpu.mem[1] = 2000;
+    medir(filtro, "fetch_decode/largo", bench_fetch_decode, &cpu, NULL);
+
+    // Despacho por tabla, un handler cada vez (salto indirecto bien predicho)
+    for (int op = 0; op <= OPCODE_MASK; op++) {
+        char nombre[64];
+        if (instruction_set[op].execute == reserved_op) continue;   // Extendidas y sin asignar
+        resetCPU(&cpu);
+        snprintf(nombre, sizeof(nombre), "despacho/%s", instruction_set[op].name);
+        medir(filtro, nombre, bench_despacho, &cpu, &instruction_set[op]);
+    }
+    for (int op = 0; op <= OPCODE_MASK; op++) {
+        char nombre[64];
+        if (immediate_set[op].execute == reserved_op) continue;   // No admiten inmediato
+        resetCPU(&cpu);
+        snprintf(nombre, sizeof(nombre), "despacho/inm_%s", immediate_set[op].name);
+        medir(filtro, nombre, bench_despacho, &cpu, &immediate_set[op]);
+    }
+    for (int ext = 0; ext <= EXT_MASK; ext++) {
+        char nombre[64];
+        resetCPU(&cpu);
+        snprintf(nombre, sizeof(nombre), "despacho/ext_%s", extended_set[ext].name);
+        medir(filtro, nombre, bench_despacho, &cpu, &extended_set[ext]);
+    }
+
+    // MOVE y FILL de 512 palabras (los kernels de bloque del host)
+    resetCPU(&cpu);
+    cpu.acc = 1024;
+    cpu.x = 512;
+    medir(filtro, "bloque/move_512", bench_despacho, &cpu, &instruction_set[19]);
+    medir(filtro, "bloque/fill_512", bench_despacho, &cpu, &instruction_set[20]);
+
+    // Despacho con opcodes aleatorios (salto indirecto difícil de predecir)
+    static uint8_t ops[NUM_OPS_MEZCLA];
+    srand(1);
+    for (int i = 0; i < NUM_OPS_MEZCLA; i++) ops[i] = rand() % 7;
+    resetCPU(&cpu);
+    medir(filtro, "despacho/mezcla", bench_despacho_mezcla, &cpu, ops);
+
+    // Paso completo: bucle "ADD ACC,[10]; BR [0]"
+    resetCPU(&cpu);
+    cpu.mem[0] = (2 << OPCODE_SHIFT) | (1 << 8) | 10;
+    cpu.mem[1] = (3 << OPCODE_SHIFT) | 0;
+    cpu.mem[10] = 1;
+    medir(filtro, "execute_instruction/add_br", bench_execute, &cpu, NULL);
+
+    // printCPUState con la memoria casi vacía (30 palabras)
+    // y con la última palabra usada (imprime las 4096 palabras)
+    resetCPU(&cpu);
+    cpu.mem[0] = 0xE00;
+    medir(filtro, "printCPUState/memoria_vacia", bench_print, &cpu, NULL);
+    cpu.mem[MEM_SIZE - 1] = 1;
+    cpu.mem_hwm = MEM_SIZE - 1;
+    medir(filtro, "printCPUState/memoria_llena", bench_print, &cpu, NULL);
+    medir(filtro, "printCPUChanges/memoria_llena", bench_print_changes, &cpu, NULL);
+
+    contadores_cerrar(&contadores);
+    return 0;
+}
@@ -0,0 +1,40 @@
+; Benchmark: Fibonacci recursivo con JSR/RTS y PUSH/POP
+; fib(n) = n si n < 2, fib(n - 1) + fib(n - 2) si no; recibe n en ACC y
+; devuelve el resultado en ACC, guardando n y fib(n - 1) en la pila.
+; fib(15) = 610 (1973 llamadas), 40 repeticiones (~900K instrucciones)
+
+LD ACC,[41]        // 0: bucle: ACC = n
+JSR [10]           // 1: ACC = fib(n)
+ADD ACC,[42]       // 2: suma += fib(n)
+ST ACC,[42]        // 3
+LD ACC,[40]        // 4: repeticiones restantes
+DEC ACC            // 5
+BZ [9]             // 6
+ST ACC,[40]        // 7
+BR [0]             // 8
+HALT               // 9
+PUSH ACC           // 10: fib: guarda n
+AND ACC,#0xFFFE    // 11: Z si n < 2 (literal largo)
+BZ [29]            // 13
+POP ACC            // 14: ACC = n
+PUSH ACC           // 15
+SUB ACC,#1         // 16
+JSR [10]           // 17: ACC = fib(n - 1)
+POP X              // 18: X = n
+PUSH ACC           // 19: guarda fib(n - 1)
+DEC X              // 20
+DEC X              // 21
+ST X,[43]          // 22
+LD ACC,[43]        // 23: ACC = n - 2
+JSR [10]           // 24: ACC = fib(n - 2)
+POP X              // 25: X = fib(n - 1)
+ST X,[43]          // 26
+ADD ACC,[43]       // 27: ACC = fib(n - 1) + fib(n - 2)
+RTS                // 28
+POP ACC            // 29: caso base: ACC = n
+RTS                // 30
+
+mem[40] = 40       ; Repeticiones
+mem[41] = 15       ; n
+mem[42] = 0        ; Suma de los resultados (24400)
+mem[43] = 0        ; Temporal
@@ -0,0 +1,54 @@
+; Benchmark: suma de un array con direccionamiento indexado
+; Suma a[1..32] (mem[40..71]) recorriendo X de 32 a 1, 7500 repeticiones
+
+CLR ACC          // 0: repetición: suma = 0
+LD X,[32]        // 1: X = N
+ADD ACC,[39+X]   // 2: bucle: suma += mem[39 + X]
+DEC X            // 3
+BZ [6]           // 4
+BR [2]           // 5
+ST ACC,[33]      // 6: guardar resultado
+LD ACC,[34]      // 7: repeticiones restantes
+DEC ACC          // 8
+BZ [12]          // 9
+ST ACC,[34]      // 10
+BR [0]           // 11
+HALT             // 12
+
+mem[32] = 32      ; N (elementos del array)
+mem[33] = 0       ; Resultado (528)
+mem[34] = 7500    ; Repeticiones
+
+; Array a[1..32] = 1..32
+mem[40] = 1
+mem[41] = 2
+mem[42] = 3
+mem[43] = 4
+mem[44] = 5
+mem[45] = 6
+mem[46] = 7
+mem[47] = 8
+mem[48] = 9
+mem[49] = 10
+mem[50] = 11
+mem[51] = 12
+mem[52] = 13
+mem[53] = 14
+mem[54] = 15
+mem[55] = 16
+mem[56] = 17
+mem[57] = 18
+mem[58] = 19
+mem[59] = 20
+mem[60] = 21
+mem[61] = 22
+mem[62] = 23
+mem[63] = 24
+mem[64] = 25
+mem[65] = 26
+mem[66] = 27
+mem[67] = 28
+mem[68] = 29
+mem[69] = 30
+mem[70] = 31
+mem[71] = 32
@@ -0,0 +1,49 @@
+; Benchmark: generador xorshift de 16 bits (7, 9, 8) con la ALU
+; 40000 números: s ^= s << 7; s ^= s >> 9; s ^= s << 8. Además resta cada
+; número de una suma, acumula con OR los bits vistos y cuenta con CMP los
+; que acaban en 0x5A (~1M instrucciones)
+
+LD ACC,[40]      // 0: s = semilla
+LD X,[41]        // 1: X = números a generar
+ST ACC,[42]      // 2: bucle: t = s
+SHL ACC,[43]     // 3: s << 7
+XOR ACC,[42]     // 4
+ST ACC,[42]      // 5
+SHR ACC,[44]     // 6: s >> 9
+XOR ACC,[42]     // 7
+ST ACC,[42]      // 8
+SHL ACC,[45]     // 9: s << 8
+XOR ACC,[42]     // 10
+ST ACC,[42]      // 11: mem[42] = s
+LD ACC,[51]      // 12: suma -= s
+SUB ACC,[42]     // 13
+ST ACC,[51]      // 14
+LD ACC,[49]      // 15: bits |= s
+OR ACC,[42]      // 16
+ST ACC,[49]      // 17
+LD ACC,[42]      // 18: ¿(s & 0xFF) == 0x5A?
+AND ACC,[46]     // 19
+CMP ACC,[47]     // 20
+BZ [26]          // 21
+LD ACC,[42]      // 22: siguiente: ACC = s
+DEC X            // 23
+BZ [30]          // 24
+BR [2]           // 25
+LD ACC,[48]      // 26: aciertos++
+ADD ACC,[50]     // 27
+ST ACC,[48]      // 28
+BR [22]          // 29
+HALT             // 30
+
+mem[40] = 1       ; Semilla
+mem[41] = 40000   ; Números a generar
+mem[42] = 0       ; s (último número: 30953)
+mem[43] = 7
+mem[44] = 9
+mem[45] = 8
+mem[46] = 0xFF
+mem[47] = 0x5A
+mem[48] = 0       ; Aciertos (143)
+mem[49] = 0       ; Bits vistos (65535)
+mem[50] = 1
+mem[51] = 0       ; Suma (13191)
@@ -0,0 +1,95 @@
+#ifndef CONTADORES_H
+#define CONTADORES_H
+
+/*
+ Contadores de hardware (perf_event_open) para medir el coste de zonas de código.
+
+ Solo en Linux y solo si el kernel lo permite (perf_event_paranoid, contenedores...).
+ Si no hay contadores, contadores_abrir() devuelve 0 y las lecturas valen 0:
+ el código que mide sigue funcionando solo con tiempo de reloj.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+typedef struct {
+    uint64_t ciclos;          // Ciclos de CPU del host
+    uint64_t instrucciones;   // Instrucciones del host retiradas
+    uint64_t fallos_salto;    // Saltos mal predichos
+} LecturaContadores;
+
+typedef struct {
+    int fd[3];                // -1 si el contador no está disponible
+} Contadores;
+
+static inline uint64_t reloj_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+#ifdef __linux__
+static inline int abrir_contador(uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static inline void contadores_cerrar(Contadores *c)
+{
+#ifdef __linux__
+    for (int i = 0; i < 3; i++) {
+        if (c->fd[i] >= 0) close(c->fd[i]);
+    }
+#endif
+    c->fd[0] = c->fd[1] = c->fd[2] = -1;
+}
+
+/*
+ Abre los contadores del hilo actual. Devuelve 1 si al menos el de ciclos funciona.
+ */
+static inline int contadores_abrir(Contadores *c)
+{
+    c->fd[0] = c->fd[1] = c->fd[2] = -1;
+#ifdef __linux__
+    c->fd[0] = abrir_contador(PERF_COUNT_HW_CPU_CYCLES);
+    c->fd[1] = abrir_contador(PERF_COUNT_HW_INSTRUCTIONS);
+    c->fd[2] = abrir_contador(PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    if (c->fd[0] < 0) {
+        contadores_cerrar(c);
+        return 0;
+    }
+    return 1;
+}
+
+static inline void contadores_leer(Contadores *c, LecturaContadores *l)
+{
+    uint64_t v[3] = {0, 0, 0};
+#ifdef __linux__
+    for (int i = 0; i < 3; i++) {
+        if (c->fd[i] < 0 || read(c->fd[i], &v[i], sizeof(v[i])) != sizeof(v[i])) v[i] = 0;
+    }
+#endif
+    l->ciclos = v[0];
+    l->instrucciones = v[1];
+    l->fallos_salto = v[2];
+}
+
+#endif
@@ -0,0 +1,1645 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "grabacion.h"
+#include "historial.h"
+#include "puntos.h"
+#include "mapa.h"
+
+#define PALABRAS_PILA 16          // Palabras de la pila que muestra printCPUState
+
+
+// TABLAS DE INSTRUCCIONES
+// =======================
+
+/*
+Tabla de instrucciones normales (opcodes 0-6 y 8-31)
+Índice: número de opcode
+Contenido: {nombre, función ejecutora}
+El opcode 7 se despacha por extended_set; su entrada solo rellena el hueco
+*/
+const Instruction instruction_set[] = {
+    {"st", store_data},    // Opcode 0: Store
+    {"ld", load_data},     // Opcode 1: Load  
+    {"add", add_data},     // Opcode 2: Add
+    {"br", branch_jump},   // Opcode 3: Branch
+    {"bz", branch_if_zero},// Opcode 4: Branch if Zero
+    {"clr", clear_reg},    // Opcode 5: Clear
+    {"dec", decrement_reg},// Opcode 6: Decrement
+    {"ext", reserved_op},  // Opcode 7: Extendidas (ver extended_set)
+    {"sub", sub_data},     // Opcode 8: Subtract
+    {"and", and_data},     // Opcode 9: And
+    {"or", or_data},       // Opcode 10: Or
+    {"xor", xor_data},     // Opcode 11: Xor
+    {"cmp", compare_data}, // Opcode 12: Compare
+    {"shl", shift_left},   // Opcode 13: Shift Left
+    {"shr", shift_right},  // Opcode 14: Shift Right
+    {"jsr", jump_subroutine}, // Opcode 15: Jump to Subroutine
+    {"mul", mul_data},     // Opcode 16: Multiply
+    {"div", div_data},     // Opcode 17: Divide
+    {"mod", mod_data},     // Opcode 18: Modulo
+    {"move", move_block},  // Opcode 19: Copia de bloque
+    {"fill", fill_block},  // Opcode 20: Relleno de bloque
+    {"push", push_reg},    // Opcode 21: Push
+    {"pop", pop_reg},      // Opcode 22: Pop
+    {"rti", return_interrupt}, // Opcode 23: Return from Interrupt
+    {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op},
+    {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}
+                           // Opcodes 24-31: Sin asignar
+};
+
+/*
+ Tabla de instrucciones extendidas (opcode 7 + extended opcode)  
+ Índice: número de extended opcode
+ Contenido: {nombre, función ejecutora}
+ */
+const Instruction extended_set[] = {
+    {"halt", halt_cpu},    // Extended 0: Halt
+    {"ei", enable_int},    // Extended 1: Enable Interrupts
+    {"di", disable_int},   // Extended 2: Disable Interrupts
+    {"rts", return_subroutine}  // Extended 3: Return from Subroutine
+};
+
+/*
+ Tabla de instrucciones con operando inmediato (I=1)
+ Índice: número de opcode
+ Contenido: {nombre, función ejecutora}; la función recibe el literal en
+ lugar de la dirección efectiva. Solo los opcodes que leen un dato lo
+ admiten; el resto no hace nada
+ */
+const Instruction immediate_set[] = {
+    {"st", reserved_op},            // Opcode 0
+    {"ld", load_immediate},         // Opcode 1: Load
+    {"add", add_immediate},         // Opcode 2: Add
+    {"br", reserved_op},            // Opcode 3
+    {"bz", reserved_op},            // Opcode 4
+    {"clr", reserved_op},           // Opcode 5
+    {"dec", reserved_op},           // Opcode 6
+    {"ext", reserved_op},           // Opcode 7: Extendidas (ver extended_set)
+    {"sub", sub_immediate},         // Opcode 8: Subtract
+    {"and", and_immediate},         // Opcode 9: And
+    {"or", or_immediate},           // Opcode 10: Or
+    {"xor", xor_immediate},         // Opcode 11: Xor
+    {"cmp", compare_immediate},     // Opcode 12: Compare
+    {"shl", shift_left_immediate},  // Opcode 13: Shift Left
+    {"shr", shift_right_immediate}, // Opcode 14: Shift Right
+    {"jsr", reserved_op},           // Opcode 15
+    {"mul", mul_immediate},         // Opcode 16: Multiply
+    {"div", div_immediate},         // Opcode 17: Divide
+    {"mod", mod_immediate},         // Opcode 18: Modulo
+    {"move", reserved_op},          // Opcode 19
+    {"fill", reserved_op},          // Opcode 20
+    {"push", reserved_op},          // Opcode 21
+    {"pop", reserved_op},           // Opcode 22
+    {"rti", reserved_op},           // Opcode 23
+    {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op},
+    {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}, {"?", reserved_op}
+                                    // Opcodes 24-31: Sin asignar
+};
+
+/*
+ Ciclos de cada instrucción en formato corto (ver MODELO DE CICLOS en cpu.h)
+ Índices: [opcode][dirm]. Palabra + puntero (dirm 1 y 3) + dato.
+ */
+const uint8_t ciclos_base[32][4] = {
+    {2, 3, 2, 3},    // ST
+    {2, 3, 2, 3},    // LD
+    {2, 3, 2, 3},    // ADD
+    {1, 2, 1, 2},    // BR
+    {1, 2, 1, 2},    // BZ
+    {1, 1, 1, 1},    // CLR
+    {1, 1, 1, 1},    // DEC
+    {1, 1, 1, 1},    // Extendidas
+    {2, 3, 2, 3},    // SUB
+    {2, 3, 2, 3},    // AND
+    {2, 3, 2, 3},    // OR
+    {2, 3, 2, 3},    // XOR
+    {2, 3, 2, 3},    // CMP
+    {2, 3, 2, 3},    // SHL
+    {2, 3, 2, 3},    // SHR
+    {2, 3, 2, 3},    // JSR (palabra + puntero + dirección de vuelta en la pila)
+    {2, 3, 2, 3},    // MUL
+    {2, 3, 2, 3},    // DIV
+    {2, 3, 2, 3},    // MOD
+    {1, 2, 1, 2},    // MOVE (los accesos al bloque, en ciclos_extra)
+    {1, 2, 1, 2},    // FILL
+    {2, 2, 2, 2},    // PUSH
+    {2, 2, 2, 2},    // POP
+    {3, 3, 3, 3},    // RTI (palabra + flags + PC)
+    {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1},
+    {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1}     // Sin asignar
+};
+
+/*
+ Ciclos que MUL, DIV y MOD tardan además de sus accesos a memoria, si no
+ se configuran otros (ver ciclos_configurar). Índice: opcode
+ */
+const uint8_t ciclos_latencia_defecto[32] = {
+    [16] = 4,        // MUL
+    [17] = 12,       // DIV
+    [18] = 12        // MOD
+};
+
+int ciclos_configurar(uint8_t latencia[32], const char *texto)
+{
+    static const struct { const char *nombre; uint8_t opcode; } unidades[] = {
+        {"mul", 16}, {"div", 17}, {"mod", 18}
+    };
+    while (*texto) {
+        size_t len = strcspn(texto, "=");
+        char *fin;
+        int i = 0;
+        while (i < 3 && (strlen(unidades[i].nombre) != len || strncmp(texto, unidades[i].nombre, len))) i++;
+        if (i == 3 || texto[len] != '=') return -1;
+        unsigned long n = strtoul(texto + len + 1, &fin, 10);
+        if (fin == texto + len + 1 || n > 255 || (*fin && *fin != ',')) return -1;
+        latencia[unidades[i].opcode] = (uint8_t)n;
+        texto = *fin ? fin + 1 : fin;
+    }
+    return 0;
+}
+
+
+// ENTRADA/SALIDA MAPEADA EN MEMORIA
+// =================================
+
+int cpu_mapear_es(CPU *cpu, uint16_t base, unsigned palabras, const DispositivoES *d)
+{
+    unsigned primera = base >> BITS_PAGINA;
+    unsigned fin = (base + palabras + PALABRAS_PAGINA - 1) >> BITS_PAGINA;
+    unsigned region = 0;
+
+    if ((base & (PALABRAS_PAGINA - 1)) || palabras == 0 || fin > NUM_PAGINAS) return -1;
+    for (unsigned p = primera; p < fin; p++) {
+        if (cpu->tipo_pagina[p]) return -1;
+    }
+    for (unsigned p = 0; p < NUM_PAGINAS; p++) {
+        if (cpu->tipo_pagina[p] > region) region = cpu->tipo_pagina[p];
+    }
+    if (region == MAX_REGIONES_ES) return -1;
+
+    cpu->regiones_es[region].dispositivo = *d;
+    cpu->regiones_es[region].base = base;
+    for (unsigned p = primera; p < fin; p++) cpu->tipo_pagina[p] = (uint8_t)(region + 1);
+    return 0;
+}
+
+void cpu_vaciar_es(CPU *cpu)
+{
+    unsigned vaciadas = 0;      // Bit por región: cada una se vacía una vez
+    for (unsigned p = 0; p < NUM_PAGINAS; p++) {
+        unsigned t = cpu->tipo_pagina[p];
+        if (!t || (vaciadas >> t) & 1) continue;
+        vaciadas |= 1u << t;
+        const DispositivoES *d = &cpu->regiones_es[t - 1].dispositivo;
+        if (d->vaciar) d->vaciar(d->datos);
+    }
+}
+
+// Fuera de línea: los accesos a RAM no cargan con el código del dispositivo
+static __attribute__((noinline)) uint16_t leer_es(CPU *cpu, uint16_t dir)
+{
+    const RegionES *r = &cpu->regiones_es[cpu->tipo_pagina[dir >> BITS_PAGINA] - 1];
+    if (!r->dispositivo.leer) return 0;
+    return r->dispositivo.leer(cpu, r->dispositivo.datos, (uint16_t)(dir - r->base));
+}
+
+static __attribute__((noinline)) void escribir_es(CPU *cpu, uint16_t dir, uint16_t valor)
+{
+    const RegionES *r = &cpu->regiones_es[cpu->tipo_pagina[dir >> BITS_PAGINA] - 1];
+    if (r->dispositivo.escribir) {
+        r->dispositivo.escribir(cpu, r->dispositivo.datos, (uint16_t)(dir - r->base), valor);
+    }
+}
+
+static __attribute__((noinline)) void dato_es(CPU *cpu, uint8_t reg, uint16_t dir,
+                                              void (*inmediata)(CPU *, uint8_t, uint16_t))
+{
+    inmediata(cpu, reg, leer_es(cpu, dir));
+}
+
+/*
+ Ejecuta la versión inmediata de una instrucción con su dato: mem[dir] o,
+ en una página de E/S, lo que dé el dispositivo. La E/S se sale por una
+ llamada final a dato_es, así que el camino de la RAM no necesita ni marco
+ de pila
+ */
+static inline void con_dato(CPU *cpu, uint8_t reg, uint16_t dir,
+                            void (*inmediata)(CPU *, uint8_t, uint16_t))
+{
+    if (__builtin_expect(cpu->tipo_pagina[dir >> BITS_PAGINA], 0)) {
+        dato_es(cpu, reg, dir, inmediata);
+        return;
+    }
+    inmediata(cpu, reg, cpu->mem[dir]);
+}
+
+
+// IMPLEMENTACIÓN DE LAS INSTRUCCIONES
+// ===================================
+
+/*
+ ST - STORE: Almacena el valor de un registro en memoria
+ - cpu Puntero a la estructura CPU
+ - reg Registro fuente (0=X, 1=ACC)
+ - eff_addr Dirección de memoria destino
+
+ mem[eff_addr] = registro
+ No afecta a ningún flag. Actualiza la marca de agua de la memoria; en una
+ página de E/S se lo da al dispositivo
+*/
+void store_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    if (__builtin_expect(cpu->tipo_pagina[eff_addr >> BITS_PAGINA], 0)) {
+        escribir_es(cpu, eff_addr, reg ? cpu->acc : cpu->x);   // No mueve la marca de agua
+        return;
+    }
+    if (reg) {
+        cpu->mem[eff_addr] = cpu->acc;  // Almacena ACC en memoria
+    } else {
+        cpu->mem[eff_addr] = cpu->x;    // Almacena X en memoria
+    }
+    if (eff_addr > cpu->mem_hwm) cpu->mem_hwm = eff_addr;
+}
+
+/*
+LD - LOAD: Carga un valor de memoria a un registro
+Afecta al flag Z, basado en el valor cargado
+
+Las instrucciones que leen un dato tienen dos versiones: la de memoria lee
+mem[eff_addr] (o el dispositivo de su página) y llama a la inmediata (I=1),
+que recibe el valor directamente
+*/
+void load_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, load_immediate);
+}
+
+void load_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    if (reg) {
+        cpu->acc = valor;                 // Carga el valor en ACC
+        cpu->status.z = (cpu->acc == 0);  // Actualiza flag Z basado en ACC
+    } else {
+        cpu->x = valor;                   // Carga el valor en X
+        cpu->status.z = (cpu->x == 0);    // Actualiza flag Z basado en X
+    }
+}
+
+/*
+ Flags de la ALU. Z y N salen del resultado; en la suma C es el acarreo
+ del bit 15 y en la resta el préstamo (registro < operando sin signo); V
+ es el desbordamiento en complemento a 2. Las operaciones lógicas y los
+ desplazamientos (salvo el C de estos) dejan C y V a 0.
+ */
+static inline void flags_resultado(CPU *cpu, uint16_t r)
+{
+    cpu->status.z = (r == 0);
+    cpu->status.n = r >> 15;
+}
+
+static inline uint16_t suma(CPU *cpu, uint16_t a, uint16_t b)
+{
+    uint32_t r = (uint32_t)a + b;
+    flags_resultado(cpu, (uint16_t)r);
+    cpu->status.c = r >> 16;
+    cpu->status.v = ((~(a ^ b) & (a ^ r)) >> 15) & 1;
+    return (uint16_t)r;
+}
+
+static inline uint16_t resta(CPU *cpu, uint16_t a, uint16_t b)
+{
+    uint16_t r = a - b;
+    flags_resultado(cpu, r);
+    cpu->status.c = a < b;
+    cpu->status.v = ((a ^ b) & (a ^ r)) >> 15;
+    return r;
+}
+
+static inline uint16_t logica(CPU *cpu, uint16_t r)
+{
+    flags_resultado(cpu, r);
+    cpu->status.c = 0;
+    cpu->status.v = 0;
+    return r;
+}
+
+// Registro seleccionado por el bit R (0=X, 1=ACC)
+static inline uint16_t *registro(CPU *cpu, uint8_t reg)
+{
+    return reg ? &cpu->acc : &cpu->x;
+}
+
+/*
+ADD - ADD: Suma un valor de memoria a un registro
+registro = registro + mem[eff_addr]
+Afecta a los flags Z, N, C y V
+*/
+void add_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, add_immediate);
+}
+
+void add_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = suma(cpu, *r, valor);
+}
+
+/*
+BR - BRANCH: Salto incondicional a una dirección
+pc = eff_addr
+NOTA: Decrementamos pc porque después se incrementa en el ciclo principal
+*/
+void branch_jump(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    cpu->pc = eff_addr;      // Salto a la dirección especificada
+    cpu->pc--;         // Compensación por el incremento posterior en el ciclo
+}
+
+/*
+BZ - BRANCH IF ZERO: Salto condicional si Z flag está activo
+Operación ==> if (Z) then pc = eff_addr
+*/
+void branch_if_zero(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    if (cpu->status.z) { 
+        cpu->pc = eff_addr;    
+        cpu->pc--;          // Compensación por el incremento posterior
+    }
+}
+
+/*
+CLR - CLEAR: Pone a cero un registro
+Z siempre se activa porque el resultado es 0
+*/
+void clear_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    if (reg) {
+        cpu->acc = 0;      // Limpia ACC
+    } else {
+        cpu->x = 0;        // Limpia X
+    }
+    cpu->status.z = 1;     // Siempre activa Z flag (resultado es 0)
+}
+
+/*
+DEC - DECREMENT: Decrementa un registro en 1
+*/
+void decrement_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    if (reg) {
+        cpu->acc--;                    // Decrementa ACC
+        cpu->status.z = (cpu->acc == 0); // Actualiza Z flag
+    } else {
+        cpu->x--;                      // Decrementa X  
+        cpu->status.z = (cpu->x == 0);   // Actualiza Z flag
+    }
+}
+
+// INSTRUCCIONES DE LA ALU
+// =======================
+
+/*
+SUB - SUBTRACT: Resta un valor de memoria a un registro
+registro = registro - mem[eff_addr]
+Afecta a los flags Z, N, C (préstamo) y V
+*/
+void sub_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, sub_immediate);
+}
+
+void sub_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = resta(cpu, *r, valor);
+}
+
+/*
+AND, OR, XOR - Operaciones lógicas bit a bit con un valor de memoria
+registro = registro op mem[eff_addr]
+Afectan a Z y N; C y V quedan a 0
+*/
+void and_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, and_immediate);
+}
+
+void and_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = logica(cpu, *r & valor);
+}
+
+void or_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, or_immediate);
+}
+
+void or_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = logica(cpu, *r | valor);
+}
+
+void xor_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, xor_immediate);
+}
+
+void xor_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = logica(cpu, *r ^ valor);
+}
+
+/*
+CMP - COMPARE: Resta sin guardar el resultado, solo cambia los flags
+Z = (registro == mem[eff_addr]); C = (registro < mem[eff_addr]) sin signo
+*/
+void compare_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, compare_immediate);
+}
+
+void compare_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    resta(cpu, *registro(cpu, reg), valor);
+}
+
+/*
+SHL, SHR - SHIFT: Desplaza un registro tantos bits como indique mem[eff_addr]
+(solo cuentan sus 4 bits bajos: 0-15). SHR es lógico (entran ceros).
+Afectan a Z y N; C es el último bit que sale (0 si no se desplaza) y V = 0
+*/
+void shift_left(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, shift_left_immediate);
+}
+
+void shift_left_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    unsigned n = valor & 0xF;
+    uint8_t c = n ? (*r >> (16 - n)) & 1 : 0;
+    *r = logica(cpu, (uint16_t)(*r << n));
+    cpu->status.c = c;
+}
+
+void shift_right(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, shift_right_immediate);
+}
+
+void shift_right_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    unsigned n = valor & 0xF;
+    uint8_t c = n ? (*r >> (n - 1)) & 1 : 0;
+    *r = logica(cpu, *r >> n);
+    cpu->status.c = c;
+}
+
+/*
+MUL - MULTIPLY: Multiplica un registro por un valor de memoria (sin signo)
+registro = 16 bits bajos de registro * mem[eff_addr]
+Afecta a Z y N; C y V se activan si el producto no cabe en 16 bits
+*/
+void mul_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, mul_immediate);
+}
+
+void mul_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    uint32_t producto = (uint32_t)*r * valor;
+    *r = logica(cpu, (uint16_t)producto);
+    cpu->status.c = cpu->status.v = producto > 0xFFFF;
+}
+
+/*
+DIV, MOD - DIVIDE: Cociente y resto de la división sin signo de un
+registro entre un valor de memoria
+Afectan a Z y N; C = 0. Dividir entre 0 no para la CPU: activa V, DIV
+deja 0xFFFF y MOD deja el registro como estaba (como RISC-V)
+*/
+void div_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, div_immediate);
+}
+
+void div_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = logica(cpu, valor ? *r / valor : 0xFFFF);
+    cpu->status.v = valor == 0;
+}
+
+void mod_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    con_dato(cpu, reg, eff_addr, mod_immediate);
+}
+
+void mod_immediate(CPU *cpu, uint8_t reg, uint16_t valor) {
+    uint16_t *r = registro(cpu, reg);
+    *r = logica(cpu, valor ? *r % valor : *r);
+    cpu->status.v = valor == 0;
+}
+
+/*
+Opcodes sin asignar (y los que no admiten operando inmediato con I=1): no
+hacen nada, solo consumen su ciclo. Así ninguna palabra de memoria se sale
+de las tablas al ejecutarla
+*/
+void reserved_op(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+}
+
+// SUBRUTINAS Y PILA
+// =================
+
+/*
+ La pila crece hacia abajo: apilar es mem[--sp] = valor y desapilar valor =
+ mem[sp++], con sp dando la vuelta dentro de la memoria (la primera palabra
+ apilada con sp = 0 es mem[4095]). No hay comprobación de desbordamiento:
+ una pila demasiado profunda pisa lo que haya debajo, como en la máquina.
+ */
+static inline void apilar(CPU *cpu, uint16_t valor)
+{
+    cpu->sp = (cpu->sp - 1) & (MEM_SIZE - 1);
+    cpu->mem[cpu->sp] = valor;
+}
+
+static inline uint16_t desapilar(CPU *cpu)
+{
+    uint16_t valor = cpu->mem[cpu->sp];
+    cpu->sp = (cpu->sp + 1) & (MEM_SIZE - 1);
+    return valor;
+}
+
+/*
+JSR - JUMP TO SUBROUTINE: Apila la dirección de vuelta y salta
+mem[--sp] = dirección de la instrucción siguiente; pc = eff_addr
+En formato largo pc ya apunta a la segunda palabra, así que pc + 1 es la
+siguiente instrucción en los dos formatos. No afecta a los flags
+*/
+void jump_subroutine(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    apilar(cpu, (cpu->pc + 1) & (MEM_SIZE - 1));
+    cpu->pc = eff_addr;
+    cpu->pc--;         // Compensación por el incremento posterior en el ciclo
+}
+
+/*
+PUSH - Apila un registro: mem[--sp] = registro
+No afecta a los flags
+*/
+void push_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    apilar(cpu, *registro(cpu, reg));
+}
+
+/*
+POP - Desapila en un registro: registro = mem[sp++]
+Afecta al flag Z, como LD
+*/
+void pop_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    uint16_t *r = registro(cpu, reg);
+    *r = desapilar(cpu);
+    cpu->status.z = (*r == 0);
+}
+
+// INSTRUCCIONES DE BLOQUE
+// =======================
+
+/*
+ Copia n palabras de mem[origen] a mem[destino] como si pasaran por un
+ buffer intermedio (la semántica de memmove): si los bloques se solapan, el
+ destino recibe el contenido original del origen. Los dos bloques dan la
+ vuelta al final de la memoria como cualquier dirección (n <= MEM_SIZE).
+ Sin vuelta es un solo memmove (la libc usa SIMD); con vuelta se copia a un
+ buffer en dos trozos y de ahí al destino en otros dos.
+
+ Los motores decodifican cada instrucción de mem[pc] al ejecutarla y no
+ guardan código predecodificado, así que un bloque que sobrescribe código
+ se ve en la siguiente instrucción sin invalidar nada.
+ */
+static void mover_bloque(CPU *cpu, uint16_t origen, uint16_t destino, unsigned n)
+{
+    if (origen + n <= MEM_SIZE && destino + n <= MEM_SIZE) {
+        memmove(&cpu->mem[destino], &cpu->mem[origen], n * sizeof(uint16_t));
+        return;
+    }
+    uint16_t buffer[MEM_SIZE];
+    unsigned primero = MEM_SIZE - origen;     // Palabras hasta el final de la memoria
+    if (primero > n) primero = n;
+    memcpy(buffer, &cpu->mem[origen], primero * sizeof(uint16_t));
+    memcpy(buffer + primero, cpu->mem, (n - primero) * sizeof(uint16_t));
+    primero = MEM_SIZE - destino;
+    if (primero > n) primero = n;
+    memcpy(&cpu->mem[destino], buffer, primero * sizeof(uint16_t));
+    memcpy(cpu->mem, buffer + primero, (n - primero) * sizeof(uint16_t));
+}
+
+// Escribe valor en p[0..n) copiando un patrón de 32 palabras con memcpy de
+// tamaño fijo, que el compilador convierte en escrituras SIMD de 16 bytes
+static void rellenar(uint16_t *p, uint16_t valor, unsigned n)
+{
+    uint16_t patron[32];
+    unsigned i = 0;
+    for (int k = 0; k < 32; k++) patron[k] = valor;
+    for (; i + 32 <= n; i += 32) memcpy(p + i, patron, sizeof(patron));
+    memcpy(p + i, patron, (n - i) * sizeof(uint16_t));
+}
+
+// Marca de agua tras escribir n palabras desde destino (toda la memoria si da la vuelta)
+static inline void marcar_bloque(CPU *cpu, uint16_t destino, unsigned n)
+{
+    unsigned ultima = destino + n - 1;
+    if (ultima >= MEM_SIZE) ultima = MEM_SIZE - 1;
+    if (n && ultima > cpu->mem_hwm) cpu->mem_hwm = (uint16_t)ultima;
+}
+
+/*
+MOVE - Copia un bloque de memoria
+mem[eff_addr..] = mem[registro..], tantas palabras como diga el otro registro
+(MOVE ACC,[d]: origen ACC y cuenta X; MOVE X,[d]: origen X y cuenta ACC)
+No cambia registros ni flags; cuesta 2 ciclos por palabra (ciclos_extra)
+*/
+void move_block(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    unsigned n = bloque_palabras(reg, cpu->acc, cpu->x);
+    mover_bloque(cpu, *registro(cpu, reg) & (MEM_SIZE - 1), eff_addr, n);
+    marcar_bloque(cpu, eff_addr, n);
+    cpu->ciclos += 2 * n;
+}
+
+/*
+FILL - Rellena un bloque de memoria con el valor de un registro
+mem[eff_addr..] = registro, tantas palabras como diga el otro registro
+No cambia registros ni flags; cuesta 1 ciclo por palabra (ciclos_extra)
+*/
+void fill_block(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    unsigned n = bloque_palabras(reg, cpu->acc, cpu->x);
+    unsigned primero = MEM_SIZE - eff_addr;   // Palabras hasta el final de la memoria
+    if (primero > n) primero = n;
+    rellenar(&cpu->mem[eff_addr], *registro(cpu, reg), primero);
+    rellenar(cpu->mem, *registro(cpu, reg), n - primero);   // Lo que da la vuelta
+    marcar_bloque(cpu, eff_addr, n);
+    cpu->ciclos += n;
+}
+
+// INTERRUPCIONES
+// ==============
+
+/*
+ Entra en la rutina de la línea pedida más prioritaria (ver CONTROLADOR DE
+ INTERRUPCIONES en cpu.h): apila el PC, que es el de la instrucción a la que
+ se vuelve, y los flags, pone I = 0 y salta al vector
+ */
+static void entrar_interrupcion(CPU *cpu)
+{
+    unsigned linea = 0;
+    while (!((cpu->irq >> linea) & 1)) linea++;
+    cpu->irq &= ~(1u << linea);
+    apilar(cpu, cpu->pc);
+    apilar(cpu, status_flags(&cpu->status));
+    cpu->status.i = 0;
+    cpu->pc = cpu->mem[INT_VECTORES + linea] & (MEM_SIZE - 1);
+    cpu->ciclos += CICLOS_INTERRUPCION;
+}
+
+void cpu_interrumpir(CPU *cpu, unsigned linea)
+{
+    linea %= INT_LINEAS;
+    if (cpu->grabacion) {
+        if (cpu->grabacion->reproduciendo) return;
+        grabacion_entrada(cpu->grabacion, cpu, GRAB_INTERRUPCION, linea, 0);
+    }
+    cpu->irq |= 1u << linea;
+}
+
+int cpu_atender_interrupcion(CPU *cpu)
+{
+    if (!cpu->irq || !cpu->status.i || cpu->status.h) return 0;
+    entrar_interrupcion(cpu);
+    return 1;
+}
+
+/*
+RTI - RETURN FROM INTERRUPT: Vuelve de una rutina de interrupción
+flags = mem[sp++]; pc = mem[sp++]. Si los flags recuperados tienen I = 1 y
+hay otra línea pedida, se entra en su rutina sin ejecutar nada en medio
+*/
+void return_interrupt(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    set_status_flags(&cpu->status, (uint8_t)(desapilar(cpu) & ~TRAZA_FLAG_H));
+    cpu->pc = desapilar(cpu) & (MEM_SIZE - 1);
+    if (cpu->status.i && cpu->irq) entrar_interrupcion(cpu);
+    cpu->pc--;            // Compensación por el incremento posterior
+}
+
+// INSTRUCCIONES EXTENDIDAS
+// ========================
+
+/*
+HALT - DETENER: Detiene la ejecución de la CPU
+*/
+void halt_cpu(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    cpu->status.h = 1;    // Activa Halt Flag
+    cpu->pc--;            // Mantiene pc en la misma instrucción
+}
+
+/*
+EI - ENABLE INTERRUPTS: Habilita las interrupciones
+*/
+void enable_int(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    cpu->status.i = 1;    // Activa Interrupt Flag
+    if (cpu->irq) {
+        // Una línea pendiente se atiende antes de la instrucción siguiente
+        cpu->pc = (cpu->pc + 1) & (MEM_SIZE - 1);
+        entrar_interrupcion(cpu);
+        cpu->pc--;
+    }
+}
+
+/*
+DI - DISABLE INTERRUPTS: Deshabilita las interrupciones  
+*/
+void disable_int(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    cpu->status.i = 0;    // Desactiva Interrupt Flag
+}
+
+/*
+RTS - RETURN FROM SUBROUTINE: Vuelve a la dirección que apiló JSR
+pc = mem[sp++]. Suma el ciclo de leer la pila, que la tabla de ciclos no
+puede distinguir de EI (ver ciclos_extra)
+*/
+void return_subroutine(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
+    cpu->pc = desapilar(cpu);
+    cpu->pc--;            // Compensación por el incremento posterior
+    cpu->ciclos++;
+}
+
+// FUNCIONES PRINCIPALES DE LA CPU
+// ===============================
+
+/*
+ resetCPU - Inicializa la CPU a estado conocido
+ cpu Puntero a la estructura CPU a resetear
+
+ - Limpia toda la memoria (pone a 0)
+ - Pone todos los registros a 0
+ - Pone pc a 0 (inicio del programa)
+ - Desactiva todos los flags de estado
+ - Pone las latencias por defecto del modelo de ciclos
+ */
+void resetCPU(CPU *cpu)
+{
+    memset(cpu, 0, sizeof(CPU));
+    cpu->pc = 0;
+    memcpy(cpu->ciclos_latencia, ciclos_latencia_defecto, sizeof(cpu->ciclos_latencia));
+}
+
+/*
+FASE 1: Obtiene y decodifica una instrucción
+ cpu Puntero a la estructura CPU
+ ctx Puntero al contexto donde almacenar la instrucción decodificada
+
+ Esta función:
+ 1. Obtiene la instrucción de mem[pc] (y en formato largo la dirección de mem[pc + 1])
+ 2. Decodifica todos los campos de la instrucción
+ 3. Calcula la dirección efectiva según el modo de direccionamiento
+ 4. Identifica si es instrucción extendida
+
+ Las direcciones se reducen al tamaño de la memoria: una dirección larga o
+ un índice que se pasa de MEM_SIZE da la vuelta en lugar de salirse.
+ */
+void fetch_and_decode(CPU *cpu, InstructionContext *ctx) {
+    //FETCH - Obtener instrucción de la memoria en la posición pc
+    uint16_t inst_code = cpu->mem[cpu->pc];
+    ctx->inst_code = inst_code;
+    
+    //DECODE - Extraer todos los campos de la instrucción
+    ctx->opcode = (inst_code >> OPCODE_SHIFT) & OPCODE_MASK;  // Bits 9-12
+    ctx->reg = (inst_code >> 8) & 0x1;                        // Bit 8
+    ctx->addr_mode = (inst_code >> 6) & 0x3;                  // Bits 6-7
+    ctx->address = inst_code & 0x3F;                          // Bits 0-5
+    if (inst_code & LARGO_BIT) {
+        // Formato largo: la dirección completa está en la palabra siguiente
+        ctx->address = cpu->mem[(cpu->pc + 1) & (MEM_SIZE - 1)];
+    }
+    
+    //CALCULAR DIRECCIÓN EFECTIVA según modo de direccionamiento
+    ctx->eff_addr = ctx->address;  // Por defecto: direccionamiento directo (addr_mode = 00)
+
+    if (ctx->addr_mode == 0x1) { // Aqui estamos haciendo una comparacion de addr_mode con una mascara para ver
+                            // si es igual a 01 que correspondería a modo indirecto en los bits 6-7
+        // Modo Indirecto: EA = contenido de mem[address]
+        ctx->eff_addr = cpu->mem[ctx->address & (MEM_SIZE - 1)];
+    }
+    else if (ctx->addr_mode == 0x2) {
+        // Modo Indexado: EA = address + registro X
+        ctx->eff_addr = ctx->address + cpu->x;
+    }
+    else if (ctx->addr_mode == 0x3) {
+        // Modo Indirecto Indexado: EA = contenido de mem[address + X]
+        ctx->eff_addr = cpu->mem[(ctx->address + cpu->x) & (MEM_SIZE - 1)];
+    }
+    ctx->eff_addr &= MEM_SIZE - 1;
+    
+    //IDENTIFICAR INSTRUCCIÓN EXTENDIDA
+    ctx->is_extended = (ctx->opcode == 7);
+    if (ctx->is_extended) {
+        ctx->ext_opcode = (inst_code >> EXT_SHIFT) & EXT_MASK;
+    }
+}
+
+/*
+FASE 2: Ejecuta una instrucción ya decodificada
+ cpu Puntero a la estructura CPU
+ ctx Contexto rellenado por fetch_and_decode()
+
+ Flujo:
+ 1. Reinicia Zero Flag (según convención)
+ 2. Ejecuta la instrucción usando las tablas (con I=1, immediate_set con el literal)
+ 3. Incrementa el contador de programa, el de instrucciones y los ciclos
+
+ En formato largo pc avanza antes a la segunda palabra: así el pc++ final
+ salta las dos y los saltos, que ponen pc = destino - 1, no cambian. Los
+ ciclos salen de la palabra de instrucción (ciclos_instruccion).
+ */
+static inline void ejecutar(CPU *cpu, const InstructionContext *ctx)
+{
+    // Reiniciar Zero Flag al inicio de cada instrucción, debido a que algunas instrucciones podrian no modificarlo y eso conllevaria a errores
+    // BZ es la excepción: necesita ver el Z que dejó la instrucción anterior
+    if (ctx->is_extended || ctx->opcode != 4) {
+        cpu->status.z = 0;
+    }
+    if (ctx->inst_code & LARGO_BIT) cpu->pc++;   // En formato corto no se toca pc
+    
+    //EXECUTE - Usar tablas para ejecutar la instrucción correcta
+    if (ctx->is_extended) {
+        extended_set[ctx->ext_opcode].execute(cpu, ctx->reg, ctx->eff_addr);
+    } else if (ctx->inst_code & INMEDIATO_BIT) {
+        immediate_set[ctx->opcode].execute(cpu, ctx->reg, ctx->address);   // El literal
+    } else {
+        instruction_set[ctx->opcode].execute(cpu, ctx->reg, ctx->eff_addr);
+    }
+    
+    // Avanzar a la siguiente instrucción (a menos que instrucción modifique pc);
+    // al final de la memoria se vuelve a mem[0]
+    cpu->pc = (cpu->pc + 1) & (MEM_SIZE - 1);
+    cpu->icount++;
+    cpu->ciclos += ciclos_instruccion(cpu->ciclos_latencia, ctx->inst_code);
+}
+
+// execute_decoded es la versión pública; los motores usan ejecutar(), que el
+// compilador integra en sus bucles
+void execute_decoded(CPU *cpu, InstructionContext *ctx)
+{
+    ejecutar(cpu, ctx);
+}
+
+/*
+ execute_instruction - Ciclo completo de una instrucción
+ cpu Puntero a la estructura CPU
+
+ FETCH & DECODE con fetch_and_decode() y EXECUTE con execute_decoded().
+ No escribe nada: los motores paso a paso muestran la instrucción con
+ printInstruction() y el modo traza la registra en binario.
+ */
+void execute_instruction(CPU *cpu)
+{
+    InstructionContext ctx;  // Contexto para esta instrucción
+    
+    fetch_and_decode(cpu, &ctx);
+    ejecutar(cpu, &ctx);
+}
+
+/*
+ status_flags - Empaqueta los flags en un byte (bits TRAZA_FLAG_Z, TRAZA_FLAG_N...)
+ */
+uint8_t status_flags(const Status *status)
+{
+    return (status->z ? TRAZA_FLAG_Z : 0) | (status->n ? TRAZA_FLAG_N : 0) |
+           (status->c ? TRAZA_FLAG_C : 0) | (status->i ? TRAZA_FLAG_I : 0) |
+           (status->v ? TRAZA_FLAG_V : 0) | (status->h ? TRAZA_FLAG_H : 0);
+}
+
+/*
+ set_status_flags - Inverso de status_flags: desempaqueta un byte de flags
+ */
+void set_status_flags(Status *status, uint8_t flags)
+{
+    status->z = (flags & TRAZA_FLAG_Z) != 0;
+    status->n = (flags & TRAZA_FLAG_N) != 0;
+    status->c = (flags & TRAZA_FLAG_C) != 0;
+    status->i = (flags & TRAZA_FLAG_I) != 0;
+    status->v = (flags & TRAZA_FLAG_V) != 0;
+    status->h = (flags & TRAZA_FLAG_H) != 0;
+}
+
+/*
+ cpu_hash - Hash de 64 bits del estado arquitectónico de la CPU
+ Memoria, registros (también sp), flags, líneas de interrupción pedidas e
+ icount (FNV-1a sobre palabras de 64 bits). Con el temporizador en marcha
+ entran además su programación y los ciclos, de los que depende cuándo vence,
+ y con el generador aleatorio de la E/S en uso, su estado.
+ Se calcula campo a campo para no depender del relleno de la estructura.
+ */
+uint64_t cpu_hash(const CPU *cpu)
+{
+    const uint64_t primo = 0x100000001b3ull;
+    uint64_t h = 0xcbf29ce484222325ull;
+    uint64_t palabra;
+
+    for (size_t i = 0; i < MEM_SIZE; i += 4) {
+        memcpy(&palabra, &cpu->mem[i], sizeof(palabra));
+        h = (h ^ palabra) * primo;
+    }
+    palabra = (uint64_t)cpu->acc | (uint64_t)cpu->x << 16 | (uint64_t)cpu->pc << 32 |
+              (uint64_t)status_flags(&cpu->status) << 48 | (uint64_t)cpu->irq << 56;
+    h = (h ^ palabra) * primo;
+    h = (h ^ cpu->sp) * primo;
+    h = (h ^ cpu->icount) * primo;
+    if (cpu->temporizador.periodo) {
+        h = (h ^ (cpu->temporizador.periodo | (uint64_t)cpu->temporizador.linea << 32)) * primo;
+        h = (h ^ cpu->ciclos) * primo;
+    }
+    if (cpu->aleatorio) h = (h ^ cpu->aleatorio) * primo;
+    return h;
+}
+
+/*
+ Registra en la traza una instrucción recién ejecutada
+ pc: dirección de la instrucción (cpu->pc ya apunta a la siguiente)
+ */
+static inline void registrar_traza(Traza *traza, CPU *cpu, const InstructionContext *ctx,
+                                   uint16_t pc)
+{
+    RegistroTraza r;
+    r.pc = pc;
+    r.raw = ctx->inst_code;
+    r.eff_addr = ctx->eff_addr;
+    r.acc = cpu->acc;
+    r.x = cpu->x;
+    r.flags = status_flags(&cpu->status);
+    r.reservado = 0;
+    traza_emitir(traza, &r);
+}
+
+/*
+ printInstruction - Muestra la instrucción decodificada que se va a ejecutar
+ cpu Puntero a la estructura CPU
+ ctx Contexto rellenado por fetch_and_decode()
+ */
+void printInstruction(CPU *cpu, const InstructionContext *ctx)
+{
+    printf("DEBUG: op: %x, reg: %x, dirm: %x, cd: %x, ea: %x, data: %d\n", 
+           ctx->opcode, ctx->reg, ctx->addr_mode, ctx->address, ctx->eff_addr, ctx->eff_addr);
+    if (ctx->is_extended) {
+        printf("Executing ext %s %x, %x\n", extended_set[ctx->ext_opcode].name, ctx->reg, ctx->eff_addr);
+    } else if (ctx->inst_code & INMEDIATO_BIT) {
+        printf("Executing %s %x, #%x\n", immediate_set[ctx->opcode].name, ctx->reg, ctx->address);
+    } else {
+        printf("Executing %s %x, %x\n", instruction_set[ctx->opcode].name, ctx->reg, ctx->eff_addr);
+    }
+}
+
+/*
+ step_and_show - Un paso de los motores interactivos
+ Decodifica, muestra la instrucción, la ejecuta y la registra en la traza.
+ Si el mapa de fuente conoce la dirección, muestra la línea del .asm en
+ lugar de los campos decodificados.
+ */
+static void step_and_show(CPU *cpu, Herramientas *h)
+{
+    InstructionContext ctx;
+    uint16_t pc = cpu->pc;
+    const char *ubicacion = mapa_ubicacion(h->mapa, pc);
+
+    fetch_and_decode(cpu, &ctx);
+    if (ubicacion) printf("Executing %s (ea: %x)\n", ubicacion, ctx.eff_addr);
+    else printInstruction(cpu, &ctx);
+    execute_decoded(cpu, &ctx);
+    if (h->traza) registrar_traza(h->traza, cpu, &ctx, pc);
+}
+
+/*
+ printCPUState - Muestra el estado actual de la CPU
+ cpu Puntero a la estructura CPU
+
+ Muestra:
+ - Valores de registros principales (PC, X, ACC)
+ - Estado de todos los flags y las líneas de interrupción pendientes
+ - Memoria hasta la marca de agua + 10 palabras (mínimo 30)
+ - La pila, si no está vacía
+ */
+void printCPUState(CPU *cpu)
+{
+    // Registros principales
+    printf("PC:%x X:%x ACC:%x SP:%x\n", cpu->pc, cpu->x, cpu->acc, cpu->sp);
+    
+    // Flags de estado
+    printf("STATUS: [Z:%x N:%x C:%x I:%x V:%x H:%x]\n", 
+           cpu->status.z, cpu->status.n, cpu->status.c, 
+           cpu->status.i, cpu->status.v, cpu->status.h);
+    if (cpu->irq) printf("IRQ: %x\n", cpu->irq);    // Líneas pendientes
+
+    // Hasta dónde hay datos en memoria: la marca de agua evita recorrerla entera
+    int max_used = cpu->mem_hwm;
+    
+    // Mostrar memoria usada + margen (mínimo 20 palabras)
+    int words_to_show = (max_used + 10 > 30) ? max_used + 10 : 30;
+    if (words_to_show > MEM_SIZE) words_to_show = MEM_SIZE;
+    
+    printf("Memory [0-%d]: ", words_to_show - 1);
+    for (int i = 0; i < words_to_show; i++)
+    {
+        printf("%x ", cpu->mem[i]);
+        if (i % 10 == 9) {
+            printf("\n");
+            if (i < words_to_show - 1) printf("               ");
+        }
+    }
+    printf("\n");
+
+    // La pila, desde la cima (como mucho PALABRAS_PILA palabras)
+    if (cpu->sp) {
+        unsigned fin = cpu->sp + PALABRAS_PILA < MEM_SIZE ? cpu->sp + PALABRAS_PILA : MEM_SIZE;
+        printf("Stack [%d-%d]: ", cpu->sp, MEM_SIZE - 1);
+        for (unsigned i = cpu->sp; i < fin; i++) printf("%x ", cpu->mem[i]);
+        if (fin < MEM_SIZE) printf("...");
+        printf("\n");
+    }
+    printf("---\n");
+}
+
+/*
+ Punto de control tras cada paso de los motores interactivos
+ Devuelve -1 si hay que parar (la reproducción divergió)
+ */
+static inline int punto_control(CPU *cpu, Herramientas *h)
+{
+    return h->grabacion ? grabacion_punto(h->grabacion, cpu) : 0;
+}
+
+// PLANIFICADOR DE EVENTOS
+// =======================
+
+// Orden del montículo: por ciclo y, si coinciden, por dispositivo
+static inline int antes(const EventoDispositivo *a, const EventoDispositivo *b)
+{
+    return a->ciclo < b->ciclo || (a->ciclo == b->ciclo && a->dispositivo < b->dispositivo);
+}
+
+static void subir(Planificador *p, unsigned i)
+{
+    EventoDispositivo e = p->eventos[i];
+    while (i > 0 && antes(&e, &p->eventos[(i - 1) / 2])) {
+        p->eventos[i] = p->eventos[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    p->eventos[i] = e;
+}
+
+static void bajar(Planificador *p, unsigned i)
+{
+    EventoDispositivo e = p->eventos[i];
+    for (;;) {
+        unsigned hijo = 2 * i + 1;
+        if (hijo >= p->num) break;
+        if (hijo + 1 < p->num && antes(&p->eventos[hijo + 1], &p->eventos[hijo])) hijo++;
+        if (!antes(&p->eventos[hijo], &e)) break;
+        p->eventos[i] = p->eventos[hijo];
+        i = hijo;
+    }
+    p->eventos[i] = e;
+}
+
+// Quita eventos[i] poniendo en su sitio el último
+static void quitar_evento(Planificador *p, unsigned i)
+{
+    p->eventos[i] = p->eventos[--p->num];
+    if (i < p->num) {
+        bajar(p, i);
+        subir(p, i);
+    }
+}
+
+void cpu_cancelar_evento(CPU *cpu, Dispositivo d)
+{
+    Planificador *p = &cpu->planificador;
+    for (unsigned i = 0; i < p->num; i++) {
+        if (p->eventos[i].dispositivo == d) {
+            quitar_evento(p, i);
+            return;
+        }
+    }
+}
+
+void cpu_planificar(CPU *cpu, Dispositivo d, uint64_t ciclo)
+{
+    Planificador *p = &cpu->planificador;
+    cpu_cancelar_evento(cpu, d);
+    p->eventos[p->num].ciclo = ciclo;
+    p->eventos[p->num].dispositivo = (uint8_t)d;
+    subir(p, p->num++);
+    cpu->fin_tramo = 0;       // Si se está ejecutando un tramo, que no se lo salte
+}
+
+/*
+ Temporizador: pide su línea y se vuelve a planificar un periodo después
+ del ciclo en el que debía vencer (no del actual), así que no acumula
+ retraso. Los vencimientos que ya pasaron se saltan.
+ */
+static void evento_temporizador(CPU *cpu, uint64_t ciclo)
+{
+    uint32_t periodo = cpu->temporizador.periodo;
+    // Es de la propia máquina: no pasa por la grabación
+    cpu->irq |= 1u << cpu->temporizador.linea;
+    cpu_planificar(cpu, DISPOSITIVO_TEMPORIZADOR,
+                   ciclo + periodo * ((cpu->ciclos - ciclo) / periodo + 1));
+}
+
+void cpu_temporizador(CPU *cpu, uint32_t periodo, unsigned linea)
+{
+    cpu->temporizador.periodo = periodo;
+    cpu->temporizador.linea = (uint8_t)(linea % INT_LINEAS);
+    if (periodo) cpu_planificar(cpu, DISPOSITIVO_TEMPORIZADOR, cpu->ciclos + periodo);
+    else cpu_cancelar_evento(cpu, DISPOSITIVO_TEMPORIZADOR);
+}
+
+/*
+ Manejadores de los eventos. Índice: Dispositivo
+ ciclo es el ciclo para el que se pidió el evento (cpu->ciclos puede ir por
+ delante: el tramo acaba al terminar la instrucción que lo alcanza)
+ */
+static void (*const manejadores_evento[NUM_DISPOSITIVOS])(CPU *cpu, uint64_t ciclo) = {
+    evento_temporizador,    // DISPOSITIVO_TEMPORIZADOR
+};
+
+// Ciclo en el que debe terminar el tramo: el del próximo evento
+static inline uint64_t proximo_evento(const CPU *cpu)
+{
+    return cpu->planificador.num ? cpu->planificador.eventos[0].ciclo : UINT64_MAX;
+}
+
+/*
+ Al empezar un tramo (o un paso): atiende los eventos que vencieron y,
+ después, las interrupciones que hayan pedido ellos o alguien de fuera
+ */
+static inline void atender_dispositivos(CPU *cpu)
+{
+    Planificador *p = &cpu->planificador;
+    while (p->num && p->eventos[0].ciclo <= cpu->ciclos) {
+        EventoDispositivo e = p->eventos[0];
+        quitar_evento(p, 0);
+        manejadores_evento[e.dispositivo](cpu, e.ciclo);
+    }
+    cpu_atender_interrupcion(cpu);
+}
+
+void cpu_paso(CPU *cpu)
+{
+    atender_dispositivos(cpu);
+    execute_instruction(cpu);
+}
+
+// EJECUCIÓN POR TRAMOS
+// ====================
+
+/*
+ Los motores ejecutan en tramos: hasta la primera instrucción en la que hay
+ que atender algo (una instantánea del historial, un punto de control de la
+ grabación, el límite pedido). Dentro de un tramo se usa el bucle más simple
+ posible según lo que esté conectado: sin traza ni puntos de parada, solo
+ execute_instruction().
+
+ Con eventos pendientes el tramo termina además al llegar a limite_ciclos
+ (ver PLANIFICADOR DE EVENTOS). Sin ellos tramo_rapido usa un bucle que
+ solo compara icount. El límite de instrucciones se lee de cpu->fin_tramo:
+ un dispositivo que pide un evento en mitad del tramo (al escribir en sus
+ registros) lo pone a 0 para que el tramo acabe tras esa instrucción y el
+ siguiente ya cuente con el evento.
+ */
+
+static void tramo_rapido(CPU *cpu, uint64_t limite, uint64_t limite_ciclos)
+{
+    cpu->fin_tramo = limite;
+    if (limite_ciclos == UINT64_MAX) {
+        while (!cpu->status.h && cpu->icount < cpu->fin_tramo) {
+            execute_instruction(cpu);
+        }
+        return;
+    }
+    while (!cpu->status.h && cpu->icount < cpu->fin_tramo && cpu->ciclos < limite_ciclos) {
+        execute_instruction(cpu);
+    }
+}
+
+static void tramo_trazado(CPU *cpu, Traza *traza, uint64_t limite, uint64_t limite_ciclos)
+{
+    InstructionContext ctx;
+    cpu->fin_tramo = limite;
+    while (!cpu->status.h && cpu->icount < cpu->fin_tramo && cpu->ciclos < limite_ciclos) {
+        uint16_t pc = cpu->pc;
+        fetch_and_decode(cpu, &ctx);
+        ejecutar(cpu, &ctx);
+        registrar_traza(traza, cpu, &ctx, pc);
+    }
+}
+
+/*
+ tramo_vigilado - Ejecuta comprobando los puntos de parada en cada instrucción
+ traza Traza binaria, o NULL
+ desde icount desde el que se continúa: no se vuelve a parar en su breakpoint
+ a Se rellena con el acceso que activó el watchpoint
+ */
+static MotivoParada tramo_vigilado(CPU *cpu, Traza *traza, const PuntosParada *p,
+                                   uint64_t limite, uint64_t limite_ciclos, uint64_t desde,
+                                   AccesoVigilado *a)
+{
+    InstructionContext ctx;
+    cpu->fin_tramo = limite;
+    while (!cpu->status.h && cpu->icount < cpu->fin_tramo && cpu->ciclos < limite_ciclos) {
+        if (cpu->icount != desde && puntos_breakpoint(p, cpu)) return PARADA_BREAKPOINT;
+
+        uint16_t pc = cpu->pc;
+        fetch_and_decode(cpu, &ctx);
+        int vigilado = puntos_accesos(p, cpu, &ctx, a);
+        ejecutar(cpu, &ctx);
+        if (traza) registrar_traza(traza, cpu, &ctx, pc);
+        if (vigilado && punto_cumple(p, a->tipo, a->dir, cpu)) return PARADA_WATCHPOINT;
+    }
+    return cpu->status.h ? PARADA_HALT : PARADA_LIMITE;
+}
+
+/*
+ continuar - Ejecuta sin mostrar nada hasta HALT, un punto de parada o la
+ instrucción número limite
+ hist Historial de instantáneas que mantener, o NULL
+ desde icount en el que no se para por breakpoint (UINT64_MAX: en ninguno)
+ a Se rellena si para en un watchpoint
+
+ Pasa por los puntos de control de la grabación y guarda las instantáneas
+ del historial al final de cada tramo.
+ */
+static MotivoParada continuar(CPU *cpu, Herramientas *h, Historial *hist, uint64_t limite,
+                              uint64_t desde, AccesoVigilado *a)
+{
+    const PuntosParada *p = h->puntos && h->puntos->activos ? h->puntos : NULL;
+
+    while (!cpu->status.h && cpu->icount < limite) {
+        // Eventos e interrupciones: dentro del tramo solo atienden las líneas EI y RTI
+        atender_dispositivos(cpu);
+        uint64_t hasta_ciclo = proximo_evento(cpu);
+
+        uint64_t tramo = limite;
+        if (hist && hist->siguiente < tramo) tramo = hist->siguiente;
+        if (h->grabacion && grabacion_limite(h->grabacion) < tramo) {
+            tramo = grabacion_limite(h->grabacion);
+        }
+
+        MotivoParada motivo = PARADA_LIMITE;
+        if (p) motivo = tramo_vigilado(cpu, h->traza, p, tramo, hasta_ciclo, desde, a);
+        else if (h->traza) tramo_trazado(cpu, h->traza, tramo, hasta_ciclo);
+        else tramo_rapido(cpu, tramo, hasta_ciclo);
+
+        if (hist) historial_anotar(hist, cpu);
+        if (punto_control(cpu, h) < 0) return PARADA_DIVERGENCIA;
+        if (motivo == PARADA_BREAKPOINT || motivo == PARADA_WATCHPOINT) return motivo;
+    }
+    return cpu->status.h ? PARADA_HALT : PARADA_LIMITE;
+}
+
+/*
+ cpu_continuar - continuar() para quien controla la ejecución desde fuera
+ (el servidor GDB): sin historial ni salida
+ desde icount en el que no se para por breakpoint; con cpu->icount se
+ continúa desde una parada sin volver a parar en ella
+ */
+MotivoParada cpu_continuar(CPU *cpu, Herramientas *h, uint64_t limite, uint64_t desde,
+                           AccesoVigilado *a)
+{
+    return continuar(cpu, h, NULL, limite, desde, a);
+}
+
+static void informar_parada(const CPU *cpu, const Herramientas *h, MotivoParada motivo,
+                            const AccesoVigilado *a)
+{
+    if (motivo == PARADA_BREAKPOINT) {
+        const char *ubicacion = mapa_ubicacion(h->mapa, cpu->pc);
+        printf("Breakpoint en pc=%d%s%s (instrucción %llu)\n", cpu->pc, ubicacion ? " " : "",
+               ubicacion ? ubicacion : "", (unsigned long long)cpu->icount);
+    } else if (motivo == PARADA_WATCHPOINT) {
+        const char *ubicacion = mapa_ubicacion(h->mapa, a->dir);
+        printf("Watchpoint de %s mem[%d]: %x -> %x (instrucción %llu)\n",
+               a->tipo == PUNTO_ESCRITURA ? "escritura" : "lectura", a->dir, a->antes,
+               cpu->mem[a->dir], (unsigned long long)cpu->icount);
+        if (ubicacion) printf("  mem[%d] definida en %s\n", a->dir, ubicacion);
+    }
+}
+
+
+// DEPURADOR INTERACTIVO
+// =====================
+
+typedef enum {
+    CMD_PASO,             // ENTER o "s": una instrucción
+    CMD_CONTINUAR,        // "c": hasta HALT o un punto de parada sin mostrar cada paso
+    CMD_ATRAS,            // "rs": deshacer una instrucción
+    CMD_ATRAS_CONTINUAR,  // "rc": hacia atrás hasta el punto de parada anterior
+    CMD_IR,               // "g N": ir a la instrucción número N
+    CMD_SALIR             // "q"
+} Comando;
+
+static void ayuda_depurador(void)
+{
+    printf("Comandos: ENTER/s paso, c continuar, rs paso atrás, rc continuar hacia atrás,\n"
+           "          g N ir a la instrucción N, q salir\n"
+           "          b PC [si COND] breakpoint, w/rw/aw DIR [si COND] watchpoint de\n"
+           "          escritura/lectura/ambos, d PC y dw DIR borrar, l listar\n"
+           "          COND: p. ej. ACC == 0x6, mem[12] != 0 && X < 3\n");
+}
+
+/*
+ Comandos de puntos de parada: no cambian la CPU, así que se atienden sin
+ salir de la pausa. Devuelve 0 si la línea no era uno de ellos.
+ */
+static int comando_puntos(PuntosParada *p, const char *cmd, const char *args)
+{
+    static const struct { const char *nombre; TipoPunto tipo[2]; int n; } poner[] = {
+        {"b", {PUNTO_BREAKPOINT}, 1},
+        {"w", {PUNTO_ESCRITURA}, 1},
+        {"rw", {PUNTO_LECTURA}, 1},
+        {"aw", {PUNTO_LECTURA, PUNTO_ESCRITURA}, 2}
+    };
+    for (size_t i = 0; i < sizeof(poner) / sizeof(poner[0]); i++) {
+        if (strcmp(cmd, poner[i].nombre) == 0) {
+            for (int t = 0; t < poner[i].n; t++) puntos_definir(p, poner[i].tipo[t], args);
+            return 1;
+        }
+    }
+
+    unsigned dir;
+    if (strcmp(cmd, "d") == 0 && sscanf(args, "%i", &dir) == 1) {
+        if (puntos_quitar(p, PUNTO_BREAKPOINT, dir) < 0) printf("No hay breakpoint en %u\n", dir);
+        return 1;
+    }
+    if (strcmp(cmd, "dw") == 0 && sscanf(args, "%i", &dir) == 1) {
+        int quitados = (puntos_quitar(p, PUNTO_LECTURA, dir) == 0) +
+                       (puntos_quitar(p, PUNTO_ESCRITURA, dir) == 0);
+        if (!quitados) printf("No hay watchpoint en %u\n", dir);
+        return 1;
+    }
+    if (strcmp(cmd, "l") == 0) {
+        puntos_listar(p);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ leer_comando - Pausa de los motores interactivos: lee una línea de stdin
+ Sin entrada (EOF) se sigue paso a paso, como con ENTER.
+ destino Instrucción pedida con "g N"
+ */
+static Comando leer_comando(PuntosParada *p, uint64_t *destino)
+{
+    static int terminal = -1;
+    char linea[128];
+    if (terminal < 0) terminal = isatty(fileno(stdin));
+
+    for (;;) {
+        if (terminal) {
+            printf("(dbg) ");
+            fflush(stdout);
+        }
+        if (!fgets(linea, sizeof(linea), stdin)) return CMD_PASO;
+        linea[strcspn(linea, "\n")] = '\0';
+
+        char cmd[8] = "";
+        int fin_cmd = 0;
+        unsigned long long n;
+        sscanf(linea, " %7s%n", cmd, &fin_cmd);
+        if (cmd[0] == '\0' || strcmp(cmd, "s") == 0) return CMD_PASO;
+        if (strcmp(cmd, "c") == 0) return CMD_CONTINUAR;
+        if (strcmp(cmd, "rs") == 0) return CMD_ATRAS;
+        if (strcmp(cmd, "rc") == 0) return CMD_ATRAS_CONTINUAR;
+        if (strcmp(cmd, "q") == 0) return CMD_SALIR;
+        if (strcmp(cmd, "g") == 0 && sscanf(linea + fin_cmd, "%llu", &n) == 1) {
+            *destino = n;
+            return CMD_IR;
+        }
+        if (!comando_puntos(p, cmd, linea + fin_cmd)) ayuda_depurador();
+    }
+}
+
+/*
+ retroceder - Continúa hacia atrás: lleva la CPU a la última parada
+ (breakpoint o watchpoint) anterior a la instrucción actual, o al inicio del
+ historial si no hay ninguna
+
+ Recorre los tramos entre instantáneas del más reciente al más antiguo;
+ cada tramo se re-ejecuta hacia delante con las comprobaciones de los
+ puntos de parada y se queda la última parada que encuentre.
+ */
+static MotivoParada retroceder(CPU *cpu, Historial *hist, const PuntosParada *p,
+                               AccesoVigilado *a)
+{
+    uint64_t fin = cpu->icount;
+    AccesoVigilado acceso;
+
+    while (p && p->activos && fin > historial_inicio(hist)) {
+        uint64_t ini = historial_anterior(hist, fin);
+        uint64_t parada = UINT64_MAX, desde = UINT64_MAX;
+        MotivoParada motivo = PARADA_LIMITE;
+
+        historial_ir_a(hist, cpu, ini);
+        while (cpu->icount < fin && !cpu->status.h) {
+            atender_dispositivos(cpu);
+            MotivoParada m = tramo_vigilado(cpu, NULL, p, fin, proximo_evento(cpu), desde, &acceso);
+            if (m != PARADA_BREAKPOINT && m != PARADA_WATCHPOINT) continue;
+            if (cpu->icount < fin) {
+                parada = cpu->icount;
+                motivo = m;
+                *a = acceso;
+            }
+            desde = cpu->icount;
+        }
+        if (parada != UINT64_MAX) {
+            historial_ir_a(hist, cpu, parada);
+            // Hacia delante el breakpoint se vio después de atender los
+            // eventos de esa instrucción (quizá saltando a una rutina)
+            if (motivo == PARADA_BREAKPOINT) atender_dispositivos(cpu);
+            return motivo;
+        }
+        fin = ini;
+    }
+    historial_ir_a(hist, cpu, historial_inicio(hist));
+    return PARADA_LIMITE;
+}
+
+/*
+ bucle_interactivo - Núcleo común de los motores "debug" e "incremental"
+ incremental Si no es 0, tras cada paso muestra solo lo que cambió
+
+ Ejecuta una instrucción, muestra el estado y espera un comando. Además de
+ avanzar se puede retroceder: el historial guarda una instantánea de la CPU
+ cada h->intervalo_instantaneas instrucciones y las instrucciones anteriores
+ se alcanzan re-ejecutando desde la última instantánea. La traza registra
+ las instrucciones en el orden en que se ejecutan hacia delante (las que se
+ re-ejecutan para retroceder no).
+ */
+static uint64_t bucle_interactivo(CPU *cpu, Herramientas *h, int incremental)
+{
+    static CPU prev;     // Estado mostrado en el paso anterior (8 KB, fuera de la pila)
+    uint64_t inicio = cpu->icount;
+    uint64_t destino = 0;
+    AccesoVigilado acceso;
+    MotivoParada motivo;
+
+    Historial *hist = historial_crear(cpu, h->intervalo_instantaneas ? h->intervalo_instantaneas
+                                                                    : HISTORIAL_INTERVALO);
+    if (!hist) printf("Aviso: sin memoria para el historial, no se podrá retroceder\n");
+
+    // Los comandos b/w necesitan puntos de parada aunque no se dieran con -b/-w
+    PuntosParada *propios = h->puntos ? NULL : puntos_crear();
+    if (propios) h->puntos = propios;
+
+    if (incremental) {
+        prev = *cpu;
+        printCPUState(cpu);
+    }
+
+    Comando cmd = CMD_PASO;
+    for (;;) {
+        if (cmd == CMD_SALIR) break;
+        if (cmd == CMD_PASO) {
+            if (cpu->status.h) break;
+            atender_dispositivos(cpu);
+            step_and_show(cpu, h);
+            cpu_vaciar_es(cpu);     // Lo que escribió el programa, antes que el estado
+            if (hist) historial_anotar(hist, cpu);
+            if (punto_control(cpu, h) < 0) break;
+        } else if (cmd == CMD_CONTINUAR || (cmd == CMD_IR && destino > cpu->icount)) {
+            if (cpu->status.h) break;
+            motivo = continuar(cpu, h, hist, cmd == CMD_IR ? destino : UINT64_MAX, cpu->icount,
+                               &acceso);
+            cpu_vaciar_es(cpu);
+            if (motivo == PARADA_DIVERGENCIA) break;
+            informar_parada(cpu, h, motivo, &acceso);
+            if (cmd == CMD_IR) printf(">> instrucción %llu\n", (unsigned long long)cpu->icount);
+        } else if (!hist) {
+            printf("Sin historial\n");
+        } else if (cmd == CMD_ATRAS_CONTINUAR) {
+            motivo = retroceder(cpu, hist, h->puntos, &acceso);
+            informar_parada(cpu, h, motivo, &acceso);
+            printf("<< instrucción %llu\n", (unsigned long long)cpu->icount);
+        } else {
+            if (cmd == CMD_ATRAS) destino = cpu->icount ? cpu->icount - 1 : 0;
+            if (historial_ir_a(hist, cpu, destino) < 0) {
+                printf("La instrucción %llu es anterior al inicio del historial (%llu)\n",
+                       (unsigned long long)destino, (unsigned long long)historial_inicio(hist));
+            }
+            printf("<< instrucción %llu\n", (unsigned long long)cpu->icount);
+        }
+
+        if (incremental) printCPUChanges(cpu, &prev);  // Mostrar estado resultante
+        else printCPUState(cpu);
+        cmd = leer_comando(h->puntos, &destino);       // Pausa
+    }
+
+    if (propios) {
+        puntos_destruir(propios);
+        h->puntos = NULL;
+    }
+    historial_destruir(hist);
+    if (cpu->status.h) printf("CPU Halted!\n");
+    return cpu->icount - inicio;
+}
+
+/*
+ cpu_loop - Bucle principal de ejecución de la CPU (motor "debug")
+ cpu Puntero a la estructura CPU
+ h Herramientas conectadas (traza, grabación)
+
+ Ciclo de ejecución:
+ 1. Ejecutar instrucción actual
+ 2. Mostrar estado
+ 3. Esperar un comando del usuario (ENTER avanza; ver bucle_interactivo)
+ 4. Repetir hasta que se active Halt Flag
+
+ Devuelve el número de instrucciones ejecutadas
+ */
+uint64_t cpu_loop(CPU *cpu, Herramientas *h)
+{
+    return bucle_interactivo(cpu, h, 0);
+}
+
+/*
+ printCPUChanges - Muestra solo lo que cambió desde el paso anterior
+ cpu Puntero a la estructura CPU
+ prev Copia del estado mostrado la última vez; se actualiza al terminar
+
+ Imprime los registros y flags que cambiaron y las palabras de memoria
+ modificadas (hasta la marca de agua y en la pila) con su valor anterior. En un
+ terminal las palabras modificadas se resaltan en color.
+ */
+void printCPUChanges(CPU *cpu, CPU *prev)
+{
+    static int color = -1;    // stdout es un terminal (se consulta una sola vez)
+    if (color < 0) color = isatty(fileno(stdout));
+    const char *resaltar = color ? "\033[1;33m" : "";
+    const char *normal = color ? "\033[0m" : "";
+
+    // Registros principales
+    if (cpu->pc != prev->pc) printf("PC:%x ", cpu->pc);
+    if (cpu->x != prev->x) printf("X:%x ", cpu->x);
+    if (cpu->acc != prev->acc) printf("ACC:%x ", cpu->acc);
+    if (cpu->sp != prev->sp) printf("SP:%x ", cpu->sp);
+
+    // Flags de estado
+    if (cpu->status.z != prev->status.z) printf("Z:%x ", cpu->status.z);
+    if (cpu->status.n != prev->status.n) printf("N:%x ", cpu->status.n);
+    if (cpu->status.c != prev->status.c) printf("C:%x ", cpu->status.c);
+    if (cpu->status.i != prev->status.i) printf("I:%x ", cpu->status.i);
+    if (cpu->status.v != prev->status.v) printf("V:%x ", cpu->status.v);
+    if (cpu->status.h != prev->status.h) printf("H:%x ", cpu->status.h);
+    if (cpu->irq != prev->irq) printf("IRQ:%x ", cpu->irq);
+    printf("\n");
+
+    // Solo hace falta comparar hasta la marca de agua más alta de los dos
+    // pasos (por encima todo es 0; al volver a una instantánea la marca
+    // baja) y la pila, desde la cima más baja de los dos hasta el final
+    unsigned hwm = cpu->mem_hwm > prev->mem_hwm ? cpu->mem_hwm : prev->mem_hwm;
+    unsigned cima = MEM_SIZE;
+    if (cpu->sp && cpu->sp < cima) cima = cpu->sp;
+    if (prev->sp && prev->sp < cima) cima = prev->sp;
+    for (unsigned i = 0; i < MEM_SIZE; i++) {
+        if (i > hwm && i < cima) i = cima;
+        if (i < MEM_SIZE && cpu->mem[i] != prev->mem[i]) {
+            printf("%smem[%d]: %x -> %x%s\n", resaltar, i, prev->mem[i], cpu->mem[i], normal);
+            prev->mem[i] = cpu->mem[i];
+        }
+    }
+    printf("---\n");
+
+    prev->acc = cpu->acc;
+    prev->x = cpu->x;
+    prev->pc = cpu->pc;
+    prev->sp = cpu->sp;
+    prev->status = cpu->status;
+    prev->irq = cpu->irq;
+    prev->mem_hwm = cpu->mem_hwm;
+}
+
+/*
+ cpu_loop_incremental - Motor "incremental": como cpu_loop, pero después de
+ cada instrucción solo muestra lo que cambió (ver printCPUChanges).
+ El estado completo se muestra una vez al empezar.
+ */
+uint64_t cpu_loop_incremental(CPU *cpu, Herramientas *h)
+{
+    return bucle_interactivo(cpu, h, 1);
+}
+
+/*
+ cpu_run - Motor "batch": ejecuta sin pausas ni salida por instrucción
+ cpu Puntero a la estructura CPU
+ h Herramientas conectadas (traza, grabación, puntos de parada)
+
+ Pensado para programas largos y para medir rendimiento. Ejecuta por tramos
+ (ver continuar): sin traza, grabación ni puntos de parada es un único
+ tramo con el bucle más simple. Si hay puntos de parada se detiene en el
+ primero que se cumpla.
+ Solo muestra el estado final de la CPU al detenerse.
+ */
+uint64_t cpu_run(CPU *cpu, Herramientas *h)
+{
+    uint64_t inicio = cpu->icount;
+    AccesoVigilado acceso;
+
+    MotivoParada motivo = continuar(cpu, h, NULL, UINT64_MAX, cpu->icount, &acceso);
+    cpu_vaciar_es(cpu);
+    informar_parada(cpu, h, motivo, &acceso);
+
+    if (cpu->status.h) printf("CPU Halted!\n");
+    printCPUState(cpu);
+    return cpu->icount - inicio;
+}
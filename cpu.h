@@ -0,0 +1,580 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "traza.h"
+
+#define MEM_SIZE 4096
+
+
+// DEFINICIONES DE REGISTROS Y ESTADOS
+// ===================================
+
+/*
+ Registro de Estado (Flags) - Cada flag es 1 bit
+ z: Zero Flag - Se activa (1) cuando el resultado de una operación es cero
+ n: Negative Flag - Se activa cuando el resultado es negativo (en complemento a 2)
+ c: Carry Flag - Se activa cuando hay acarreo en operaciones aritméticas
+ i: Interrupt Flag - Habilita/deshabilita interrupciones
+ v: Overflow Flag - Se activa cuando hay desbordamiento aritmético
+ h: Halt Flag - Se activa cuando la CPU se detiene (instrucción halt)
+ */
+typedef struct
+{
+    uint8_t z : 1;  
+    uint8_t n : 1;   
+    uint8_t c : 1;  
+    uint8_t i : 1;  
+    uint8_t v : 1;  
+    uint8_t h : 1;  
+} Status;
+
+/*
+ Dispositivos que piden eventos al planificador (ver PLANIFICADOR DE
+ EVENTOS). Cada uno tiene como mucho un evento pendiente
+ */
+typedef enum {
+    DISPOSITIVO_TEMPORIZADOR,
+    NUM_DISPOSITIVOS
+} Dispositivo;
+
+typedef struct {
+    uint64_t ciclo;         // Ciclo emulado en el que vence
+    uint8_t dispositivo;    // Dispositivo que lo atiende
+} EventoDispositivo;
+
+/*
+ Planificador de eventos: montículo (min-heap) ordenado por ciclo, así que
+ eventos[0] es el próximo que vence. Hay sitio para MAX_EVENTOS dispositivos
+ */
+#define MAX_EVENTOS 8
+
+typedef struct {
+    EventoDispositivo eventos[MAX_EVENTOS];
+    uint8_t num;
+} Planificador;
+
+/*
+ Temporizador programable: cada periodo ciclos emulados pide la línea de
+ interrupción linea (periodo 0: parado)
+ */
+typedef struct {
+    uint32_t periodo;
+    uint8_t linea;
+} Temporizador;
+
+/*
+ Entrada/salida mapeada en memoria (ver ENTRADA/SALIDA MAPEADA EN MEMORIA).
+ La memoria se divide en páginas de PALABRAS_PAGINA palabras y cada página
+ es RAM o pertenece a una región de E/S, que atiende un dispositivo
+ */
+#define BITS_PAGINA 6
+#define PALABRAS_PAGINA (1 << BITS_PAGINA)
+#define NUM_PAGINAS (MEM_SIZE >> BITS_PAGINA)
+#define MAX_REGIONES_ES 4
+
+struct CPU;
+
+/*
+ Dispositivo de E/S: funciones a las que se desvían las lecturas y
+ escrituras de su región. registro es la dirección menos la base de la
+ región; datos es el estado del dispositivo. vaciar termina de sacar lo
+ que el dispositivo tenga pendiente (ver cpu_vaciar_es). Cualquiera puede
+ ser NULL (lecturas a 0, escrituras ignoradas, nada que vaciar)
+ */
+typedef struct {
+    uint16_t (*leer)(struct CPU *cpu, void *datos, uint16_t registro);
+    void (*escribir)(struct CPU *cpu, void *datos, uint16_t registro, uint16_t valor);
+    void (*vaciar)(void *datos);
+    void *datos;
+} DispositivoES;
+
+typedef struct {
+    DispositivoES dispositivo;
+    uint16_t base;          // Primera dirección de la región
+} RegionES;
+
+/*
+ Estructura principal de la CPU - Simula un procesador simple
+ mem: Memoria principal, en nuestro caso un array de N palabras de 16 bits según definamos MEM_SIZE
+ acc: Accumulator, registro acumulador para operaciones aritméticas
+ x: Index Register, registro índice para direccionamiento
+ pc: Program Counter, contador de programa, apunta a la siguiente instrucción
+ sp: Stack Pointer, puntero de pila. La pila crece hacia abajo desde el final
+     de la memoria: JSR y PUSH escriben en mem[--sp], RTS y POP leen de
+     mem[sp++] (con sp = 0 la pila está vacía y la primera palabra es mem[4095])
+ status: Estructura de registro de estado con los flags de la CPU
+ irq: Líneas de interrupción pedidas y aún no atendidas (bit n = línea n,
+      la 0 es la más prioritaria; ver cpu_interrumpir)
+ mem_hwm: Marca de agua de la memoria - dirección más alta cargada o escrita.
+          La mantienen el cargador y store_data; las vistas de memoria no
+          necesitan buscar la última palabra usada. La pila no la mueve (si
+          no, cualquier JSR haría mostrar la memoria entera)
+ icount: Instrucciones ejecutadas desde el reset. Es el reloj de la máquina:
+         las grabaciones sitúan cada evento externo en un valor de icount
+ ciclos: Ciclos emulados desde el reset según el modelo de ciclos
+         (ver ciclos_instruccion)
+ ciclos_latencia: Ciclos que cada opcode suma a sus accesos (MUL, DIV y
+         MOD). resetCPU pone los de por defecto; ver ciclos_configurar
+ planificador, temporizador: Eventos de los dispositivos y su estado. Van
+         en la CPU para que las instantáneas y las copias los incluyan
+ tipo_pagina: Para cada página, 0 si es RAM o 1 + el índice de su región de
+              E/S en regiones_es (ver cpu_mapear_es)
+ aleatorio: Estado del generador de números aleatorios de la E/S estándar
+            (0 hasta la primera lectura; ver dispositivos.h)
+ fin_tramo: icount en el que acaba el tramo que se está ejecutando (ver
+            EJECUCIÓN POR TRAMOS en cpu.c)
+ grabacion: Grabación conectada a la CPU (la ponen grabacion_crear y
+            grabacion_abrir), o NULL. cpu_interrumpir pasa por ella
+ */
+typedef struct CPU
+{
+    uint16_t mem[MEM_SIZE];
+    uint16_t acc;          
+    uint16_t x;            
+    uint16_t pc;           
+    uint16_t sp;
+    Status status;         
+    uint8_t irq;
+    uint16_t mem_hwm;
+    uint64_t icount;
+    uint64_t ciclos;
+    uint8_t ciclos_latencia[32];
+    Planificador planificador;
+    Temporizador temporizador;
+    uint8_t tipo_pagina[NUM_PAGINAS];
+    RegionES regiones_es[MAX_REGIONES_ES];
+    uint32_t aleatorio;
+    uint64_t fin_tramo;
+    struct Grabacion *grabacion;
+} CPU;
+
+
+// CONSTANTES PARA DECODIFICACIÓN DE INSTRUCCIONES
+// ===============================================
+
+/*
+FORMATO DE INSTRUCCIÓN (16 bits):
+
+Bit 15:     Formato largo (L)
+Bit 14:     Operando inmediato (I)
+Bits 13-9:  Código de operación (opcode, 0-31)
+Bit 8:      Selector de registro (0=X, 1=ACC)
+Bits 7-6:   Modo de direccionamiento (dirm)
+Bits 5-0:   Constante de dirección (cd)
+
+[LI][OPCOD][R][DI][CDCDCDCDCD]
+
+Opcodes: 0 ST, 1 LD, 2 ADD, 3 BR, 4 BZ, 5 CLR, 6 DEC, 7 extendidas,
+8 SUB, 9 AND, 10 OR, 11 XOR, 12 CMP, 13 SHL, 14 SHR, 15 JSR, 16 MUL,
+17 DIV, 18 MOD, 19 MOVE, 20 FILL, 21 PUSH, 22 POP, 23 RTI (24-31 sin
+asignar)
+
+Para instrucciones extendidas (opcode=7):
+Bits 7-8 se usan como extended opcode: 0 HALT, 1 EI, 2 DI, 3 RTS
+
+Formato largo (L=1): la instrucción ocupa dos palabras y la segunda es la
+dirección completa, que sustituye a cd. Los modos de direccionamiento son
+los mismos, así que se llega a toda la memoria sin pasar por un puntero:
+
+[1I][OPCOD][R][DI][000000]  [DIRECCIÓN (16 bits)]
+
+Operando inmediato (I=1, DIRM=00): en LD, ADD, la ALU y MUL/DIV/MOD el operando es el
+propio cd (0-63) o, en formato largo, la segunda palabra (16 bits), en
+lugar de mem[ea]. El resto de opcodes no lo admiten y con I=1 no hacen
+nada; las extendidas ignoran el bit:
+
+[01][OPCOD][R][00][LITERAL]    [11][OPCOD][R][00][000000]  [LITERAL]
+*/
+
+#define OPCODE_SHIFT 9    // Desplazamiento para extraer opcode (bits 9-13)
+#define OPCODE_MASK 0x1F  // Máscara para opcode (5 bits: 0-31)
+#define EXT_SHIFT 7       // Desplazamiento para extended opcode (bits 7-8)  
+#define EXT_MASK 0x3      // Máscara para extended opcode (2 bits: 0-3)
+#define LARGO_BIT 0x8000  // Bit 15: formato largo, la dirección va en la palabra siguiente
+#define INMEDIATO_BIT 0x4000  // Bit 14: el operando es el literal, no mem[ea]
+
+// Opcodes que leen o escriben el dato mem[eff_addr], un bit por opcode:
+// LD, ADD, la ALU (8-14) y MUL/DIV/MOD (16-18) lo leen (y admiten operando
+// inmediato); ST lo escribe
+#define OPCODES_LEEN_DATO 0x00077F06
+#define OPCODES_ESCRIBEN_DATO 0x0001
+
+// MOVE (19) y FILL (20) escriben un bloque de palabras a partir de mem[ea]
+// (MOVE lo copia de otro bloque); ver mover_bloque en cpu.c
+#define OPCODES_BLOQUE 0x00180000
+
+// JSR (15) y PUSH (21) escriben en la pila mem[sp - 1]; POP (22), RTI (23)
+// y RTS (extendida 3) leen mem[sp] (RTI además mem[sp + 1])
+#define OPCODES_APILAN 0x00208000
+#define OPCODES_DESAPILAN 0x00C00000
+#define OP_RTI 23
+#define EXT_RTS 3
+
+// ¿La instrucción lee mem[eff_addr]? Con operando inmediato no
+static inline int instruccion_lee_dato(uint16_t inst_code)
+{
+    return ((OPCODES_LEEN_DATO >> ((inst_code >> OPCODE_SHIFT) & OPCODE_MASK)) & 1) &&
+           !(inst_code & INMEDIATO_BIT);
+}
+
+// ¿La instrucción escribe mem[eff_addr]? (ST con I=1 no hace nada)
+static inline int instruccion_escribe_dato(uint16_t inst_code)
+{
+    return ((OPCODES_ESCRIBEN_DATO >> ((inst_code >> OPCODE_SHIFT) & OPCODE_MASK)) & 1) &&
+           !(inst_code & INMEDIATO_BIT);
+}
+
+// ¿Es MOVE o FILL? (no admiten operando inmediato)
+static inline int instruccion_bloque(uint16_t inst_code)
+{
+    return ((OPCODES_BLOQUE >> ((inst_code >> OPCODE_SHIFT) & OPCODE_MASK)) & 1) &&
+           !(inst_code & INMEDIATO_BIT);
+}
+
+// ¿La instrucción escribe en la pila (JSR, PUSH)?
+static inline int instruccion_apila(uint16_t inst_code)
+{
+    return ((OPCODES_APILAN >> ((inst_code >> OPCODE_SHIFT) & OPCODE_MASK)) & 1) &&
+           !(inst_code & INMEDIATO_BIT);
+}
+
+// ¿La instrucción lee de la pila (POP, RTS, RTI)?
+static inline int instruccion_desapila(uint16_t inst_code)
+{
+    uint8_t opcode = (inst_code >> OPCODE_SHIFT) & OPCODE_MASK;
+    if (opcode == 7) return ((inst_code >> EXT_SHIFT) & EXT_MASK) == EXT_RTS;
+    return ((OPCODES_DESAPILAN >> opcode) & 1) && !(inst_code & INMEDIATO_BIT);
+}
+
+// Palabras que copia o rellena un MOVE/FILL: las cuenta el registro que no
+// selecciona R (X con R=1, ACC con R=0), como mucho toda la memoria
+static inline unsigned bloque_palabras(uint8_t reg, uint16_t acc, uint16_t x)
+{
+    unsigned n = reg ? x : acc;
+    return n < MEM_SIZE ? n : MEM_SIZE;
+}
+
+// Palabras que ocupa la instrucción que empieza por inst_code (1 o 2)
+static inline unsigned palabras_instruccion(uint16_t inst_code)
+{
+    return 1 + (inst_code >> 15);
+}
+
+
+// CONTEXTO DE INSTRUCCIÓN - PARA EJECUCIÓN EN DOS FASES
+// =====================================================
+
+/*
+  Contexto de Instrucción - Contiene toda la información decodificada
+  de una instrucción para separar fetch/decode de execute
+*/
+typedef struct {
+    uint8_t opcode;        // Código de operación principal (bits 9-13)
+    uint8_t reg;           // Registro seleccionado (0=X, 1=ACC)
+    uint8_t addr_mode;     // Modo de direccionamiento (bits 6-7)
+    uint16_t address;      // Constante de dirección (bits 0-5, o la segunda palabra); con I, el literal
+    uint16_t eff_addr;     // Dirección Efectiva - dirección real en memoria
+    uint8_t is_extended;   // Flag: 1 si es instrucción extendida
+    uint8_t ext_opcode;    // Extended opcode (para opcode=7, bits 7-8)
+    uint16_t inst_code;    // Palabra de instrucción tal como estaba en memoria
+} InstructionContext;
+
+
+// MODELO DE CICLOS
+// ================
+
+/*
+ Cada acceso a memoria cuesta un ciclo: las palabras de la instrucción, el
+ puntero de los modos indirectos y el dato de ST, LD, ADD y la ALU. Los
+ saltos usan la dirección efectiva sin leerla; CLR, DEC y las extendidas no
+ usan el operando. La tabla da el coste en formato corto por [opcode][dirm] (en las
+ extendidas dirm son bits del extended opcode) y el formato largo suma la
+ lectura de su segunda palabra. Con operando inmediato solo se leen las
+ palabras de la instrucción.
+
+ MUL, DIV y MOD suman además su latencia (la tabla ciclos_latencia de
+ cada CPU), que se puede cambiar con ciclos_configurar() para modelar otra
+ unidad de multiplicación o división. Por defecto (ciclos_latencia_defecto):
+ MUL 4, DIV y MOD 12.
+
+ Depende solo de la palabra de instrucción, así que el analizador calcula
+ los ciclos de una traza sin ejecutarla (con la misma configuración). Las
+ excepciones los suman sus handlers y están en ciclos_extra(): MOVE y FILL
+ suman por palabra del bloque 2 ciclos (lectura y escritura) y 1
+ (escritura), lo que depende además de ACC y X (no cambian al ejecutarlos,
+ así que salen de la traza); RTS suma la lectura de la pila, porque en la
+ tabla las extendidas no se distinguen.
+
+ Entrar en una interrupción cuesta CICLOS_INTERRUPCION (apilar PC y flags y
+ leer el vector). No es una instrucción, así que no aparece en la traza y
+ el analizador no lo cuenta.
+ */
+extern const uint8_t ciclos_base[32][4];
+extern const uint8_t ciclos_latencia_defecto[32];
+
+static inline unsigned ciclos_instruccion(const uint8_t *latencia, uint16_t inst_code)
+{
+    uint8_t opcode = (inst_code >> OPCODE_SHIFT) & OPCODE_MASK;
+    unsigned accesos = inst_code & INMEDIATO_BIT ? palabras_instruccion(inst_code)
+                     : ciclos_base[opcode][(inst_code >> 6) & 0x3] + (inst_code >> 15);
+    return accesos + latencia[opcode];
+}
+
+static inline unsigned ciclos_extra(uint16_t inst_code, uint16_t acc, uint16_t x)
+{
+    uint8_t opcode = (inst_code >> OPCODE_SHIFT) & OPCODE_MASK;
+    if (opcode == 7) return ((inst_code >> EXT_SHIFT) & EXT_MASK) == EXT_RTS;
+    if (!instruccion_bloque(inst_code)) return 0;
+    unsigned n = bloque_palabras((inst_code >> 8) & 1, acc, x);
+    return opcode == 19 ? 2 * n : n;
+}
+
+/*
+ ciclos_configurar - Cambia la latencia de MUL/DIV/MOD
+ latencia: Tabla que cambiar (cpu->ciclos_latencia, o la del analizador)
+ texto: "mul=N,div=N,mod=N" (cualquier subconjunto, N de 0 a 255)
+ Devuelve 0, o -1 si el texto no es válido (la tabla puede quedar a medias).
+ */
+int ciclos_configurar(uint8_t latencia[32], const char *texto);
+
+
+void store_data(CPU *cpu, uint8_t reg, uint16_t data);
+void load_data(CPU *cpu, uint8_t reg, uint16_t data);
+void add_data(CPU *cpu, uint8_t reg, uint16_t data);
+void branch_jump(CPU *cpu, uint8_t reg, uint16_t data);
+void branch_if_zero(CPU *cpu, uint8_t reg, uint16_t data);
+void clear_reg(CPU *cpu, uint8_t reg, uint16_t data);
+void decrement_reg(CPU *cpu, uint8_t reg, uint16_t data);
+void sub_data(CPU *cpu, uint8_t reg, uint16_t data);
+void and_data(CPU *cpu, uint8_t reg, uint16_t data);
+void or_data(CPU *cpu, uint8_t reg, uint16_t data);
+void xor_data(CPU *cpu, uint8_t reg, uint16_t data);
+void compare_data(CPU *cpu, uint8_t reg, uint16_t data);
+void shift_left(CPU *cpu, uint8_t reg, uint16_t data);
+void shift_right(CPU *cpu, uint8_t reg, uint16_t data);
+void mul_data(CPU *cpu, uint8_t reg, uint16_t data);
+void div_data(CPU *cpu, uint8_t reg, uint16_t data);
+void mod_data(CPU *cpu, uint8_t reg, uint16_t data);
+void move_block(CPU *cpu, uint8_t reg, uint16_t data);
+void fill_block(CPU *cpu, uint8_t reg, uint16_t data);
+void jump_subroutine(CPU *cpu, uint8_t reg, uint16_t data);
+void push_reg(CPU *cpu, uint8_t reg, uint16_t data);
+void pop_reg(CPU *cpu, uint8_t reg, uint16_t data);
+void reserved_op(CPU *cpu, uint8_t reg, uint16_t data);
+void load_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void add_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void sub_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void and_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void or_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void xor_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void compare_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void shift_left_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void shift_right_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void mul_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void div_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void mod_immediate(CPU *cpu, uint8_t reg, uint16_t valor);
+void halt_cpu(CPU *cpu, uint8_t reg, uint16_t data);
+void enable_int(CPU *cpu, uint8_t reg, uint16_t data);
+void disable_int(CPU *cpu, uint8_t reg, uint16_t data);
+void return_subroutine(CPU *cpu, uint8_t reg, uint16_t data);
+void return_interrupt(CPU *cpu, uint8_t reg, uint16_t data);
+
+
+// TABLAS DE INSTRUCCIONES
+// =======================
+
+/*
+Estructura Instruction - mapea nombres a funciones ejecutoras
+name: Nombre mnemónico de la instrucción
+execute: Puntero a la función que implementa la instrucción
+ */
+typedef struct {
+    const char *name;                        // Nombre de la instrucción
+    void (*execute)(CPU *cpu, uint8_t reg, uint16_t data);  // Función ejecutora
+} Instruction;
+
+// Definidas en cpu.c: una entrada por opcode (0-31) y por extended opcode
+// (0-3), así que cualquier palabra de memoria se despacha. immediate_set
+// recibe el literal en lugar de la dirección efectiva (I=1). Son de solo
+// lectura, así que varias CPU pueden ejecutar a la vez en distintos hilos
+extern const Instruction instruction_set[];
+extern const Instruction extended_set[];
+extern const Instruction immediate_set[];
+
+
+// FUNCIONES PRINCIPALES DE LA CPU
+// ===============================
+
+void resetCPU(CPU *cpu);
+void fetch_and_decode(CPU *cpu, InstructionContext *ctx);
+void execute_decoded(CPU *cpu, InstructionContext *ctx);
+void execute_instruction(CPU *cpu);
+uint8_t status_flags(const Status *status);
+void set_status_flags(Status *status, uint8_t flags);
+uint64_t cpu_hash(const CPU *cpu);
+void printInstruction(CPU *cpu, const InstructionContext *ctx);
+void printCPUState(CPU *cpu);
+void printCPUChanges(CPU *cpu, CPU *prev);
+
+
+// CONTROLADOR DE INTERRUPCIONES
+// =============================
+
+/*
+ INT_LINEAS líneas con prioridad fija: si hay varias pedidas se atiende la
+ de número más bajo. La tabla de vectores está en memoria, en
+ mem[INT_VECTORES + línea], y cada entrada es la dirección de la rutina.
+ Queda por debajo de las 256 palabras del final, donde empieza la pila.
+
+ Una línea pedida se atiende antes de la siguiente instrucción si I = 1; si
+ no, queda pendiente hasta que EI o RTI pongan I = 1. Al atenderla se apila
+ el PC y después los flags, se pone I = 0 y se salta al vector; RTI los
+ desapila. Con la CPU detenida (H = 1) no se atiende ninguna.
+
+ No hay comprobación por instrucción: EI y RTI atienden la línea al
+ ejecutarse y el resto de cambios llegan desde fuera de la ejecución
+ (cpu_interrumpir, un depurador que escribe los flags), así que los motores
+ lo comprueban una vez por tramo.
+ */
+#define INT_LINEAS 8
+#define INT_VECTORES (MEM_SIZE - 256)
+#define CICLOS_INTERRUPCION 3
+
+/*
+ cpu_interrumpir - Pide la línea de interrupción linea (0 a INT_LINEAS - 1)
+ Se atiende cuando el motor vuelva a ejecutar, antes de la siguiente instrucción.
+ Es una entrada externa: con una grabación conectada se graba y, al
+ reproducir, se ignora (las interrupciones llegan de la grabación).
+ */
+void cpu_interrumpir(CPU *cpu, unsigned linea);
+
+/*
+ cpu_atender_interrupcion - Atiende la línea pedida más prioritaria si I = 1
+ y la CPU no está detenida. Devuelve 1 si saltó a su rutina.
+ */
+int cpu_atender_interrupcion(CPU *cpu);
+
+
+// PLANIFICADOR DE EVENTOS
+// =======================
+
+/*
+ Los dispositivos no se consultan en cada instrucción. Cada uno pide un
+ evento para un ciclo emulado y los motores ejecutan en tramos que terminan
+ en la primera instrucción tras la que cpu->ciclos llega al ciclo del evento
+ más próximo; allí lo atienden (su manejador puede pedir el siguiente) y
+ siguen con otro tramo. Sin eventos pendientes el bucle es el de siempre,
+ sin ninguna comprobación de ciclos.
+
+ Un evento vence siempre en la misma instrucción, sea cual sea el motor o
+ cómo se corten los tramos, así que la ejecución sigue siendo determinista
+ y las grabaciones y el historial funcionan igual.
+ */
+
+/*
+ cpu_planificar - Pide (o mueve) el evento del dispositivo d para el ciclo
+ ciclo; si ya pasó, vence antes de la siguiente instrucción
+ */
+void cpu_planificar(CPU *cpu, Dispositivo d, uint64_t ciclo);
+
+// cpu_cancelar_evento - Quita el evento pendiente del dispositivo d, si lo hay
+void cpu_cancelar_evento(CPU *cpu, Dispositivo d);
+
+/*
+ cpu_temporizador - Programa el temporizador: cada periodo ciclos, contando
+ desde ahora, pide la línea de interrupción linea. Con periodo 0 lo para.
+ Si una instrucción dura más de un periodo, los vencimientos que caen en
+ ella se juntan en una sola petición.
+ */
+void cpu_temporizador(CPU *cpu, uint32_t periodo, unsigned linea);
+
+/*
+ cpu_paso - Ejecuta una instrucción después de atender los eventos que
+ vencieron y las interrupciones pendientes (lo mismo que hace un motor al
+ empezar cada tramo)
+ */
+void cpu_paso(CPU *cpu);
+
+
+// ENTRADA/SALIDA MAPEADA EN MEMORIA
+// =================================
+
+/*
+ Las páginas de E/S desvían a su dispositivo las lecturas y escrituras del
+ dato de una instrucción: ST, LD, ADD, la ALU y MUL/DIV/MOD. Cada acceso
+ mira tipo_pagina y, si la página es RAM (lo normal), es un acceso al array
+ mem sin más. El resto de accesos (la instrucción, el puntero de los modos
+ indirectos, la pila, MOVE/FILL) van siempre a mem, también en una página
+ de E/S.
+
+ Los dispositivos se llaman en mitad de la instrucción, con cpu->icount
+ todavía el de la instrucción que accede.
+ */
+
+/*
+ cpu_mapear_es - Conecta el dispositivo d a las direcciones
+ base..base + palabras - 1 (base alineada a PALABRAS_PAGINA; la región se
+ redondea a páginas enteras). Devuelve 0, o -1 si la región no es válida,
+ se solapa con otra o ya hay MAX_REGIONES_ES.
+ */
+int cpu_mapear_es(CPU *cpu, uint16_t base, unsigned palabras, const DispositivoES *d);
+
+/*
+ cpu_vaciar_es - Espera a que los dispositivos saquen lo que tengan
+ pendiente. Los motores lo llaman antes de escribir en stdout, para que su
+ salida no adelante a la del programa
+ */
+void cpu_vaciar_es(CPU *cpu);
+
+
+// HERRAMIENTAS CONECTADAS A LOS MOTORES
+// =====================================
+
+typedef struct Grabacion Grabacion;   // grabacion.h
+typedef struct PuntosParada PuntosParada;   // puntos.h
+typedef struct AccesoVigilado AccesoVigilado;   // puntos.h
+typedef struct MapaFuente MapaFuente;   // mapa.h
+
+/*
+ Herramientas que un motor atiende mientras ejecuta (cualquiera puede ser NULL)
+ traza: Registra cada instrucción ejecutada (opción -t)
+ grabacion: Graba o reproduce la ejecución y comprueba sus hashes (opciones -r/-p)
+ puntos: Breakpoints y watchpoints (opciones -b/-w y comandos del depurador)
+ intervalo_instantaneas: Motores interactivos: instrucciones entre instantáneas
+                         para retroceder (0 = HISTORIAL_INTERVALO, opción -i)
+ mapa: Mapa de fuente para mostrar "archivo:línea texto" en lugar de la
+       instrucción decodificada (opción -f)
+ */
+typedef struct {
+    Traza *traza;
+    Grabacion *grabacion;
+    PuntosParada *puntos;
+    uint64_t intervalo_instantaneas;
+    const MapaFuente *mapa;
+} Herramientas;
+
+/*
+ Motivo por el que un motor dejó de ejecutar
+ */
+typedef enum {
+    PARADA_LIMITE,            // Se alcanzó el número de instrucciones pedido
+    PARADA_HALT,
+    PARADA_BREAKPOINT,
+    PARADA_WATCHPOINT,
+    PARADA_DIVERGENCIA        // La reproducción de una grabación divergió
+} MotivoParada;
+
+MotivoParada cpu_continuar(CPU *cpu, Herramientas *h, uint64_t limite, uint64_t desde,
+                           AccesoVigilado *a);
+
+// Motores de ejecución: ejecutan hasta HALT (o hasta que la reproducción
+// diverja, o hasta un punto de parada en el motor batch) y devuelven las
+// instrucciones ejecutadas.
+uint64_t cpu_loop(CPU *cpu, Herramientas *h);
+uint64_t cpu_loop_incremental(CPU *cpu, Herramientas *h);
+uint64_t cpu_run(CPU *cpu, Herramientas *h);
+
+#endif
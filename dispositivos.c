@@ -0,0 +1,302 @@
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dispositivos.h"
+#include "grabacion.h"
+
+
+// BUFFERS CIRCULARES
+// ==================
+
+static int anillo_crear(AnilloBytes *a, unsigned capacidad_log2)
+{
+    a->capacidad = 1ull << capacidad_log2;
+    a->buf = malloc(a->capacidad);
+    atomic_init(&a->cabeza, 0);
+    atomic_init(&a->cola, 0);
+    return a->buf ? 0 : -1;
+}
+
+// Bytes contiguos a partir de la posición pos hasta el final del buffer
+static inline uint64_t hasta_el_final(const AnilloBytes *a, uint64_t pos)
+{
+    return a->capacidad - (pos & (a->capacidad - 1));
+}
+
+
+// HILOS DE LA CONSOLA
+// ===================
+
+/*
+ hilo_escritor - Vuelca los bytes escritos por el programa en c->salida
+ Espera a juntar CONSOLA_LOTE bytes, pero no más de una pausa: un programa
+ que escribe poco a poco (un prompt) se ve enseguida.
+ */
+static void *hilo_escritor(void *arg)
+{
+    Consola *c = arg;
+    AnilloBytes *a = &c->escritos;
+    const struct timespec pausa = {0, CONSOLA_ESPERA_NS};
+    int esperado = 0;
+
+    for (;;) {
+        // terminar se lee antes que cabeza: si vale 1, cabeza ya es la definitiva
+        int fin = atomic_load_explicit(&c->terminar, memory_order_acquire);
+        uint64_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+        uint64_t pendientes = atomic_load_explicit(&a->cabeza, memory_order_acquire) - cola;
+
+        if (pendientes == 0 && fin) break;
+        if (pendientes == 0 || (pendientes < CONSOLA_LOTE && !fin && !esperado)) {
+            esperado = pendientes > 0;
+            nanosleep(&pausa, NULL);
+            continue;
+        }
+        esperado = 0;
+
+        // Tramo contiguo hasta el final del buffer (el resto en la siguiente vuelta).
+        // Por stdio: así no adelanta a lo que el emulador ya escribió en salida
+        uint64_t n = pendientes < hasta_el_final(a, cola) ? pendientes : hasta_el_final(a, cola);
+        fwrite(&a->buf[cola & (a->capacidad - 1)], 1, n, c->salida);
+        fflush(c->salida);
+        atomic_store_explicit(&a->cola, cola + n, memory_order_release);
+    }
+    return NULL;
+}
+
+/*
+ hilo_lector - Lee la entrada a medida que llega y la deja en c->recibidos
+ Espera con poll() para poder terminar aunque no llegue nada. Si el buffer
+ está lleno deja de leer (lo que falta espera en el sistema).
+ */
+static void *hilo_lector(void *arg)
+{
+    Consola *c = arg;
+    AnilloBytes *a = &c->recibidos;
+    const struct timespec pausa = {0, CONSOLA_ESPERA_NS};
+    struct pollfd pfd = {c->fd_entrada, POLLIN, 0};
+
+    while (!atomic_load_explicit(&c->terminar, memory_order_acquire)) {
+        uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+        uint64_t libres = a->capacidad - (cabeza - atomic_load_explicit(&a->cola, memory_order_acquire));
+        if (libres == 0) {
+            nanosleep(&pausa, NULL);
+            continue;
+        }
+        if (poll(&pfd, 1, CONSOLA_ESPERA_NS / 1000000) <= 0) continue;
+
+        uint64_t n = libres < hasta_el_final(a, cabeza) ? libres : hasta_el_final(a, cabeza);
+        ssize_t leidos = read(c->fd_entrada, &a->buf[cabeza & (a->capacidad - 1)], n);
+        if (leidos < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (leidos <= 0) break;
+        atomic_store_explicit(&a->cabeza, cabeza + (uint64_t)leidos, memory_order_release);
+    }
+    atomic_store_explicit(&c->fin_entrada, 1, memory_order_release);
+    return NULL;
+}
+
+
+// CONSOLA
+// =======
+
+int consola_iniciar(Consola *c, FILE *salida, int fd_entrada, Grabacion *g)
+{
+    memset(c, 0, sizeof(*c));
+    c->salida = salida;
+    c->fd_entrada = fd_entrada;
+    c->grabacion = g;
+    atomic_init(&c->terminar, 0);
+    atomic_init(&c->fin_entrada, fd_entrada < 0);
+
+    if (anillo_crear(&c->escritos, CONSOLA_SALIDA_LOG2) < 0 ||
+        anillo_crear(&c->recibidos, CONSOLA_ENTRADA_LOG2) < 0) {
+        printf("Error: sin memoria para la consola\n");
+        goto error;
+    }
+    // Lo que el emulador haya escrito antes va delante
+    fflush(salida);
+    if (pthread_create(&c->escritor, NULL, hilo_escritor, c) != 0) {
+        printf("Error: No se pudo crear el hilo de la consola\n");
+        goto error;
+    }
+    if (fd_entrada >= 0) {
+        if (pthread_create(&c->lector, NULL, hilo_lector, c) != 0) {
+            printf("Error: No se pudo crear el hilo de la consola\n");
+            atomic_store_explicit(&c->terminar, 1, memory_order_release);
+            pthread_join(c->escritor, NULL);
+            goto error;
+        }
+        c->hay_lector = 1;
+    }
+    return 0;
+
+error:
+    free(c->escritos.buf);
+    free(c->recibidos.buf);
+    c->escritos.buf = c->recibidos.buf = NULL;
+    return -1;
+}
+
+void consola_cerrar(Consola *c)
+{
+    if (!c->escritos.buf) return;
+    atomic_store_explicit(&c->terminar, 1, memory_order_release);
+    pthread_join(c->escritor, NULL);
+    if (c->hay_lector) pthread_join(c->lector, NULL);
+    free(c->escritos.buf);
+    free(c->recibidos.buf);
+    free(c->leidas);
+    c->escritos.buf = c->recibidos.buf = NULL;
+    c->leidas = NULL;
+}
+
+// Espera a que el hilo escritor haya volcado todo lo escrito (ver cpu_vaciar_es)
+static void consola_vaciar(void *datos)
+{
+    Consola *c = datos;
+    AnilloBytes *a = &c->escritos;
+    uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    while (atomic_load_explicit(&a->cola, memory_order_acquire) != cabeza) sched_yield();
+}
+
+// ¿La CPU está re-ejecutando una instrucción que ya usó la consola?
+static inline int reejecutando(const Consola *c, const CPU *cpu)
+{
+    return cpu->icount < c->frontera;
+}
+
+/*
+ Deja el byte en el buffer de salida; si está lleno (el escritor no da
+ abasto) espera a que haya sitio, así que no se pierde nada
+ */
+static void consola_escribir(Consola *c, const CPU *cpu, uint16_t valor)
+{
+    if (reejecutando(c, cpu)) return;
+    AnilloBytes *a = &c->escritos;
+    uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    while (cabeza - atomic_load_explicit(&a->cola, memory_order_acquire) == a->capacidad) {
+        sched_yield();
+    }
+    a->buf[cabeza & (a->capacidad - 1)] = (uint8_t)valor;
+    atomic_store_explicit(&a->cabeza, cabeza + 1, memory_order_release);
+    c->frontera = cpu->icount + 1;
+}
+
+// Siguiente byte del buffer de entrada, sin esperar
+static uint16_t recibir(Consola *c)
+{
+    AnilloBytes *a = &c->recibidos;
+    // fin_entrada antes que cabeza: si el lector ya terminó, cabeza es la definitiva
+    int fin = atomic_load_explicit(&c->fin_entrada, memory_order_acquire);
+    uint64_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    if (atomic_load_explicit(&a->cabeza, memory_order_acquire) == cola) {
+        return fin ? ES_FIN_ENTRADA : ES_SIN_DATO;
+    }
+    uint16_t valor = a->buf[cola & (a->capacidad - 1)];
+    atomic_store_explicit(&a->cola, cola + 1, memory_order_release);
+    return valor;
+}
+
+/*
+ Siguiente byte de la entrada. Al re-ejecutar, el que se leyó en esa
+ instrucción (ES_SIN_DATO si entonces no llegó nada, o si la ejecución ya
+ no es la que se vio, p. ej. porque el depurador cambió la memoria)
+ */
+static uint16_t consola_leer(Consola *c, const CPU *cpu)
+{
+    if (reejecutando(c, cpu)) {
+        size_t a = 0, b = c->num_leidas;
+        while (a < b) {
+            size_t m = a + (b - a) / 2;
+            if (c->leidas[m].instruccion < cpu->icount) a = m + 1;
+            else b = m;
+        }
+        if (a < c->num_leidas && c->leidas[a].instruccion == cpu->icount) return c->leidas[a].valor;
+        return ES_SIN_DATO;
+    }
+
+    uint16_t valor = ES_FIN_ENTRADA;
+    if (!c->grabacion || !c->grabacion->reproduciendo) valor = recibir(c);
+    if (c->grabacion) {
+        valor = (uint16_t)grabacion_entrada(c->grabacion, cpu, GRAB_ENTRADA,
+                                            ES_BASE + ES_CONSOLA_ENTRADA, valor);
+    }
+    c->frontera = cpu->icount + 1;
+    if (valor == ES_SIN_DATO) return valor;
+
+    if (c->num_leidas == c->capacidad) {
+        size_t capacidad = c->capacidad ? 2 * c->capacidad : 256;
+        LecturaConsola *leidas = realloc(c->leidas, capacidad * sizeof(LecturaConsola));
+        if (!leidas) return valor;      // Sin memoria solo se pierde poder repetirla
+        c->leidas = leidas;
+        c->capacidad = capacidad;
+    }
+    c->leidas[c->num_leidas].instruccion = cpu->icount;
+    c->leidas[c->num_leidas++].valor = valor;
+    return valor;
+}
+
+
+// PÁGINA DE E/S ESTÁNDAR
+// ======================
+
+// xorshift32: el estado 0 es el de "sin sembrar"
+static uint16_t aleatorio(CPU *cpu)
+{
+    uint32_t x = cpu->aleatorio ? cpu->aleatorio : ES_SEMILLA;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cpu->aleatorio = x;
+    return (uint16_t)(x >> 16);
+}
+
+static uint16_t leer_registro(CPU *cpu, void *datos, uint16_t registro)
+{
+    switch (registro) {
+    case ES_CONSOLA_ENTRADA:
+        return consola_leer(datos, cpu);
+    case ES_ALEATORIO:
+        return aleatorio(cpu);
+    case ES_CICLOS:
+    case ES_CICLOS + 1:
+    case ES_CICLOS + 2:
+        return (uint16_t)(cpu->ciclos >> (16 * (registro - ES_CICLOS)));
+    case ES_TEMP_PERIODO:
+        return (uint16_t)cpu->temporizador.periodo;
+    case ES_TEMP_LINEA:
+        return cpu->temporizador.linea;
+    default:
+        return 0;
+    }
+}
+
+static void escribir_registro(CPU *cpu, void *datos, uint16_t registro, uint16_t valor)
+{
+    switch (registro) {
+    case ES_CONSOLA_SALIDA:
+        consola_escribir(datos, cpu, valor);
+        break;
+    case ES_ALEATORIO:
+        // Una semilla 0 dejaría el xorshift parado en 0: vuelve a la de por defecto
+        cpu->aleatorio = valor ? (uint32_t)valor << 16 | valor : 0;
+        break;
+    case ES_TEMP_PERIODO:
+        cpu_temporizador(cpu, valor, cpu->temporizador.linea);
+        break;
+    case ES_TEMP_LINEA:
+        cpu_temporizador(cpu, cpu->temporizador.periodo, valor);
+        break;
+    }
+}
+
+int dispositivos_conectar(CPU *cpu, Consola *consola)
+{
+    DispositivoES d = {leer_registro, escribir_registro, consola_vaciar, consola};
+    return cpu_mapear_es(cpu, ES_BASE, PALABRAS_PAGINA, &d);
+}
@@ -0,0 +1,138 @@
+#ifndef DISPOSITIVOS_H
+#define DISPOSITIVOS_H
+
+/*
+ Dispositivos de E/S estándar, mapeados en una página de memoria
+
+ Con ellos un programa escribe y lee texto sin que haya que sacarlo de los
+ volcados de printCPUState. Ocupan la página que queda justo por debajo de
+ la tabla de vectores (ES_BASE = 0xEC0); cada registro es una palabra:
+
+     ES_BASE + 0  CONSOLA_SALIDA   Escribir: saca el byte bajo por la consola
+     ES_BASE + 1  CONSOLA_ENTRADA  Leer: siguiente byte de la entrada,
+                                   ES_SIN_DATO si aún no ha llegado nada
+                                   o ES_FIN_ENTRADA si se acabó (nunca
+                                   espera)
+     ES_BASE + 2  ALEATORIO        Leer: siguiente número pseudoaleatorio
+                                   Escribir: cambia la semilla
+     ES_BASE + 3  CICLOS           Leer: ciclos emulados al empezar la
+                  (3 palabras)     instrucción, de la palabra baja a la alta
+     ES_BASE + 6  TEMP_PERIODO     Leer/escribir el periodo del temporizador
+     ES_BASE + 7  TEMP_LINEA       Leer/escribir su línea de interrupción
+                                   (escribir cualquiera de los dos lo
+                                   reprograma desde ese ciclo; ver
+                                   cpu_temporizador)
+
+ El resto de la página se lee como 0 y no se puede escribir. CICLOS cambia
+ entre dos lecturas: para los 32 bits bajos, leer la palabra alta, la baja
+ y otra vez la alta, y repetir si cambió.
+
+ La consola no hace llamadas al sistema desde el hilo del emulador. Lo
+ escrito va a un buffer circular que un hilo de fondo vuelca con
+ escrituras grandes (o, si sale poco a poco, a lo sumo CONSOLA_ESPERA_NS
+ después); otro hilo lee la entrada cuando llega y la deja en un segundo
+ buffer circular, del que CONSOLA_ENTRADA saca sin esperar. Los motores
+ llaman a cpu_vaciar_es() antes de escribir por stdout, así que lo que
+ saca el programa y lo que muestra el emulador salen en orden.
+
+ La ejecución sigue siendo determinista. El generador aleatorio (xorshift)
+ guarda su estado en la CPU, así que sale en las instantáneas y en el hash.
+ La consola es lo único que viene de fuera (qué llega y cuándo):
+ - Con una grabación, cada lectura de CONSOLA_ENTRADA se guarda en ella
+   (también las que no encontraron nada) y al reproducir se toma de ella
+   en lugar de la entrada real
+ - Al re-ejecutar instrucciones que ya se ejecutaron (volver atrás en los
+   motores paso a paso) la consola no repite lo que escribió y devuelve lo
+   mismo que leyó entonces
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "cpu.h"
+
+#define ES_BASE (INT_VECTORES - PALABRAS_PAGINA)
+
+#define ES_CONSOLA_SALIDA 0
+#define ES_CONSOLA_ENTRADA 1
+#define ES_ALEATORIO 2
+#define ES_CICLOS 3
+#define ES_TEMP_PERIODO 6
+#define ES_TEMP_LINEA 7
+
+#define ES_SIN_DATO 0xFFFF        // CONSOLA_ENTRADA sin nada que leer (de momento)
+#define ES_FIN_ENTRADA 0xFFFE     // CONSOLA_ENTRADA: la entrada se acabó
+#define ES_SEMILLA 0x2545F491u    // Semilla del generador si no se escribe otra
+
+#define CONSOLA_SALIDA_LOG2 16    // Buffer de salida: 64 KB
+#define CONSOLA_ENTRADA_LOG2 12   // Buffer de entrada: 4 KB
+#define CONSOLA_LOTE 4096         // Bytes: el escritor vuelca en bloques de al menos 4 KB...
+#define CONSOLA_ESPERA_NS 1000000 // ...o lo que haya tras esperar 1 ms
+
+// Lectura de CONSOLA_ENTRADA que dio un byte, para devolverlo al re-ejecutar
+typedef struct {
+    uint64_t instruccion;     // icount de la instrucción que leyó
+    uint16_t valor;
+} LecturaConsola;
+
+/*
+ Buffer circular de bytes de un solo productor y un solo consumidor (como
+ el de la traza): el productor solo escribe cabeza y el consumidor cola,
+ cada uno en su línea de caché
+ */
+typedef struct {
+    uint8_t *buf;
+    uint64_t capacidad;                     // Potencia de 2
+    _Alignas(64) _Atomic uint64_t cabeza;   // Siguiente byte a escribir
+    _Alignas(64) _Atomic uint64_t cola;     // Siguiente byte a leer
+} AnilloBytes;
+
+/*
+ Consola de texto
+ salida: Donde van los bytes escritos (por el hilo escritor)
+ fd_entrada: De donde los lee el hilo lector (-1: no hay entrada, se lee
+             ES_FIN_ENTRADA)
+ grabacion: Grabación que se está haciendo o reproduciendo, o NULL
+ frontera: icount siguiente a la última instrucción que usó la consola;
+           las anteriores se están re-ejecutando
+ leidas: Lecturas que dieron un byte, ordenadas por instrucción (las que no
+         están no encontraron nada)
+ */
+typedef struct {
+    FILE *salida;
+    int fd_entrada;
+    Grabacion *grabacion;
+    uint64_t frontera;
+    LecturaConsola *leidas;
+    size_t num_leidas;
+    size_t capacidad;
+
+    AnilloBytes escritos;         // Emulador -> hilo escritor
+    AnilloBytes recibidos;        // Hilo lector -> emulador
+    _Atomic int fin_entrada;      // El lector llegó al final de la entrada
+    _Atomic int terminar;
+    pthread_t escritor, lector;
+    int hay_lector;
+} Consola;
+
+/*
+ consola_iniciar - Prepara la consola y arranca sus hilos
+ fd_entrada Descriptor del que leer la entrada, o -1
+ Devuelve -1 (tras avisar) si no hay memoria o no se pudo crear un hilo.
+ */
+int consola_iniciar(Consola *c, FILE *salida, int fd_entrada, Grabacion *g);
+
+// consola_cerrar - Vuelca lo pendiente, para los hilos y libera la consola
+void consola_cerrar(Consola *c);
+
+/*
+ dispositivos_conectar - Mapea los dispositivos estándar en ES_BASE
+ consola El estado de la consola, que debe vivir mientras se use la CPU
+
+ Devuelve 0, o -1 si la página ya estaba mapeada.
+ */
+int dispositivos_conectar(CPU *cpu, Consola *consola);
+
+#endif
@@ -0,0 +1,261 @@
+# emu.py - Bindings de Python para libemu (ctypes)
+#
+# Ensambla y ejecuta programas dentro del propio proceso, sin escribir el
+# .bin ni lanzar ./emulador: la imagen pasa del ensamblador a la CPU en
+# memoria y la ejecución hasta HALT va a velocidad nativa (ctypes suelta el
+# GIL durante la llamada, así que varios hilos pueden ejecutar emuladores
+# distintos a la vez).
+#
+# Registros y memoria se devuelven como objetos con protocolo de buffer
+# (formato "H", uint16): numpy.frombuffer(emu.memoria, dtype=numpy.uint16)
+# los ve sin copiar.
+#
+# Necesita libemu.so (ver readme.md); se busca junto a este archivo o en la
+# ruta de la variable de entorno LIBEMU.
+#
+# Uso:
+#   from emu import Emulador
+#   with Emulador.desde_fuente(open("suma_v1.asm").read()) as emu:
+#       emu.ejecutar()
+#       print(emu.acc, emu.memoria[7])
+import array
+import ctypes
+import enum
+import os
+
+from ensamblador import ensamblar_imagen
+
+MEM_SIZE = 4096     # EMU_MEM_SIZE
+
+
+class Parada(enum.IntEnum):
+    """Motivo por el que ejecutar() o paso() devolvieron el control (EmuParada)."""
+    LIMITE = 0
+    HALT = 1
+    BREAKPOINT = 2
+    WATCHPOINT = 3
+    GANCHO = 4
+    ERROR = 5
+
+
+class Registro(enum.IntEnum):
+    """EmuRegistro: orden de los registros en Emulador.registros."""
+    ACC = 0
+    X = 1
+    PC = 2
+    STATUS = 3
+    SP = 4
+
+
+class Punto(enum.IntEnum):
+    """EmuPunto."""
+    CODIGO = 0
+    LECTURA = 1
+    ESCRITURA = 2
+
+
+# int (*EmuGancho)(Emu *emu, EmuPunto tipo, uint16_t dir, void *usuario)
+GANCHO = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.c_uint16,
+                          ctypes.c_void_p)
+
+
+def cargar_biblioteca(ruta=None):
+    """Carga libemu.so y declara los prototipos de sus funciones."""
+    ruta = ruta or os.environ.get("LIBEMU") or os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "libemu.so")
+    lib = ctypes.CDLL(ruta)
+
+    emu = ctypes.c_void_p
+    u16p = ctypes.POINTER(ctypes.c_uint16)
+    prototipos = {
+        "emu_crear": (emu, []),
+        "emu_destruir": (None, [emu]),
+        "emu_reiniciar": (None, [emu]),
+        "emu_cargar": (ctypes.c_int, [emu, u16p, ctypes.c_size_t]),
+        "emu_ejecutar": (ctypes.c_int, [emu, ctypes.c_uint64]),
+        "emu_paso": (ctypes.c_int, [emu]),
+        "emu_instrucciones": (ctypes.c_uint64, [emu]),
+        "emu_ciclos": (ctypes.c_uint64, [emu]),
+        "emu_interrumpir": (ctypes.c_int, [emu, ctypes.c_uint]),
+        "emu_temporizador": (ctypes.c_int, [emu, ctypes.c_uint32, ctypes.c_uint]),
+        "emu_latencias": (ctypes.c_int, [emu, ctypes.c_uint, ctypes.c_uint, ctypes.c_uint]),
+        "emu_registro": (ctypes.c_uint16, [emu, ctypes.c_int]),
+        "emu_set_registro": (None, [emu, ctypes.c_int, ctypes.c_uint16]),
+        "emu_memoria": (u16p, [emu]),
+        "emu_poner_punto": (ctypes.c_int, [emu, ctypes.c_int, ctypes.c_uint16, GANCHO,
+                                           ctypes.c_void_p]),
+        "emu_quitar_punto": (ctypes.c_int, [emu, ctypes.c_int, ctypes.c_uint16]),
+    }
+    for nombre, (resultado, argumentos) in prototipos.items():
+        funcion = getattr(lib, nombre)
+        funcion.restype = resultado
+        funcion.argtypes = argumentos
+    return lib
+
+
+_lib = None
+
+
+def biblioteca():
+    global _lib
+    if _lib is None:
+        _lib = cargar_biblioteca()
+    return _lib
+
+
+class Emulador:
+    """Un emulador de libemu. Se libera con cerrar() o al salir del bloque with."""
+
+    def __init__(self, imagen=None):
+        self._lib = biblioteca()
+        self._emu = self._lib.emu_crear()
+        if not self._emu:
+            raise MemoryError("emu_crear")
+        self._ganchos = {}      # (tipo, dir) -> GANCHO: deben vivir mientras estén puestos
+        if imagen is not None:
+            self.cargar(imagen)
+
+    @classmethod
+    def desde_fuente(cls, fuente):
+        """Ensambla fuente (texto o líneas) en memoria y crea un emulador con el programa."""
+        return cls(ensamblar_imagen(fuente))
+
+    def cerrar(self):
+        if self._emu:
+            self._lib.emu_destruir(self._emu)
+            self._emu = None
+            self._ganchos.clear()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *excepcion):
+        self.cerrar()
+
+    def __del__(self):
+        self.cerrar()
+
+    def cargar(self, imagen):
+        """Reinicia la CPU y copia la imagen (palabras desde mem[0]).
+
+        imagen: lista de enteros (como la de ensamblar_imagen) o cualquier
+        buffer de uint16 (array('H'), numpy.uint16...).
+        """
+        palabras = array.array("H", imagen) if not isinstance(imagen, array.array) else imagen
+        if palabras.typecode != "H":
+            palabras = array.array("H", palabras)
+        if len(palabras) > MEM_SIZE:
+            raise ValueError(f"La imagen ocupa {len(palabras)} palabras (máximo {MEM_SIZE})")
+        buffer = (ctypes.c_uint16 * len(palabras)).from_buffer(palabras) if palabras else None
+        self._lib.emu_cargar(self._emu, buffer, len(palabras))
+
+    def reiniciar(self):
+        self._lib.emu_reiniciar(self._emu)
+
+    def ejecutar(self, max_instrucciones=None):
+        """Ejecuta hasta HALT, un punto de parada o max_instrucciones (None: sin límite)."""
+        if max_instrucciones is None:
+            max_instrucciones = 2**64 - 1
+        return Parada(self._lib.emu_ejecutar(self._emu, max_instrucciones))
+
+    def paso(self):
+        return Parada(self._lib.emu_paso(self._emu))
+
+    @property
+    def instrucciones(self):
+        """Instrucciones ejecutadas desde la carga (icount)."""
+        return self._lib.emu_instrucciones(self._emu)
+
+    @property
+    def ciclos(self):
+        """Ciclos emulados desde la carga (modelo de ciclos de cpu.h)."""
+        return self._lib.emu_ciclos(self._emu)
+
+    def interrumpir(self, linea):
+        """Pide una línea de interrupción (0-7); se atiende antes de la siguiente instrucción si I = 1."""
+        if self._lib.emu_interrumpir(self._emu, linea) < 0:
+            raise ValueError(f"Línea de interrupción no válida: {linea}")
+
+    def temporizador(self, periodo, linea=0):
+        """Pide la línea cada periodo ciclos emulados desde ahora (periodo 0: lo para)."""
+        if self._lib.emu_temporizador(self._emu, periodo, linea) < 0:
+            raise ValueError(f"Línea de interrupción no válida: {linea}")
+
+    def latencias(self, mul=4, div=12, mod=12):
+        """Ciclos que MUL, DIV y MOD suman en el modelo de ciclos de este emulador (0-255)."""
+        if self._lib.emu_latencias(self._emu, mul, div, mod) < 0:
+            raise ValueError(f"Latencias no válidas: mul={mul}, div={div}, mod={mod}")
+
+    # Registros
+
+    def registro(self, r):
+        return self._lib.emu_registro(self._emu, r)
+
+    def set_registro(self, r, valor):
+        self._lib.emu_set_registro(self._emu, r, valor)
+
+    @property
+    def registros(self):
+        """Copia de ACC, X, PC, STATUS y SP (en ese orden, ver Registro) como array('H')."""
+        return array.array("H", (self.registro(r) for r in Registro))
+
+    acc = property(lambda self: self.registro(Registro.ACC),
+                   lambda self, v: self.set_registro(Registro.ACC, v))
+    x = property(lambda self: self.registro(Registro.X),
+                 lambda self, v: self.set_registro(Registro.X, v))
+    pc = property(lambda self: self.registro(Registro.PC),
+                  lambda self, v: self.set_registro(Registro.PC, v))
+    status = property(lambda self: self.registro(Registro.STATUS),
+                      lambda self, v: self.set_registro(Registro.STATUS, v))
+    sp = property(lambda self: self.registro(Registro.SP),
+                  lambda self, v: self.set_registro(Registro.SP, v))
+
+    # Memoria
+
+    @property
+    def memoria(self):
+        """La memoria de la CPU sin copiar: array ctypes de MEM_SIZE uint16.
+
+        Admite índices y slices y el protocolo de buffer; escribir en él
+        escribe en la memoria del emulador. Mantiene vivo el emulador.
+        """
+        puntero = self._lib.emu_memoria(self._emu)
+        vista = ctypes.cast(puntero, ctypes.POINTER(ctypes.c_uint16 * MEM_SIZE)).contents
+        vista.emulador = self
+        return vista
+
+    # Puntos de parada y ganchos
+
+    def poner_punto(self, tipo, dir, gancho=None):
+        """Punto de código, de lectura o de escritura en dir.
+
+        gancho: None para que la ejecución pare (Parada.BREAKPOINT/WATCHPOINT)
+        o una función gancho(emulador, tipo, dir) que devuelve True para parar
+        (Parada.GANCHO) o False/None para seguir.
+        """
+        funcion = None
+        if gancho is not None:
+            def llamar(_emu, tipo_c, dir_c, _usuario):
+                return 1 if gancho(self, Punto(tipo_c), dir_c) else 0
+            funcion = GANCHO(llamar)
+        if self._lib.emu_poner_punto(self._emu, tipo, dir, funcion or GANCHO(), None) < 0:
+            raise ValueError(f"No se pudo poner el punto en {dir}")
+        self._ganchos[(tipo, dir)] = funcion
+
+    def quitar_punto(self, tipo, dir):
+        if self._lib.emu_quitar_punto(self._emu, tipo, dir) < 0:
+            raise KeyError(f"No hay punto de tipo {Punto(tipo).name} en {dir}")
+        self._ganchos.pop((tipo, dir), None)
+
+
+def ejecutar_programa(fuente, max_instrucciones=None):
+    """Ensambla y ejecuta un programa de una vez (para barridos de pruebas).
+
+    Devuelve (parada, registros, memoria), con registros y memoria copiados
+    en array('H').
+    """
+    with Emulador.desde_fuente(fuente) as emu:
+        parada = emu.ejecutar(max_instrucciones)
+        memoria = array.array("H")
+        memoria.frombytes(bytes(emu.memoria))
+        return parada, emu.registros, memoria
@@ -3,434 +3,51 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#define MEM_SIZE 4096
+#include "cpu.h"
+#include "grabacion.h"
+#include "historial.h"
+#include "puntos.h"
+#include "gdb.h"
+#include "imagen.h"
+#include "mapa.h"
+#include "contadores.h"
+#include "dispositivos.h"
 
 
-// DEFINICIONES DE REGISTROS Y ESTADOS
-// ===================================
+// MOTORES DE EJECUCIÓN
+// ====================
 
 /*
- Registro de Estado (Flags) - Cada flag es 1 bit
- z: Zero Flag - Se activa (1) cuando el resultado de una operación es cero
- n: Negative Flag - Se activa cuando el resultado es negativo (en complemento a 2)
- c: Carry Flag - Se activa cuando hay acarreo en operaciones aritméticas
- i: Interrupt Flag - Habilita/deshabilita interrupciones
- v: Overflow Flag - Se activa cuando hay desbordamiento aritmético
- h: Halt Flag - Se activa cuando la CPU se detiene (instrucción halt)
- */
-typedef struct
-{
-    uint8_t z : 1;  
-    uint8_t n : 1;   
-    uint8_t c : 1;  
-    uint8_t i : 1;  
-    uint8_t v : 1;  
-    uint8_t h : 1;  
-} Status;
-
-/*
- Estructura principal de la CPU - Simula un procesador simple
- mem: Memoria principal, en nuestro caso un array de N palabras de 16 bits según definamos MEM_SIZE
- acc: Accumulator, registro acumulador para operaciones aritméticas
- x: Index Register, registro índice para direccionamiento
- pc: Program Counter, contador de programa, apunta a la siguiente instrucción
- status: Estructura de registro de estado con los flags de la CPU
- */
-typedef struct
-{
-    uint16_t mem[MEM_SIZE];
-    uint16_t acc;          
-    uint16_t x;            
-    uint16_t pc;           
-    Status status;         
-} CPU;
-
-
-// CONSTANTES PARA DECODIFICACIÓN DE INSTRUCCIONES
-// ===============================================
-
-/*
-FORMATO DE INSTRUCCIÓN (16 bits):
-
-Bits 15-13: No usados
-Bits 12-9:  Código de operación (opcode)
-Bit 8:      Selector de registro (0=X, 1=ACC)
-Bits 7-6:   Modo de direccionamiento (dirm)
-Bits 5-0:   Constante de dirección (cd)
-
-[000][OPCO][R][DI][CDCDCDCDCD]
-
-Para instrucciones extendidas (opcode=7):
-Bits 7-8 se usan como extended opcode
-*/
-
-#define OPCODE_SHIFT 9    // Desplazamiento para extraer opcode (bits 9-11)
-#define OPCODE_MASK 0x7   // Máscara para opcode (3 bits: 0-7)
-#define EXT_SHIFT 7       // Desplazamiento para extended opcode (bits 7-8)  
-#define EXT_MASK 0x3      // Máscara para extended opcode (2 bits: 0-3)
-
-
-// CONTEXTO DE INSTRUCCIÓN - PARA EJECUCIÓN EN DOS FASES
-// =====================================================
-
-/*
-  Contexto de Instrucción - Contiene toda la información decodificada
-  de una instrucción para separar fetch/decode de execute
+Estructura Engine - mapea nombres de motor a bucles de ejecución
+name: Nombre del motor (opción -e)
+run: Bucle que ejecuta hasta HALT y devuelve las instrucciones ejecutadas;
+     atiende las herramientas conectadas (traza -t, grabación -r/-p)
 */
 typedef struct {
-    uint8_t opcode;        // Código de operación principal (bits 9-11)
-    uint8_t reg;           // Registro seleccionado (0=X, 1=ACC)
-    uint8_t addr_mode;     // Modo de direccionamiento (bits 6-7)
-    uint16_t address;      // Constante de dirección (bits 0-5)
-    uint16_t eff_addr;     // Dirección Efectiva - dirección real en memoria
-    uint8_t is_extended;   // Flag: 1 si es instrucción extendida
-    uint8_t ext_opcode;    // Extended opcode (para opcode=7, bits 7-8)
-} InstructionContext;
-
-
-void store_data(CPU *cpu, uint8_t reg, uint16_t data);
-void load_data(CPU *cpu, uint8_t reg, uint16_t data);
-void add_data(CPU *cpu, uint8_t reg, uint16_t data);
-void branch_jump(CPU *cpu, uint8_t reg, uint16_t data);
-void branch_if_zero(CPU *cpu, uint8_t reg, uint16_t data);
-void clear_reg(CPU *cpu, uint8_t reg, uint16_t data);
-void decrement_reg(CPU *cpu, uint8_t reg, uint16_t data);
-void halt_cpu(CPU *cpu, uint8_t reg, uint16_t data);
-void enable_int(CPU *cpu, uint8_t reg, uint16_t data);
-void disable_int(CPU *cpu, uint8_t reg, uint16_t data);
-
-
-// TABLAS DE INSTRUCCIONES
-// =======================
-
-/*
-Estructura Instruction - mapea nombres a funciones ejecutoras
-name: Nombre mnemónico de la instrucción
-execute: Puntero a la función que implementa la instrucción
- */
-typedef struct {
-    char *name;                              // Nombre de la instrucción
-    void (*execute)(CPU *cpu, uint8_t reg, uint16_t data);  // Función ejecutora
-} Instruction;
-
-
-/*
-Tabla de instrucciones normales (opcodes 0-6)
-Índice: número de opcode
-Contenido: {nombre, función ejecutora}
-*/
-Instruction instruction_set[] = {
-    {"st", store_data},    // Opcode 0: Store
-    {"ld", load_data},     // Opcode 1: Load  
-    {"add", add_data},     // Opcode 2: Add
-    {"br", branch_jump},   // Opcode 3: Branch
-    {"bz", branch_if_zero},// Opcode 4: Branch if Zero
-    {"clr", clear_reg},    // Opcode 5: Clear
-    {"dec", decrement_reg} // Opcode 6: Decrement
+    char *name;
+    uint64_t (*run)(CPU *cpu, Herramientas *h);
+} Engine;
+
+Engine engines[] = {
+    {"debug", cpu_loop},                   // Paso a paso, muestra el estado y espera ENTER
+    {"incremental", cpu_loop_incremental}, // Paso a paso, muestra solo los cambios
+    {"batch", cpu_run}                     // Sin pausas ni trazas, para programas largos
 };
 
-/*
- Tabla de instrucciones extendidas (opcode 7 + extended opcode)  
- Índice: número de extended opcode
- Contenido: {nombre, función ejecutora}
- */
-Instruction extended_set[] = {
-    {"halt", halt_cpu},    // Extended 0: Halt
-    {"ei", enable_int},    // Extended 1: Enable Interrupts
-    {"di", disable_int}    // Extended 2: Disable Interrupts
-};
-
-
-// IMPLEMENTACIÓN DE LAS INSTRUCCIONES
-// ===================================
-
-/*
- ST - STORE: Almacena el valor de un registro en memoria
- - cpu Puntero a la estructura CPU
- - reg Registro fuente (0=X, 1=ACC)
- - eff_addr Dirección de memoria destino
-
- mem[eff_addr] = registro
- No afecta a ningún flag
-*/
-void store_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (reg) {
-        cpu->mem[eff_addr] = cpu->acc;  // Almacena ACC en memoria
-    } else {
-        cpu->mem[eff_addr] = cpu->x;    // Almacena X en memoria
-    }
-}
-
-/*
-LD - LOAD: Carga un valor de memoria a un registro
-Afecta al flag Z, basado en el valor cargado
-*/
-void load_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (reg) {
-        cpu->acc = cpu->mem[eff_addr];  // Carga memoria en ACC
-        cpu->status.z = (cpu->acc == 0);  // Actualiza flag Z basado en ACC
-    } else {
-        cpu->x = cpu->mem[eff_addr];    // Carga memoria en X
-        cpu->status.z = (cpu->x == 0);    // Actualiza flag Z basado en X
-    }
-}
-
-/*
-ADD - ADD: Suma un valor de memoria a un registro
-registro = registro + mem[eff_addr]
-Afecta al flag Z, basado en el valor cargado
-*/
-void add_data(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (reg) {
-        cpu->acc += cpu->mem[eff_addr];  // Suma a ACC
-        cpu->status.z = (cpu->acc == 0);
-    } else {
-        cpu->x += cpu->mem[eff_addr];    // Suma a X
-        cpu->status.z = (cpu->x == 0);
-    }
-}
-
-/*
-BR - BRANCH: Salto incondicional a una dirección
-pc = eff_addr
-NOTA: Decrementamos pc porque después se incrementa en el ciclo principal
-*/
-void branch_jump(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    cpu->pc = eff_addr;      // Salto a la dirección especificada
-    cpu->pc--;         // Compensación por el incremento posterior en el ciclo
-}
-
-/*
-BZ - BRANCH IF ZERO: Salto condicional si Z flag está activo
-Operación ==> if (Z) then pc = eff_addr
-*/
-void branch_if_zero(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (cpu->status.z) { 
-        cpu->pc = eff_addr;    
-        cpu->pc--;          // Compensación por el incremento posterior
-    }
-}
-
-/*
-CLR - CLEAR: Pone a cero un registro
-Z siempre se activa porque el resultado es 0
-*/
-void clear_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (reg) {
-        cpu->acc = 0;      // Limpia ACC
-    } else {
-        cpu->x = 0;        // Limpia X
-    }
-    cpu->status.z = 1;     // Siempre activa Z flag (resultado es 0)
-}
-
-/*
-DEC - DECREMENT: Decrementa un registro en 1
-*/
-void decrement_reg(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    if (reg) {
-        cpu->acc--;                    // Decrementa ACC
-        cpu->status.z = (cpu->acc == 0); // Actualiza Z flag
-    } else {
-        cpu->x--;                      // Decrementa X  
-        cpu->status.z = (cpu->x == 0);   // Actualiza Z flag
-    }
-}
-
-// INSTRUCCIONES EXTENDIDAS
-// ========================
-
-/*
-HALT - DETENER: Detiene la ejecución de la CPU
-*/
-void halt_cpu(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    cpu->status.h = 1;    // Activa Halt Flag
-    cpu->pc--;            // Mantiene pc en la misma instrucción
-}
-
-/*
-EI - ENABLE INTERRUPTS: Habilita las interrupciones
-*/
-void enable_int(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    cpu->status.i = 1;    // Activa Interrupt Flag
-}
-
-/*
-DI - DISABLE INTERRUPTS: Deshabilita las interrupciones  
-*/
-void disable_int(CPU *cpu, uint8_t reg, uint16_t eff_addr) {
-    cpu->status.i = 0;    // Desactiva Interrupt Flag
-}
-
-// FUNCIONES PRINCIPALES DE LA CPU
-// ===============================
-
-/*
- resetCPU - Inicializa la CPU a estado conocido
- cpu Puntero a la estructura CPU a resetear
-
- - Limpia toda la memoria (pone a 0)
- - Pone todos los registros a 0
- - Pone pc a 0 (inicio del programa)
- - Desactiva todos los flags de estado
- */
-void resetCPU(CPU *cpu)
-{
-    memset(cpu, 0, sizeof(CPU));
-    cpu->pc = 0;                
-}
-
-/*
-FASE 1: Obtiene y decodifica una instrucción
- cpu Puntero a la estructura CPU
- ctx Puntero al contexto donde almacenar la instrucción decodificada
-
- Esta función:
- 1. Obtiene la instrucción de mem[pc]
- 2. Decodifica todos los campos de la instrucción
- 3. Calcula la dirección efectiva según el modo de direccionamiento
- 4. Identifica si es instrucción extendida
- */
-void fetch_and_decode(CPU *cpu, InstructionContext *ctx) {
-    //FETCH - Obtener instrucción de la memoria en la posición pc
-    uint16_t inst_code = cpu->mem[cpu->pc];
-    
-    //DECODE - Extraer todos los campos de la instrucción
-    ctx->opcode = (inst_code >> OPCODE_SHIFT) & OPCODE_MASK;  // Bits 9-11
-    ctx->reg = (inst_code >> 8) & 0x1;                        // Bit 8
-    ctx->addr_mode = (inst_code >> 6) & 0x3;                  // Bits 6-7
-    ctx->address = inst_code & 0x3F;                          // Bits 0-5
-    
-    //CALCULAR DIRECCIÓN EFECTIVA según modo de direccionamiento
-    ctx->eff_addr = ctx->address;  // Por defecto: direccionamiento directo (addr_mode = 00)
-
-    if (ctx->addr_mode == 0x1) { // Aqui estamos haciendo una comparacion de addr_mode con una mascara para ver
-                            // si es igual a 01 que correspondería a modo indirecto en los bits 6-7
-        // Modo Indirecto: EA = contenido de mem[address]
-        ctx->eff_addr = cpu->mem[ctx->address];
-    }
-    else if (ctx->addr_mode == 0x2) {
-        // Modo Indexado: EA = address + registro X
-        ctx->eff_addr = ctx->address + cpu->x;
-    }
-    else if (ctx->addr_mode == 0x3) {
-        // Modo Indirecto Indexado: EA = contenido de mem[address + X]
-        ctx->eff_addr = cpu->mem[ctx->address + cpu->x];
-    }
-    
-    //IDENTIFICAR INSTRUCCIÓN EXTENDIDA
-    ctx->is_extended = (ctx->opcode == 7);
-    if (ctx->is_extended) {
-        ctx->ext_opcode = (inst_code >> EXT_SHIFT) & EXT_MASK;
-    }
-}
+#define NUM_ENGINES (sizeof(engines) / sizeof(engines[0]))
 
-/*
-FASE 2: Ejecuta una instrucción decodificada
- cpu Puntero a la estructura CPU
-
- Flujo:
- 1. Crea contexto y llama a fetch_and_decode()
- 2. Muestra información de depuración
- 3. Reinicia Zero Flag (según convención)
- 4. Ejecuta la instrucción usando las tablas
- 5. Incrementa el contador de programa
- */
-void execute_instruction(CPU *cpu)
+Engine *buscar_motor(const char *nombre)
 {
-    InstructionContext ctx;  // Contexto para esta instrucción
-    
-    //FETCH & DECODE
-    fetch_and_decode(cpu, &ctx);
-    
-    // Mostrar información de depuración
-    printf("DEBUG: op: %x, reg: %x, dirm: %x, cd: %x, ea: %x, data: %d\n", 
-           ctx.opcode, ctx.reg, ctx.addr_mode, ctx.address, ctx.eff_addr, ctx.eff_addr);
-    
-    // Reiniciar Zero Flag al inicio de cada instrucción, debido a que algunas instrucciones podrian no modificarlo y eso conllevaria a errores
-    cpu->status.z = 0;
-    
-    //EXECUTE - Usar tablas para ejecutar la instrucción correcta
-    if (ctx.is_extended) {
-        printf("Executing ext %s %x, %x\n", extended_set[ctx.ext_opcode].name, ctx.reg, ctx.eff_addr);
-        extended_set[ctx.ext_opcode].execute(cpu, ctx.reg, ctx.eff_addr);
-    } else {
-        printf("Executing %s %x, %x\n", instruction_set[ctx.opcode].name, ctx.reg, ctx.eff_addr);
-        instruction_set[ctx.opcode].execute(cpu, ctx.reg, ctx.eff_addr);
+    for (size_t i = 0; i < NUM_ENGINES; i++) {
+        if (strcmp(engines[i].name, nombre) == 0) return &engines[i];
     }
-    
-    // Avanzar a la siguiente instrucción (a menos que instrucción modifique pc)
-    cpu->pc++;
+    return NULL;
 }
 
-/*
- printCPUState - Muestra el estado actual de la CPU
- cpu Puntero a la estructura CPU
-
- Muestra:
- - Valores de registros principales (PC, X, ACC)
- - Estado de todos los flags
- - Primera parte de la memoria (30 palabras)
- */
-void printCPUState(CPU *cpu)
-{
-    // Registros principales
-    printf("PC:%x X:%x ACC:%x\n", cpu->pc, cpu->x, cpu->acc);
-    
-    // Flags de estado
-    printf("STATUS: [Z:%x N:%x C:%x I:%x V:%x H:%x]\n", 
-           cpu->status.z, cpu->status.n, cpu->status.c, 
-           cpu->status.i, cpu->status.v, cpu->status.h);
-
-    // Encontrar hasta dónde hay datos en memoria
-    int max_used = 0;
-    for (int i = MEM_SIZE - 1; i >= 0; i--) {
-        if (cpu->mem[i] != 0) {
-            max_used = i;
-            break;
-        }
-    }
-    
-    // Mostrar memoria usada + margen (mínimo 20 palabras)
-    int words_to_show = (max_used + 10 > 30) ? max_used + 10 : 30;
-    if (words_to_show > MEM_SIZE) words_to_show = MEM_SIZE;
-    
-    printf("Memory [0-%d]: ", words_to_show - 1);
-    for (int i = 0; i < words_to_show; i++)
-    {
-        printf("%x ", cpu->mem[i]);
-        if (i % 10 == 9) {
-            printf("\n");
-            if (i < words_to_show - 1) printf("               ");
-        }
-    }
-    printf("\n---\n");
-}
-
-/*
- cpu_loop - Bucle principal de ejecución de la CPU
- cpu Puntero a la estructura CPU
-
- Ciclo de ejecución:
- 1. Ejecutar instrucción actual
- 2. Mostrar estado
- 3. Esperar entrada del usuario (para depuración)
- 4. Repetir hasta que se active Halt Flag
- */
-void cpu_loop(CPU *cpu)
-{
-    // Ejecutar hasta que se active el Halt Flag
-    while (!cpu->status.h) {
-        execute_instruction(cpu);  // Ejecutar una instrucción
-        printCPUState(cpu);        // Mostrar estado resultante
-        getchar();                 // Pausa
-    }
-    printf("CPU Halted!\n");
-}
-
-#include <ctype.h>
-
 int cargarProgramaDesdeArchivo(CPU *cpu, const char *nombreArchivo) {
     FILE *file = fopen(nombreArchivo, "r");
     if (!file) {
@@ -438,6 +55,19 @@ int cargarProgramaDesdeArchivo(CPU *cpu, const char *nombreArchivo) {
         return -1;
     }
 
+    // Imagen binaria del ensamblador nativo: se copia tal cual
+    if (imagen_es_binaria(file)) {
+        long palabras = imagen_leer(file, cpu->mem, MEM_SIZE);
+        fclose(file);
+        if (palabras < 0) {
+            printf("Error: Imagen no válida: %s\n", nombreArchivo);
+            return -1;
+        }
+        if (palabras > 0) cpu->mem_hwm = (uint16_t)(palabras - 1);
+        printf("Se cargaron %ld palabras desde %s\n", palabras, nombreArchivo);
+        return (int)palabras;
+    }
+
     char linea[128];
     int i = 0;
 
@@ -465,42 +95,283 @@ int cargarProgramaDesdeArchivo(CPU *cpu, const char *nombreArchivo) {
     }
 
     fclose(file);
+    if (i > 0) cpu->mem_hwm = i - 1;
     printf("Se cargaron %d palabras desde %s\n", i, nombreArchivo);
     return i;
 }
 
-
+/*
+ cargarMapaJunto - Si junto al programa hay un mapa de fuente con su mismo
+ nombre (programa.img -> programa.map, lo que genera "ensamblador -g"), lo carga
+ Devuelve NULL si no lo hay.
+ */
+MapaFuente *cargarMapaJunto(const char *programa)
+{
+    char ruta[4096];
+    const char *barra = strrchr(programa, '/');
+    const char *punto = strrchr(programa, '.');
+    size_t base = punto && (!barra || punto > barra) ? (size_t)(punto - programa) : strlen(programa);
+    snprintf(ruta, sizeof(ruta), "%.*s.map", (int)base, programa);
+
+    FILE *f = fopen(ruta, "r");
+    if (!f) return NULL;
+    fclose(f);
+    MapaFuente *mapa = mapa_cargar(ruta);
+    if (mapa) printf("Mapa de fuente: %s\n", ruta);
+    return mapa;
+}
 
 
 // PROGRAMA PRINCIPAL
 // ==================
 
+void uso(const char *prog)
+{
+    printf("Uso: %s [opciones] <archivo_programa>\n", prog);
+    printf("     %s [opciones] -p <grabacion>\n", prog);
+    printf("  -e, --motor <nombre>    Motor de ejecución (por defecto: debug)\n");
+    printf("  -l, --listar-motores    Muestra los motores disponibles\n");
+    printf("  -s, --estadisticas      Escribe instrucciones, tiempo y ciclos en stderr\n");
+    printf("  -t, --traza <archivo>   Registra cada instrucción en una traza binaria\n");
+    printf("  -z, --comprimir         Traza comprimida por diferencias, con índice para saltos\n");
+    printf("  -r, --grabar <archivo>  Graba la ejecución para reproducirla después\n");
+    printf("  -p, --reproducir <archivo>  Reproduce una grabación comprobando sus hashes\n");
+    printf("  -i, --instantaneas <n>  Motores paso a paso: instantánea cada n instrucciones\n");
+    printf("                          para retroceder (por defecto %d)\n", HISTORIAL_INTERVALO);
+    printf("  -b, --breakpoint <pc[ si cond]>   Para antes de ejecutar la instrucción de pc\n");
+    printf("  -w, --watchpoint <dir[ si cond]>  Para después de escribir en mem[dir]\n");
+    printf("  -g, --gdb <puerto|ruta> En lugar de un motor, espera a GDB en 127.0.0.1:puerto\n");
+    printf("                          o en un socket Unix (si la ruta lleva '/')\n");
+    printf("  -f, --fuente <mapa>     Mapa de fuente (ensamblador -g) para mostrar las líneas\n");
+    printf("                          del .asm; por defecto, programa.map si existe\n");
+    printf("  -c, --ciclos <mul=N,div=N,mod=N>  Latencia de MUL/DIV/MOD en el modelo de ciclos\n");
+    printf("  -T, --temporizador <ciclos[,línea]>  Pide una interrupción (por defecto en la\n");
+    printf("                          línea 0) cada tantos ciclos emulados\n");
+    printf("  -E, --entrada <archivo> Entrada de la consola (por defecto stdin en batch y con\n");
+    printf("                          -g; los motores paso a paso leen de stdin sus comandos)\n");
+}
+
 /*
 1. Crear e inicializar CPU
-2. Cargar programa de ejemplo en memoria
+2. Leer opciones y cargar el programa en memoria
 3. Inicializar registros para prueba
-4. Iniciar bucle de ejecución
+4. Iniciar el bucle de ejecución del motor elegido
 */
 int main(int argc, char *argv[])
 {
     CPU cpu;
     resetCPU(&cpu);
 
-    if (argc < 2) {
-        printf("Uso: %s <archivo_programa>\n", argv[0]);
+    static struct option opciones[] = {
+        {"motor", required_argument, NULL, 'e'},
+        {"listar-motores", no_argument, NULL, 'l'},
+        {"estadisticas", no_argument, NULL, 's'},
+        {"traza", required_argument, NULL, 't'},
+        {"comprimir", no_argument, NULL, 'z'},
+        {"grabar", required_argument, NULL, 'r'},
+        {"reproducir", required_argument, NULL, 'p'},
+        {"instantaneas", required_argument, NULL, 'i'},
+        {"breakpoint", required_argument, NULL, 'b'},
+        {"watchpoint", required_argument, NULL, 'w'},
+        {"gdb", required_argument, NULL, 'g'},
+        {"fuente", required_argument, NULL, 'f'},
+        {"ciclos", required_argument, NULL, 'c'},
+        {"temporizador", required_argument, NULL, 'T'},
+        {"entrada", required_argument, NULL, 'E'},
+        {NULL, 0, NULL, 0}
+    };
+
+    Engine *motor = &engines[0];
+    int estadisticas = 0;
+    const char *archivo_traza = NULL;
+    int comprimir = 0;
+    const char *archivo_grabar = NULL;
+    const char *archivo_reproducir = NULL;
+    uint64_t intervalo_instantaneas = HISTORIAL_INTERVALO;
+    PuntosParada *puntos = NULL;
+    const char *direccion_gdb = NULL;
+    const char *archivo_mapa = NULL;
+    unsigned periodo = 0, linea_temporizador = 0;
+    const char *archivo_entrada = NULL;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "e:lst:zr:p:i:b:w:g:f:c:T:E:", opciones, NULL)) != -1) {
+        switch (c) {
+        case 'e':
+            motor = buscar_motor(optarg);
+            if (!motor) {
+                printf("Error: motor desconocido '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            for (size_t i = 0; i < NUM_ENGINES; i++) printf("%s\n", engines[i].name);
+            return 0;
+        case 's':
+            estadisticas = 1;
+            break;
+        case 't':
+            archivo_traza = optarg;
+            break;
+        case 'z':
+            comprimir = 1;
+            break;
+        case 'r':
+            archivo_grabar = optarg;
+            break;
+        case 'p':
+            archivo_reproducir = optarg;
+            break;
+        case 'i':
+            intervalo_instantaneas = strtoull(optarg, NULL, 0);
+            if (intervalo_instantaneas == 0) {
+                printf("Error: el intervalo de instantáneas debe ser mayor que 0\n");
+                return 1;
+            }
+            break;
+        case 'b':
+        case 'w':
+            if (!puntos && !(puntos = puntos_crear())) return 1;
+            if (puntos_definir(puntos, c == 'b' ? PUNTO_BREAKPOINT : PUNTO_ESCRITURA, optarg) < 0) {
+                return 1;
+            }
+            break;
+        case 'g':
+            direccion_gdb = optarg;
+            break;
+        case 'f':
+            archivo_mapa = optarg;
+            break;
+        case 'c':
+            if (ciclos_configurar(cpu.ciclos_latencia, optarg) < 0) {
+                printf("Error: latencias no válidas '%s' (p. ej. mul=4,div=12)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'T':
+            if (sscanf(optarg, "%u,%u", &periodo, &linea_temporizador) < 1 || periodo == 0 ||
+                linea_temporizador >= INT_LINEAS) {
+                printf("Error: temporizador no válido '%s' (p. ej. 1000 o 1000,2)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'E':
+            archivo_entrada = optarg;
+            break;
+        default:
+            uso(argv[0]);
+            return 1;
+        }
+    }
+
+    if (archivo_reproducir ? optind < argc || archivo_grabar : optind >= argc) {
+        uso(argv[0]);
         return 1;
     }
 
-    // Cargar programa desde archivo pasado como argumento
-    if (cargarProgramaDesdeArchivo(&cpu, argv[1]) < 0) {
+    Herramientas herramientas = {NULL, NULL, puntos, intervalo_instantaneas, NULL};
+    MapaFuente *mapa = NULL;
+    if (archivo_mapa && !(herramientas.mapa = mapa = mapa_cargar(archivo_mapa))) {
         return 1;
     }
+    if (archivo_reproducir) {
+        // La grabación trae la imagen inicial: no hace falta el programa
+        if (!(herramientas.grabacion = grabacion_abrir(archivo_reproducir, &cpu))) {
+            return 1;
+        }
+    } else {
+        // Cargar programa desde archivo pasado como argumento
+        if (cargarProgramaDesdeArchivo(&cpu, argv[optind]) < 0) {
+            return 1;
+        }
+        if (!archivo_mapa) herramientas.mapa = mapa = cargarMapaJunto(argv[optind]);
 
-    cpu.acc = 0;
-    cpu.x = 0;
+        cpu.acc = 0;
+        cpu.x = 0;
+        if (periodo) cpu_temporizador(&cpu, periodo, linea_temporizador);
+
+        // La grabación guarda el temporizador y las latencias (-T y -c)
+        if (archivo_grabar &&
+            !(herramientas.grabacion = grabacion_crear(archivo_grabar, &cpu,
+                                                       GRABACION_INTERVALO_HASH))) {
+            return 1;
+        }
+    }
+    // E/S estándar en ES_BASE. Los motores paso a paso leen sus comandos de
+    // stdin, así que allí la consola solo tiene entrada con -E; al reproducir
+    // la entrada sale de la grabación
+    int fd_entrada = -1;
+    if (archivo_reproducir) {
+        // Sin entrada
+    } else if (archivo_entrada) {
+        if ((fd_entrada = open(archivo_entrada, O_RDONLY)) < 0) {
+            printf("Error: No se pudo abrir '%s'\n", archivo_entrada);
+            return 1;
+        }
+    } else if (direccion_gdb || motor->run == cpu_run) {
+        fd_entrada = STDIN_FILENO;
+    }
+    Consola consola;
+    if (consola_iniciar(&consola, stdout, fd_entrada, herramientas.grabacion) < 0) return 1;
+    dispositivos_conectar(&cpu, &consola);
+
+    // Buffer de 2^16 registros (768 KB) entre el emulador y el hilo escritor
+    if (archivo_traza && !(herramientas.traza = traza_abrir(archivo_traza, 16, comprimir))) {
+        return 1;
+    }
 
     printf("Starting CPU emulation...\n");
-    cpu_loop(&cpu);
 
-    return 0;
+    // Ciclos del host solo si se piden estadísticas y hay contadores
+    Contadores contadores;
+    LecturaContadores c0, c1;
+    int hay_ciclos = estadisticas && contadores_abrir(&contadores);
+
+    if (hay_ciclos) contadores_leer(&contadores, &c0);
+    uint64_t t0 = reloj_ns();
+    uint64_t instrucciones = direccion_gdb ? gdb_servir(&cpu, &herramientas, direccion_gdb)
+                                           : motor->run(&cpu, &herramientas);
+    uint64_t ns = reloj_ns() - t0;
+    if (hay_ciclos) {
+        contadores_leer(&contadores, &c1);
+        contadores_cerrar(&contadores);
+    }
+
+    if (herramientas.traza) {
+        uint64_t esperas = herramientas.traza->esperas;
+        uint64_t registros = traza_cerrar(herramientas.traza);
+        printf("Traza: %llu registros en %s (buffer lleno %llu veces)\n",
+               (unsigned long long)registros, archivo_traza, (unsigned long long)esperas);
+    }
+
+    puntos_destruir(puntos);
+    mapa_destruir(mapa);
+    consola_cerrar(&consola);
+    if (archivo_entrada && fd_entrada >= 0) close(fd_entrada);
+
+    int resultado = 0;
+    if (herramientas.grabacion) {
+        uint64_t hashes = herramientas.grabacion->hashes;
+        resultado = grabacion_cerrar(herramientas.grabacion, &cpu);
+        if (archivo_reproducir && resultado == 0) {
+            printf("Reproducción verificada: %llu instrucciones, %llu hashes coinciden\n",
+                   (unsigned long long)cpu.icount, (unsigned long long)hashes + 1);
+        } else if (archivo_grabar && resultado == 0) {
+            printf("Grabación: %llu instrucciones en %s\n",
+                   (unsigned long long)cpu.icount, archivo_grabar);
+        }
+    }
+
+    // Línea fácil de parsear por benchmarks/bench.py
+    if (estadisticas) {
+        fprintf(stderr, "motor=%s instrucciones=%llu tiempo_ns=%llu mips=%.3f",
+                direccion_gdb ? "gdb" : motor->name, (unsigned long long)instrucciones, (unsigned long long)ns,
+                ns ? instrucciones * 1000.0 / ns : 0.0);
+        if (hay_ciclos) {
+            fprintf(stderr, " ciclos=%llu", (unsigned long long)(c1.ciclos - c0.ciclos));
+        }
+        fprintf(stderr, " ciclos_emulados=%llu\n", (unsigned long long)cpu.ciclos);
+    }
+
+    return resultado < 0;
 }
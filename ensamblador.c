@@ -0,0 +1,1220 @@
+/*
+ ensamblador.c - Ensamblador nativo de una pasada
+
+ Acepta la sintaxis de ensamblador.py y añade:
+ - Etiquetas: "bucle:" delante de una instrucción (o sola en su línea) vale
+   la dirección de la siguiente instrucción
+ - Constantes: "contador = 20"
+ - Símbolos en operandos y datos: BR [bucle], LD ACC,[[tabla+X]],
+   mem[contador] = fin, con desplazamientos (tabla+2, fin-1)
+ - Formato largo (dos palabras, dirección completa): se elige solo si la
+   dirección ya se conoce y no cabe en cd; con el sufijo .L (LD.L, BR.L)
+   se fuerza, para referencias a símbolos que se definen más adelante
+ - Operando inmediato en LD, ADD, la ALU y MUL/DIV/MOD: LD ACC,#5, SUB X,#-1,
+   AND ACC,#0xFF00 (los literales de más de 6 bits van en formato largo)
+ - Copia y relleno de bloques: MOVE ACC,[destino] copia X palabras desde
+   mem[ACC] y FILL ACC,[destino] escribe ACC en X palabras
+ - Subrutinas y pila: JSR [rutina], RTS, PUSH ACC, POP X
+ - Interrupciones: EI, DI y RTI; los vectores se ponen como datos,
+   mem[3840 + línea] = rutina
+
+ Se lee el fuente una sola vez. Una referencia a un símbolo que aún no está
+ definido deja un fixup (la palabra a corregir) encadenado al símbolo; al
+ definirlo se recorre su cadena y se parchean las palabras. Lo que queda sin
+ definir al final es un error. Los símbolos están en una tabla hash con
+ direccionamiento abierto, así que cada línea cuesta lo mismo sea cual sea
+ el tamaño del programa.
+
+ La salida es una imagen binaria (imagen.h) que el emulador carga
+ directamente y, con -g, un mapa de fuente (mapa.h) para que el emulador y
+ el analizador muestren la línea del .asm de cada dirección. Con -O pasa
+ antes por el optimizador peephole (ver OPTIMIZACIÓN PEEPHOLE).
+
+ Compilación:
+     gcc -O2 ensamblador.c imagen.c -o ensamblador
+ Uso:
+     ./ensamblador [-g] [-O] [-o salida.img] programa.asm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+
+#include "cpu.h"
+#include "dispositivos.h"
+#include "imagen.h"
+#include "mapa.h"
+
+#define MAX_ERRORES 20
+#define MAX_CD 0x3F               // Constante de dirección: 6 bits
+
+#define BIT(mapa, i) (((mapa)[(i) >> 6] >> ((i) & 63)) & 1)
+#define PONER_BIT(mapa, i) ((mapa)[(i) >> 6] |= 1ull << ((i) & 63))
+
+
+// TABLAS
+// ======
+
+typedef enum {
+    CLASE_MEMORIA,                // INSTR REG,OPERANDO
+    CLASE_SALTO,                  // BR/BZ/JSR: el registro se puede omitir
+    CLASE_REGISTRO,               // CLR/DEC/PUSH/POP: solo registro
+    CLASE_EXTENDIDA,              // HALT/EI/DI/RTS: sin operandos
+    CLASE_SOLA                    // RTI: sin operandos, con opcode propio
+} ClaseInstruccion;
+
+typedef struct {
+    const char *nombre;
+    uint8_t opcode;               // Opcode, o extended opcode si es CLASE_EXTENDIDA
+    ClaseInstruccion clase;
+} Mnemonico;
+
+// Mismos códigos que instruction_set/extended_set en cpu.c
+static const Mnemonico mnemonicos[] = {
+    {"ST", 0, CLASE_MEMORIA},
+    {"LD", 1, CLASE_MEMORIA},
+    {"ADD", 2, CLASE_MEMORIA},
+    {"BR", 3, CLASE_SALTO},
+    {"BZ", 4, CLASE_SALTO},
+    {"CLR", 5, CLASE_REGISTRO},
+    {"DEC", 6, CLASE_REGISTRO},
+    {"SUB", 8, CLASE_MEMORIA},
+    {"AND", 9, CLASE_MEMORIA},
+    {"OR", 10, CLASE_MEMORIA},
+    {"XOR", 11, CLASE_MEMORIA},
+    {"CMP", 12, CLASE_MEMORIA},
+    {"SHL", 13, CLASE_MEMORIA},
+    {"SHR", 14, CLASE_MEMORIA},
+    {"JSR", 15, CLASE_SALTO},
+    {"MUL", 16, CLASE_MEMORIA},
+    {"DIV", 17, CLASE_MEMORIA},
+    {"MOD", 18, CLASE_MEMORIA},
+    {"MOVE", 19, CLASE_MEMORIA},
+    {"FILL", 20, CLASE_MEMORIA},
+    {"PUSH", 21, CLASE_REGISTRO},
+    {"POP", 22, CLASE_REGISTRO},
+    {"RTI", OP_RTI, CLASE_SOLA},
+    {"HALT", 0, CLASE_EXTENDIDA},
+    {"EI", 1, CLASE_EXTENDIDA},
+    {"DI", 2, CLASE_EXTENDIDA},
+    {"RTS", EXT_RTS, CLASE_EXTENDIDA}
+};
+
+#define NUM_MNEMONICOS (sizeof(mnemonicos) / sizeof(mnemonicos[0]))
+
+
+// SÍMBOLOS Y FIXUPS
+// =================
+
+/*
+ Palabra que hay que corregir cuando se defina un símbolo
+ FIX_CD: campo cd (6 bits) de una instrucción; FIX_PALABRA: un dato entero;
+ FIX_LARGA: segunda palabra (la dirección) de una instrucción en formato largo;
+ FIX_LITERAL, FIX_LITERAL_LARGO: lo mismo con un operando inmediato
+ */
+typedef enum { FIX_CD, FIX_PALABRA, FIX_LARGA, FIX_LITERAL, FIX_LITERAL_LARGO } TipoFixup;
+
+typedef struct {
+    uint16_t dir;
+    uint8_t tipo;                 // TipoFixup
+    int32_t desplazamiento;       // Se suma al valor del símbolo
+    int32_t siguiente;            // Siguiente fixup del mismo símbolo (-1: fin)
+    uint32_t linea;
+    int8_t codigo;                // Etiquetas de código ya sumadas (ver Expresion)
+} Fixup;
+
+/*
+ Símbolo: el nombre apunta al fuente, que sigue en memoria hasta el final
+ fixups: Primer fixup pendiente (-1: ninguno)
+ */
+typedef struct {
+    const char *nombre;
+    uint32_t len;
+    uint32_t hash;
+    int32_t valor;
+    int definido;
+    int32_t fixups;
+    uint32_t linea;               // Primera referencia o definición
+    uint8_t codigo;               // Es una dirección de código (etiqueta o constante igual a una)
+} Simbolo;
+
+/*
+ Origen de una palabra para el mapa de fuente (-g)
+ texto: Instrucción o dato tal como está en el fuente, sin comentario
+ etiqueta: Última etiqueta antes de la instrucción (NULL en los datos)
+ */
+typedef struct {
+    const char *texto;
+    const char *etiqueta;
+    uint32_t linea;
+    uint16_t len_texto;
+    uint16_t len_etiqueta;
+    uint16_t desplazamiento;      // Dirección - valor de la etiqueta
+} Origen;
+
+typedef struct {
+    const char *archivo;
+    uint32_t linea;
+    unsigned errores;
+
+    uint16_t mem[MEM_SIZE];
+    uint64_t usada[MEM_SIZE / 64];    // Palabras ya ocupadas por código o datos
+    uint64_t reubicar[MEM_SIZE / 64]; // Datos cuyo valor es una dirección de código (-O)
+    uint64_t segunda[MEM_SIZE / 64];  // Segundas palabras de instrucciones en formato largo
+    uint32_t pc;                      // Dirección de la siguiente instrucción
+    uint32_t fin;                     // Última palabra usada + 1
+    uint32_t literales_codigo;        // Operandos inmediatos que valen una dirección de código
+
+    Simbolo *simbolos;                // Tabla hash (capacidad potencia de 2)
+    uint32_t capacidad, num_simbolos;
+    Fixup fixups[MEM_SIZE];           // Como mucho uno por palabra
+    uint32_t num_fixups;
+
+    Origen origen[MEM_SIZE];
+    const char *texto;                // Instrucción o dato de la línea actual
+    uint32_t len_texto;
+    const char *etiqueta;             // Última etiqueta definida (nombre y valor)
+    uint32_t len_etiqueta;
+    int32_t valor_etiqueta;
+} Ensamblador;
+
+static void error(Ensamblador *a, uint32_t linea, const char *formato, ...)
+{
+    va_list args;
+    if (++a->errores > MAX_ERRORES) return;
+    fprintf(stderr, "%s:%u: error: ", a->archivo, linea);
+    va_start(args, formato);
+    vfprintf(stderr, formato, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+static uint32_t hash_nombre(const char *s, uint32_t len)
+{
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+static void crecer_tabla(Ensamblador *a)
+{
+    Simbolo *viejos = a->simbolos;
+    uint32_t capacidad = a->capacidad;
+
+    a->capacidad = capacidad ? capacidad * 2 : 1024;
+    a->simbolos = calloc(a->capacidad, sizeof(Simbolo));
+    if (!a->simbolos) {
+        fprintf(stderr, "Error: sin memoria para la tabla de símbolos\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < capacidad; i++) {
+        if (!viejos[i].nombre) continue;
+        uint32_t j = viejos[i].hash & (a->capacidad - 1);
+        while (a->simbolos[j].nombre) j = (j + 1) & (a->capacidad - 1);
+        a->simbolos[j] = viejos[i];
+    }
+    free(viejos);
+}
+
+// Busca un símbolo y lo crea (sin definir) si no existe
+static Simbolo *simbolo(Ensamblador *a, const char *nombre, uint32_t len)
+{
+    if (2 * (a->num_simbolos + 1) > a->capacidad) crecer_tabla(a);
+
+    uint32_t h = hash_nombre(nombre, len);
+    uint32_t i = h & (a->capacidad - 1);
+    for (;; i = (i + 1) & (a->capacidad - 1)) {
+        Simbolo *s = &a->simbolos[i];
+        if (!s->nombre) {
+            s->nombre = nombre;
+            s->len = len;
+            s->hash = h;
+            s->fixups = -1;
+            s->linea = a->linea;
+            a->num_simbolos++;
+            return s;
+        }
+        if (s->hash == h && s->len == len && memcmp(s->nombre, nombre, len) == 0) return s;
+    }
+}
+
+/*
+ Aplica un valor ya resuelto a la palabra de un fixup
+ codigo Etiquetas de código en la expresión (sumadas menos restadas): si es
+        1 el valor es una dirección de código y el optimizador lo reubica
+ */
+static void parchear(Ensamblador *a, uint16_t dir, TipoFixup tipo, int32_t valor, uint32_t linea,
+                     int codigo)
+{
+    if (tipo == FIX_PALABRA) {
+        a->mem[dir] = (uint16_t)valor;
+        if (codigo == 1) a->reubicar[dir >> 6] |= 1ull << (dir & 63);
+    } else if (tipo == FIX_LARGA) {
+        if (valor < 0 || valor >= MEM_SIZE) {
+            error(a, linea, "dirección fuera de la memoria (0-%d): %d", MEM_SIZE - 1, valor);
+        }
+        a->mem[dir] = (uint16_t)valor;
+    } else if (tipo == FIX_LITERAL_LARGO || tipo == FIX_LITERAL) {
+        if (codigo == 1) a->literales_codigo++;
+        if (tipo == FIX_LITERAL_LARGO && (valor < -0x8000 || valor > 0xFFFF)) {
+            error(a, linea, "literal fuera de rango (-32768-65535): %d", valor);
+        } else if (tipo == FIX_LITERAL_LARGO) {
+            a->mem[dir] = (uint16_t)valor;
+        } else if (valor < 0 || valor > MAX_CD) {
+            error(a, linea, "literal fuera de rango (0-%d): %d (usa el formato largo, p. ej. LD.L)",
+                  MAX_CD, valor);
+        } else {
+            a->mem[dir] |= (uint16_t)valor;
+        }
+    } else if (valor < 0 || valor > MAX_CD) {
+        error(a, linea, "dirección fuera de rango (0-%d): %d (usa el formato largo, p. ej. LD.L)",
+              MAX_CD, valor);
+    } else {
+        a->mem[dir] |= (uint16_t)valor;
+    }
+}
+
+static void definir(Ensamblador *a, Simbolo *s, int32_t valor, int codigo)
+{
+    if (s->definido) {
+        error(a, a->linea, "'%.*s' ya estaba definido en la línea %u", (int)s->len, s->nombre, s->linea);
+        return;
+    }
+    s->definido = 1;
+    s->valor = valor;
+    s->linea = a->linea;
+    s->codigo = codigo == 1;
+
+    // Resolver las referencias anteriores
+    for (int32_t i = s->fixups; i >= 0; i = a->fixups[i].siguiente) {
+        const Fixup *f = &a->fixups[i];
+        parchear(a, f->dir, f->tipo, valor + f->desplazamiento, f->linea, f->codigo + s->codigo);
+    }
+    s->fixups = -1;
+}
+
+
+// ANÁLISIS DE LÍNEAS
+// ==================
+
+/*
+ Valor de una expresión: número o suma de términos (números y símbolos).
+ Si tiene un símbolo aún sin definir, pendiente apunta a él y valor es el
+ desplazamiento que se le sumará.
+ codigo: Etiquetas de código sumadas menos restadas (1: es una dirección de
+         código; "fin-inicio" no lo es)
+ */
+typedef struct {
+    int32_t valor;
+    Simbolo *pendiente;
+    int codigo;
+} Expresion;
+
+typedef struct {
+    const char *p, *fin;          // Resto de la línea (sin comentario)
+} Linea;
+
+static void saltar_espacios(Linea *l)
+{
+    while (l->p < l->fin && (*l->p == ' ' || *l->p == '\t' || *l->p == '\r')) l->p++;
+}
+
+static int es_inicio_nombre(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.';
+}
+
+static int es_nombre(char c)
+{
+    return es_inicio_nombre(c) || (c >= '0' && c <= '9');
+}
+
+// Longitud del identificador que empieza en l->p (0 si no hay)
+static uint32_t longitud_nombre(const Linea *l)
+{
+    const char *q = l->p;
+    if (q >= l->fin || !es_inicio_nombre(*q)) return 0;
+    while (q < l->fin && es_nombre(*q)) q++;
+    return (uint32_t)(q - l->p);
+}
+
+static int igual_sin_mayusculas(const char *s, uint32_t len, const char *palabra)
+{
+    uint32_t i = 0;
+    for (; i < len && palabra[i]; i++) {
+        char c = s[i];
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if (c != palabra[i]) return 0;
+    }
+    return i == len && palabra[i] == '\0';
+}
+
+static int aceptar(Linea *l, char c)
+{
+    saltar_espacios(l);
+    if (l->p < l->fin && *l->p == c) {
+        l->p++;
+        return 1;
+    }
+    return 0;
+}
+
+// ¿Sigue "+X" (índice) en lugar de un término más?
+static int sigue_indice(Linea l)
+{
+    if (!aceptar(&l, '+')) return 0;
+    saltar_espacios(&l);
+    uint32_t n = longitud_nombre(&l);
+    return n && igual_sin_mayusculas(l.p, n, "X");
+}
+
+static int leer_numero(Ensamblador *a, Linea *l, int32_t *valor)
+{
+    const char *q = l->p;
+    uint32_t v = 0;
+    if (q + 1 < l->fin && q[0] == '0' && (q[1] == 'x' || q[1] == 'X')) {
+        q += 2;
+        const char *inicio = q;
+        for (; q < l->fin; q++) {
+            int d = (*q >= '0' && *q <= '9') ? *q - '0'
+                  : (*q >= 'a' && *q <= 'f') ? *q - 'a' + 10
+                  : (*q >= 'A' && *q <= 'F') ? *q - 'A' + 10 : -1;
+            if (d < 0) break;
+            v = v * 16 + (uint32_t)d;
+        }
+        if (q == inicio) return -1;
+    } else {
+        for (; q < l->fin && *q >= '0' && *q <= '9'; q++) v = v * 10 + (uint32_t)(*q - '0');
+    }
+    if (v > 0xFFFF) {
+        error(a, a->linea, "número fuera de rango (0-0xFFFF): %.*s", (int)(q - l->p), l->p);
+    }
+    l->p = q;
+    *valor = (int32_t)v;
+    return 0;
+}
+
+/*
+ leer_expresion - termino (('+'|'-') termino)*, sin consumir un "+X" final
+ Devuelve -1 (tras avisar) si no hay expresión o tiene más de un símbolo
+ sin definir.
+ */
+static int leer_expresion(Ensamblador *a, Linea *l, Expresion *e)
+{
+    int signo = 1;
+    e->valor = 0;
+    e->pendiente = NULL;
+    e->codigo = 0;
+
+    for (;;) {
+        int32_t v;
+        saltar_espacios(l);
+        uint32_t n = longitud_nombre(l);
+        if (n) {
+            if (igual_sin_mayusculas(l->p, n, "X") || igual_sin_mayusculas(l->p, n, "ACC")) {
+                error(a, a->linea, "registro en lugar de dirección: %.*s", (int)n, l->p);
+                return -1;
+            }
+            Simbolo *s = simbolo(a, l->p, n);
+            l->p += n;
+            if (s->definido) {
+                v = s->valor;
+                e->codigo += signo * s->codigo;
+            } else if (signo < 0 || e->pendiente) {
+                error(a, a->linea, "'%.*s' debe estar definido antes de usarlo así", (int)n, s->nombre);
+                return -1;
+            } else {
+                e->pendiente = s;
+                v = 0;
+            }
+        } else if (l->p < l->fin && *l->p >= '0' && *l->p <= '9') {
+            if (leer_numero(a, l, &v) < 0) {
+                error(a, a->linea, "número no válido");
+                return -1;
+            }
+        } else {
+            error(a, a->linea, "se esperaba un número o un símbolo");
+            return -1;
+        }
+        e->valor += signo * v;
+
+        if (sigue_indice(*l)) return 0;
+        if (aceptar(l, '+')) signo = 1;
+        else if (aceptar(l, '-')) signo = -1;
+        else return 0;
+    }
+}
+
+static int fin_de_linea(Ensamblador *a, Linea *l)
+{
+    saltar_espacios(l);
+    if (l->p < l->fin) {
+        error(a, a->linea, "texto de más: %.*s", (int)(l->fin - l->p), l->p);
+        return -1;
+    }
+    return 0;
+}
+
+// Marca dir como usada; -1 (tras avisar) si ya lo estaba o no existe
+static int ocupar(Ensamblador *a, uint32_t dir, const char *que)
+{
+    if (dir >= MEM_SIZE) {
+        error(a, a->linea, "%s fuera de la memoria (%u)", que, dir);
+        return -1;
+    }
+    if ((a->usada[dir >> 6] >> (dir & 63)) & 1) {
+        error(a, a->linea, "mem[%u] se solapa con el código o con otro dato", dir);
+        return -1;
+    }
+    a->usada[dir >> 6] |= 1ull << (dir & 63);
+    if (dir + 1 > a->fin) a->fin = dir + 1;
+
+    Origen *o = &a->origen[dir];
+    o->texto = a->texto;
+    o->len_texto = (uint16_t)a->len_texto;
+    o->linea = a->linea;
+    return 0;
+}
+
+/*
+ Guarda el valor de e en la palabra dir (o en su campo cd); si tiene un
+ símbolo pendiente, encadena un fixup
+ */
+static void resolver(Ensamblador *a, uint16_t dir, TipoFixup tipo, const Expresion *e)
+{
+    if (!e->pendiente) {
+        parchear(a, dir, tipo, e->valor, a->linea, e->codigo);
+        return;
+    }
+    Fixup *f = &a->fixups[a->num_fixups];
+    f->dir = dir;
+    f->tipo = tipo;
+    f->desplazamiento = e->valor;
+    f->linea = a->linea;
+    f->codigo = (int8_t)e->codigo;
+    f->siguiente = e->pendiente->fixups;
+    e->pendiente->fixups = (int32_t)a->num_fixups++;
+}
+
+// mem[DIR] = VALOR
+static void dato(Ensamblador *a, Linea *l)
+{
+    Expresion dir, valor;
+    if (leer_expresion(a, l, &dir) < 0) return;
+    if (dir.pendiente) {
+        error(a, a->linea, "la dirección de un dato no puede usar '%.*s' antes de definirlo",
+              (int)dir.pendiente->len, dir.pendiente->nombre);
+        return;
+    }
+    if (!aceptar(l, ']') || !aceptar(l, '=')) {
+        error(a, a->linea, "se esperaba mem[DIR] = VALOR");
+        return;
+    }
+    if (leer_expresion(a, l, &valor) < 0 || fin_de_linea(a, l) < 0) return;
+    // Como en ensamblador.py, los datos van detrás del código ya ensamblado
+    if (dir.valor < (int32_t)a->pc) {
+        error(a, a->linea, "mem[%d] se solapa con el código o con otro dato", dir.valor);
+        return;
+    }
+    if (ocupar(a, (uint32_t)dir.valor, "dato") < 0) return;
+    resolver(a, (uint16_t)dir.valor, FIX_PALABRA, &valor);
+}
+
+/*
+ Operando inmediato: #e o #-e (el símbolo de -e tiene que estar definido)
+ Devuelve 0 o -1
+ */
+static int literal(Ensamblador *a, Linea *l, Expresion *e)
+{
+    int negativo = aceptar(l, '-');
+    if (leer_expresion(a, l, e) < 0) return -1;
+    if (negativo) {
+        if (e->pendiente) {
+            error(a, a->linea, "'%.*s' debe estar definido antes de usarlo así",
+                  (int)e->pendiente->len, e->pendiente->nombre);
+            return -1;
+        }
+        e->valor = -e->valor;
+        e->codigo = -e->codigo;
+    }
+    if (sigue_indice(*l)) {
+        error(a, a->linea, "un operando inmediato no se indexa");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ Operando de memoria: [e], [[e]], [e+X] o [[e+X]]
+ Devuelve el modo de direccionamiento (DIRM) o -1
+ */
+static int operando(Ensamblador *a, Linea *l, Expresion *e)
+{
+    if (!aceptar(l, '[')) {
+        error(a, a->linea, "se esperaba un operando [DIR]");
+        return -1;
+    }
+    int indirecto = aceptar(l, '[');
+    if (leer_expresion(a, l, e) < 0) return -1;
+
+    int indexado = 0;
+    if (sigue_indice(*l)) {
+        aceptar(l, '+');
+        saltar_espacios(l);
+        l->p++;               // X
+        indexado = 1;
+    }
+    if ((indirecto && !aceptar(l, ']')) || !aceptar(l, ']')) {
+        error(a, a->linea, "falta ']'");
+        return -1;
+    }
+    // DIRM: 0 directo, 1 indirecto, 2 indexado, 3 indirecto indexado
+    return indexado << 1 | indirecto;
+}
+
+// Registro X o ACC; devuelve el bit R o -1
+static int registro(Ensamblador *a, Linea *l)
+{
+    saltar_espacios(l);
+    uint32_t n = longitud_nombre(l);
+    int r = n && igual_sin_mayusculas(l->p, n, "ACC") ? 1 : n && igual_sin_mayusculas(l->p, n, "X") ? 0 : -1;
+    if (r < 0) {
+        error(a, a->linea, "registro desconocido: %.*s", n ? (int)n : (int)(l->fin - l->p), l->p);
+        return -1;
+    }
+    l->p += n;
+    return r;
+}
+
+/*
+ instruccion - Ensambla una instrucción en a->pc
+ largo Se pidió el formato largo con el sufijo .L; sin él se usa si la
+       dirección ya se conoce y no cabe en cd
+ */
+static void instruccion(Ensamblador *a, Linea *l, const Mnemonico *m, int largo)
+{
+    uint16_t palabra;
+    Expresion cd = {0, NULL, 0};
+    int inmediato = 0;
+
+    if (largo && m->clase != CLASE_MEMORIA && m->clase != CLASE_SALTO) {
+        error(a, a->linea, "%s no lleva dirección: no tiene formato largo", m->nombre);
+        return;
+    }
+    if (m->clase == CLASE_EXTENDIDA) {
+        if (fin_de_linea(a, l) < 0) return;
+        palabra = (uint16_t)(7 << OPCODE_SHIFT | m->opcode << EXT_SHIFT);
+    } else if (m->clase == CLASE_SOLA) {
+        if (fin_de_linea(a, l) < 0) return;
+        palabra = (uint16_t)(m->opcode << OPCODE_SHIFT);
+    } else {
+        int reg = 1, dirm = 0;
+
+        // En los saltos el registro se puede omitir (queda ACC, como en ensamblador.py)
+        saltar_espacios(l);
+        if (m->clase != CLASE_SALTO || l->p >= l->fin || *l->p != '[') {
+            if ((reg = registro(a, l)) < 0) return;
+            if (m->clase != CLASE_REGISTRO && !aceptar(l, ',')) {
+                error(a, a->linea, "falta ',' después del registro");
+                return;
+            }
+        }
+        if (m->clase == CLASE_MEMORIA && aceptar(l, '#')) {
+            if (!((OPCODES_LEEN_DATO >> m->opcode) & 1)) {
+                error(a, a->linea, "%s no admite un operando inmediato", m->nombre);
+                return;
+            }
+            if (literal(a, l, &cd) < 0) return;
+            inmediato = 1;
+        } else if (m->clase != CLASE_REGISTRO && (dirm = operando(a, l, &cd)) < 0) {
+            return;
+        }
+        if (fin_de_linea(a, l) < 0) return;
+        if (!cd.pendiente && (cd.valor > MAX_CD || cd.valor < 0)) largo = 1;
+        palabra = (uint16_t)(m->opcode << OPCODE_SHIFT | reg << 8 | dirm << 6);
+        if (inmediato) palabra |= INMEDIATO_BIT;
+    }
+
+    if (ocupar(a, a->pc, "código") < 0) return;
+    if (largo && ocupar(a, a->pc + 1, "código") < 0) return;
+    Origen *o = &a->origen[a->pc];
+    o->etiqueta = a->etiqueta;
+    o->len_etiqueta = (uint16_t)a->len_etiqueta;
+    o->desplazamiento = (uint16_t)(a->pc - (uint32_t)a->valor_etiqueta);
+    if (largo) {
+        a->mem[a->pc] = palabra | LARGO_BIT;
+        PONER_BIT(a->segunda, a->pc + 1);
+        resolver(a, (uint16_t)(a->pc + 1), inmediato ? FIX_LITERAL_LARGO : FIX_LARGA, &cd);
+        a->pc += 2;
+        return;
+    }
+    a->mem[a->pc] = palabra;
+    resolver(a, (uint16_t)a->pc, inmediato ? FIX_LITERAL : FIX_CD, &cd);
+    a->pc++;
+}
+
+static void ensamblar_linea(Ensamblador *a, Linea *l)
+{
+    for (;;) {
+        saltar_espacios(l);
+        if (l->p >= l->fin) return;
+
+        uint32_t n = longitud_nombre(l);
+        if (!n) {
+            error(a, a->linea, "línea no válida: %.*s", (int)(l->fin - l->p), l->p);
+            return;
+        }
+        const char *nombre = l->p;
+        l->p += n;
+
+        // Texto para el mapa de fuente: la línea sin etiquetas ni comentario
+        const char *fin = l->fin;
+        while (fin > nombre && (fin[-1] == ' ' || fin[-1] == '\t' || fin[-1] == '\r')) fin--;
+        a->texto = nombre;
+        a->len_texto = (uint32_t)(fin - nombre);
+
+        // mem[DIR] = VALOR
+        if (igual_sin_mayusculas(nombre, n, "MEM") && aceptar(l, '[')) {
+            dato(a, l);
+            return;
+        }
+
+        // Etiqueta: puede haber una instrucción detrás
+        if (aceptar(l, ':')) {
+            definir(a, simbolo(a, nombre, n), (int32_t)a->pc, 1);
+            a->etiqueta = nombre;
+            a->len_etiqueta = n;
+            a->valor_etiqueta = (int32_t)a->pc;
+            continue;
+        }
+
+        // Sufijo ".L": formato largo
+        int largo = n > 2 && nombre[n - 2] == '.' && (nombre[n - 1] == 'L' || nombre[n - 1] == 'l');
+        for (size_t i = 0; i < NUM_MNEMONICOS; i++) {
+            if (igual_sin_mayusculas(nombre, largo ? n - 2 : n, mnemonicos[i].nombre)) {
+                instruccion(a, l, &mnemonicos[i], largo);
+                return;
+            }
+        }
+
+        // Constante: NOMBRE = EXPRESIÓN (con símbolos ya definidos)
+        Expresion e;
+        if (aceptar(l, '=')) {
+            if (leer_expresion(a, l, &e) < 0 || fin_de_linea(a, l) < 0) return;
+            if (e.pendiente) {
+                error(a, a->linea, "'%.*s' debe estar definido antes de usarlo en una constante",
+                      (int)e.pendiente->len, e.pendiente->nombre);
+                return;
+            }
+            definir(a, simbolo(a, nombre, n), e.valor, e.codigo);
+            return;
+        }
+        error(a, a->linea, "instrucción desconocida: %.*s", (int)n, nombre);
+        return;
+    }
+}
+
+/*
+ ensamblar - Ensambla el fuente completo (texto en memoria de len bytes)
+ Devuelve el número de errores.
+ */
+static unsigned ensamblar(Ensamblador *a, const char *texto, size_t len)
+{
+    const char *p = texto, *fin_texto = texto + len;
+
+    while (p < fin_texto) {
+        const char *eol = memchr(p, '\n', (size_t)(fin_texto - p));
+        if (!eol) eol = fin_texto;
+        a->linea++;
+
+        // Quitar comentarios: "//" o ";"
+        Linea l = {p, eol};
+        for (const char *q = p; q < eol; q++) {
+            if (*q == ';' || (*q == '/' && q + 1 < eol && q[1] == '/')) {
+                l.fin = q;
+                break;
+            }
+        }
+        ensamblar_linea(a, &l);
+        p = eol + 1;
+    }
+
+    // Lo que sigue con fixups es una referencia a un símbolo que no se definió
+    for (uint32_t i = 0; i < a->capacidad; i++) {
+        const Simbolo *s = &a->simbolos[i];
+        if (s->nombre && !s->definido) {
+            uint32_t linea = s->fixups >= 0 ? a->fixups[s->fixups].linea : s->linea;
+            error(a, linea, "símbolo sin definir: %.*s", (int)s->len, s->nombre);
+        }
+    }
+    if (a->errores > MAX_ERRORES) {
+        fprintf(stderr, "%s: %u errores (solo se muestran %d)\n", a->archivo, a->errores, MAX_ERRORES);
+    }
+    return a->errores;
+}
+
+// OPTIMIZACIÓN PEEPHOLE (-O)
+// ==========================
+
+/*
+ Se hace sobre el código ya ensamblado (mem[0..pc-1]), en rondas hasta que
+ ninguna regla cambia nada:
+ - Encadenar saltos: BR/BZ a un BR salta directamente a su destino (y BZ a
+   un BZ también: Z no cambia al saltar)
+ - BR a la instrucción siguiente: se elimina
+ - ST r,[a] seguido de LD r,[a]: el LD sobra si nadie lee el Z que deja
+ - CLR r seguido de ADD r,[a]: es LD r,[a]
+ - ST a [a] que se sobrescribe antes de leerse: se elimina
+
+ JSR no se encadena ni se elimina, pero su destino y la instrucción que le
+ sigue (donde vuelve RTS) cuentan como destinos de salto y el destino se
+ reubica al compactar. Un ST seguido de JSR, PUSH o POP no se da por muerto:
+ la subrutina o la pila podrían leerlo.
+
+ Z se pone a 0 antes de cada instrucción salvo BZ (ver execute_decoded), así
+ que solo un BZ inmediatamente posterior lee el Z de la anterior: quitar una o
+ cambiar por dónde pasa un salto solo es válido si la siguiente no es un BZ
+ (z_muerto). N, C y V no los lee ninguna instrucción, así que no se conservan
+ (CLR+ADD los deja a 0 y LD no los toca).
+
+ Al final se compacta el código y se reubican los destinos de los saltos,
+ las etiquetas y los datos que valen una dirección de código. Las
+ instrucciones en formato largo se tratan como una sola: su segunda palabra
+ se salta al recorrer el código y se elimina o se mueve con ella. Una
+ instrucción a la que se puede saltar (destino de un salto o etiqueta) no
+ se funde con la anterior. Como las direcciones cambian, no se optimiza
+ código que se lee o escribe a sí mismo ni con saltos indirectos o
+ indexados, cuyo destino no se conoce. Tampoco un programa que ejecuta EI:
+ una rutina de interrupción puede entrar entre dos instrucciones cualesquiera
+ y ver lo que el optimizador quitó.
+ */
+
+#define OP_ST 0
+#define OP_LD 1
+#define OP_ADD 2
+#define OP_BR 3
+#define OP_BZ 4
+#define OP_CLR 5
+#define OP_DEC 6
+#define OP_EXT 7
+#define OP_JSR 15
+
+// ¿La instrucción lee o escribe mem[eff_addr]? (no con operando inmediato;
+// MOVE/FILL escriben un bloque que empieza ahí)
+#define ACCEDE_DATO(w) (instruccion_lee_dato(w) || instruccion_escribe_dato(w) || instruccion_bloque(w))
+
+#define OPCODE(w) (((w) >> OPCODE_SHIFT) & OPCODE_MASK)
+#define DIRM(w) (((w) >> 6) & 0x3)
+#define CD(w) ((w) & MAX_CD)
+
+typedef struct {
+    uint64_t eliminada[MEM_SIZE / 64];
+    uint64_t destino[MEM_SIZE / 64];      // Se puede llegar saltando
+    unsigned eliminadas, encadenados, fundidas;
+} Optimizacion;
+
+static int es_salto_directo(uint16_t w)
+{
+    return (OPCODE(w) == OP_BR || OPCODE(w) == OP_BZ) && DIRM(w) == 0;
+}
+
+static int es_llamada_directa(uint16_t w)
+{
+    return OPCODE(w) == OP_JSR && DIRM(w) == 0;
+}
+
+// Primera instrucción no eliminada desde i (a->pc si no queda ninguna)
+static uint32_t viva(const Ensamblador *a, const Optimizacion *o, uint32_t i)
+{
+    while (i < a->pc && (BIT(o->eliminada, i) || BIT(a->segunda, i))) i++;
+    return i;
+}
+
+// Dirección del operando de la instrucción i: cd, o su segunda palabra en formato largo
+static uint16_t direccion(const Ensamblador *a, uint32_t i)
+{
+    return a->mem[i] & LARGO_BIT ? a->mem[i + 1] : CD(a->mem[i]);
+}
+
+// Cambia la dirección del operando; 0 si no cabe en cd
+static int poner_direccion(Ensamblador *a, uint32_t i, uint32_t dir)
+{
+    if (a->mem[i] & LARGO_BIT) a->mem[i + 1] = (uint16_t)dir;
+    else if (dir <= MAX_CD) a->mem[i] = (uint16_t)((a->mem[i] & ~MAX_CD) | dir);
+    else return 0;
+    return 1;
+}
+
+// Motivo por el que no se puede optimizar, o NULL
+static const char *impide_optimizar(const Ensamblador *a)
+{
+    if (a->literales_codigo) return "hay operandos inmediatos que valen una dirección de código";
+    for (uint32_t i = 0; i < a->pc; i++) {
+        if (BIT(a->segunda, i)) continue;
+        uint16_t w = a->mem[i];
+        uint8_t op = OPCODE(w);
+        if ((op == OP_BR || op == OP_BZ || op == OP_JSR) && DIRM(w) != 0) {
+            return "hay saltos indirectos o indexados";
+        }
+        if ((es_salto_directo(w) || es_llamada_directa(w)) && BIT(a->segunda, direccion(a, i))) {
+            return "hay saltos a la segunda palabra de una instrucción";
+        }
+        if (ACCEDE_DATO(w) && direccion(a, i) < a->pc) return "el programa accede a su propio código";
+        if (op == OP_EXT && ((w >> EXT_SHIFT) & EXT_MASK) == 1) {
+            return "el programa habilita interrupciones";   // Una rutina puede entrar en cualquier punto
+        }
+    }
+    return NULL;
+}
+
+// Marca lo que se alcanza saltando a dir (si se eliminó, la siguiente viva)
+static void marcar_destino(const Ensamblador *a, Optimizacion *o, uint32_t dir)
+{
+    dir = viva(a, o, dir);
+    if (dir < a->pc) PONER_BIT(o->destino, dir);
+}
+
+static void marcar_destinos(const Ensamblador *a, Optimizacion *o)
+{
+    memset(o->destino, 0, sizeof(o->destino));
+    marcar_destino(a, o, 0);                  // Entrada del programa
+    for (uint32_t i = viva(a, o, 0); i < a->pc; i = viva(a, o, i + 1)) {
+        uint16_t w = a->mem[i];
+        if ((es_salto_directo(w) || es_llamada_directa(w)) && direccion(a, i) < a->pc) {
+            marcar_destino(a, o, direccion(a, i));
+        }
+        if (OPCODE(w) == OP_JSR) marcar_destino(a, o, i + palabras_instruccion(w));   // Vuelta de RTS
+    }
+    for (uint32_t i = 0; i < a->capacidad; i++) {
+        const Simbolo *s = &a->simbolos[i];
+        if (s->nombre && s->codigo && s->valor >= 0 && (uint32_t)s->valor < a->pc) {
+            marcar_destino(a, o, (uint32_t)s->valor);
+        }
+    }
+    for (uint32_t i = a->pc; i < a->fin; i++) {
+        if (BIT(a->reubicar, i) && a->mem[i] < a->pc) marcar_destino(a, o, a->mem[i]);
+    }
+}
+
+// Quien saltaba a i llega ahora a la siguiente instrucción viva
+static void eliminar(const Ensamblador *a, Optimizacion *o, uint32_t i)
+{
+    PONER_BIT(o->eliminada, i);
+    if (a->mem[i] & LARGO_BIT) PONER_BIT(o->eliminada, i + 1);
+    if (BIT(o->destino, i)) marcar_destino(a, o, i + 1);
+}
+
+/*
+ z_muerto - ¿Nadie lee el Z que queda antes de la instrucción i?
+ execute_decoded() pone Z a 0 antes de cada instrucción salvo BZ, así que
+ solo lo lee un BZ inmediatamente después.
+ */
+static int z_muerto(const Ensamblador *a, const Optimizacion *o, uint32_t i)
+{
+    i = viva(a, o, i);
+    return i >= a->pc || OPCODE(a->mem[i]) != OP_BZ;
+}
+
+/*
+ ¿dir está en la página de E/S estándar (dispositivos.h)? Allí cada lectura
+ y escritura es una operación del dispositivo: no se quitan ni se funden
+ */
+static int es_entrada_salida(uint32_t dir)
+{
+    return ((dir & (MEM_SIZE - 1)) >> BITS_PAGINA) == (ES_BASE >> BITS_PAGINA);
+}
+
+/*
+ store_muerto - ¿Se vuelve a escribir mem[dir] antes de leerla, siguiendo el
+ código desde i? Cualquier acceso no directo podría leerla.
+ */
+static int store_muerto(const Ensamblador *a, const Optimizacion *o, uint32_t i, uint16_t dir)
+{
+    if (es_entrada_salida(dir)) return 0;
+    for (i = viva(a, o, i); i < a->pc; i = viva(a, o, i + 1)) {
+        uint16_t w = a->mem[i];
+        uint8_t op = OPCODE(w);
+        if (op == OP_CLR || op == OP_DEC || (w & INMEDIATO_BIT)) continue;   // No tocan memoria
+        if (!ACCEDE_DATO(w) || DIRM(w) != 0 || instruccion_bloque(w)) return 0;
+        if (direccion(a, i) == dir) return op == OP_ST;
+    }
+    return 0;
+}
+
+// Una ronda de todas las reglas; devuelve cuántos cambios hizo
+static unsigned ronda(Ensamblador *a, Optimizacion *o)
+{
+    unsigned cambios = 0;
+    marcar_destinos(a, o);
+
+    for (uint32_t i = viva(a, o, 0); i < a->pc; i = viva(a, o, i + 1)) {
+        uint16_t w = a->mem[i];
+        uint8_t op = OPCODE(w);
+        uint32_t sig = viva(a, o, i + 1);
+
+        if (es_salto_directo(w) && direccion(a, i) < a->pc) {
+            // Encadenar: seguir BR (o BZ desde un BZ) mientras haya; el límite corta los bucles
+            uint32_t destino = viva(a, o, direccion(a, i));
+            int por_br = 0;
+            for (unsigned n = 0; n < a->pc && destino < a->pc; n++) {
+                uint16_t d = a->mem[destino];
+                if (!es_salto_directo(d) || (OPCODE(d) == OP_BZ && (op != OP_BZ || por_br)) ||
+                    direccion(a, destino) >= a->pc) {
+                    break;
+                }
+                por_br |= OPCODE(d) == OP_BR;
+                destino = viva(a, o, direccion(a, destino));
+            }
+            // Un BZ que pasaba por un BR llegaba con Z = 0: si allí hay otro BZ, no se encadena
+            if (op == OP_BZ && por_br && !z_muerto(a, o, destino)) destino = viva(a, o, direccion(a, i));
+            if (destino != direccion(a, i) && poner_direccion(a, i, destino)) {
+                o->encadenados++;
+                cambios++;
+            }
+            // Saltar a la siguiente instrucción es no hacer nada (salvo el Z = 0 de BR)
+            if (destino == sig && (op == OP_BZ || z_muerto(a, o, sig))) {
+                eliminar(a, o, i);
+                cambios++;
+            }
+            continue;
+        }
+        if (sig >= a->pc) break;
+        uint16_t s = a->mem[sig];
+
+        // ST r,[a]; LD r,[a]: el registro ya tiene ese valor. Solo en RAM: con
+        // índice la dirección podría caer en la página de E/S
+        if (op == OP_ST && OPCODE(s) == OP_LD && ((s ^ w) & (INMEDIATO_BIT | 0x1C0)) == 0 &&
+            direccion(a, sig) == direccion(a, i) && DIRM(w) == 0 &&
+            !es_entrada_salida(direccion(a, i)) &&
+            !BIT(o->destino, sig) && z_muerto(a, o, sig + 1)) {
+            eliminar(a, o, sig);
+            cambios++;
+            continue;
+        }
+        // CLR r; ADD r,[a] -> LD r,[a] (mismo valor y mismo Z)
+        if (op == OP_CLR && OPCODE(s) == OP_ADD && ((s >> 8) & 1) == ((w >> 8) & 1) &&
+            !BIT(o->destino, sig)) {
+            a->mem[sig] = (uint16_t)((s & ~(OPCODE_MASK << OPCODE_SHIFT)) | OP_LD << OPCODE_SHIFT);
+            eliminar(a, o, i);
+            o->fundidas++;
+            cambios++;
+            continue;
+        }
+        // Store que se sobrescribe sin leerse (también deja Z = 0)
+        if (op == OP_ST && DIRM(w) == 0 && z_muerto(a, o, sig) &&
+            store_muerto(a, o, sig, direccion(a, i))) {
+            eliminar(a, o, i);
+            cambios++;
+        }
+    }
+    return cambios;
+}
+
+/*
+ compactar - Quita las instrucciones eliminadas y reubica las direcciones
+ de código: destinos de salto, etiquetas, datos y el mapa de fuente
+ */
+static void compactar(Ensamblador *a, Optimizacion *o)
+{
+    static uint16_t nueva[MEM_SIZE + 1];     // Dirección vieja -> nueva
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < a->pc; i++) {
+        nueva[i] = (uint16_t)n;
+        if (!BIT(o->eliminada, i)) n++;
+        else o->eliminadas++;
+    }
+    nueva[a->pc] = (uint16_t)n;
+
+    // La segunda palabra de un salto largo se corrige antes de moverla (j <= i)
+    static uint64_t segunda[MEM_SIZE / 64];
+    memset(segunda, 0, sizeof(segunda));
+    for (uint32_t i = 0, j = 0; i < a->pc; i++) {
+        if (BIT(o->eliminada, i)) continue;
+        if (BIT(a->segunda, i)) PONER_BIT(segunda, j);
+        else if ((es_salto_directo(a->mem[i]) || es_llamada_directa(a->mem[i])) &&
+                 direccion(a, i) <= a->pc) {
+            poner_direccion(a, i, nueva[direccion(a, i)]);
+        }
+        uint16_t w = a->mem[i];
+
+        Origen origen = a->origen[i];
+        if (origen.etiqueta) {
+            uint32_t etiqueta = i - origen.desplazamiento;
+            origen.desplazamiento = (uint16_t)(j - nueva[etiqueta]);
+        }
+        a->mem[j] = w;
+        a->origen[j++] = origen;
+    }
+    memcpy(a->segunda, segunda, sizeof(segunda));
+    for (uint32_t i = n; i < a->pc; i++) {
+        a->mem[i] = 0;
+        memset(&a->origen[i], 0, sizeof(Origen));
+        a->usada[i >> 6] &= ~(1ull << (i & 63));
+    }
+
+    for (uint32_t i = a->pc; i < a->fin; i++) {
+        if (BIT(a->reubicar, i) && a->mem[i] <= a->pc) a->mem[i] = nueva[a->mem[i]];
+    }
+    for (uint32_t i = 0; i < a->capacidad; i++) {
+        Simbolo *s = &a->simbolos[i];
+        if (s->nombre && s->codigo && s->valor >= 0 && (uint32_t)s->valor <= a->pc) {
+            s->valor = nueva[s->valor];
+        }
+    }
+    a->pc = n;
+}
+
+/*
+ optimizar - Pasada peephole sobre el código ensamblado
+ Devuelve las instrucciones eliminadas.
+ */
+static unsigned optimizar(Ensamblador *a)
+{
+    static Optimizacion o;
+    const char *motivo = impide_optimizar(a);
+    if (motivo) {
+        fprintf(stderr, "%s: aviso: sin optimizar: %s\n", a->archivo, motivo);
+        return 0;
+    }
+
+    // Cada ronda solo acorta el código o los saltos; el límite es por si acaso
+    memset(&o, 0, sizeof(o));
+    for (int n = 0; n < 64 && ronda(a, &o); n++) {
+    }
+    compactar(a, &o);
+    printf("Optimización: %u instrucciones eliminadas, %u saltos encadenados, %u CLR+ADD -> LD\n",
+           o.eliminadas, o.encadenados, o.fundidas);
+    return o.eliminadas;
+}
+
+/*
+ escribir_mapa - Mapa de fuente (mapa.h): una línea por palabra usada
+ Los tabuladores del texto se cambian por espacios, que separan campos.
+ */
+static int escribir_mapa(const Ensamblador *a, const char *ruta)
+{
+    FILE *f = fopen(ruta, "w");
+    if (!f) {
+        printf("Error: No se pudo crear el mapa de fuente %s\n", ruta);
+        return -1;
+    }
+    fprintf(f, "%s\t%s\n", MAPA_MAGIA, a->archivo);
+    for (uint32_t dir = 0; dir < a->fin; dir++) {
+        const Origen *o = &a->origen[dir];
+        if (!o->texto) continue;
+
+        fprintf(f, "%u\t%u\t", dir, o->linea);
+        if (!o->etiqueta) fputc('-', f);
+        else if (o->desplazamiento) fprintf(f, "%.*s+%u", o->len_etiqueta, o->etiqueta, o->desplazamiento);
+        else fprintf(f, "%.*s", o->len_etiqueta, o->etiqueta);
+        fputc('\t', f);
+        for (uint32_t i = 0; i < o->len_texto; i++) fputc(o->texto[i] == '\t' ? ' ' : o->texto[i], f);
+        fputc('\n', f);
+    }
+    if (ferror(f) | fclose(f)) {
+        printf("Error: Mapa de fuente incompleto: %s\n", ruta);
+        return -1;
+    }
+    return 0;
+}
+
+// ruta con la extensión cambiada (o añadida): programa.asm -> programa.img
+static void cambiar_extension(char *destino, size_t tam, const char *ruta, const char *extension)
+{
+    const char *barra = strrchr(ruta, '/');
+    const char *punto = strrchr(ruta, '.');
+    size_t base = punto && (!barra || punto > barra) ? (size_t)(punto - ruta) : strlen(ruta);
+    snprintf(destino, tam, "%.*s%s", (int)base, ruta, extension);
+}
+
+static char *leer_archivo(const char *ruta, size_t *len)
+{
+    FILE *f = fopen(ruta, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    rewind(f);
+    char *texto = n >= 0 ? malloc((size_t)n + 1) : NULL;
+    if (texto && fread(texto, 1, (size_t)n, f) != (size_t)n) {
+        free(texto);
+        texto = NULL;
+    }
+    fclose(f);
+    *len = (size_t)n;
+    return texto;
+}
+
+static void uso(const char *prog)
+{
+    printf("Uso: %s [-g] [-O] [-o salida.img] <programa.asm>\n", prog);
+    printf("  -o, --salida <archivo>  Imagen binaria (por defecto, el programa con extensión .img)\n");
+    printf("  -g, --mapa              Genera también el mapa de fuente (la imagen con extensión .map)\n");
+    printf("  -O, --optimizar         Pasada peephole: quita instrucciones redundantes y encadena saltos\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option opciones[] = {
+        {"salida", required_argument, NULL, 'o'},
+        {"mapa", no_argument, NULL, 'g'},
+        {"optimizar", no_argument, NULL, 'O'},
+        {NULL, 0, NULL, 0}
+    };
+    const char *salida = NULL;
+    int con_mapa = 0, optimizacion = 0;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "o:gO", opciones, NULL)) != -1) {
+        switch (c) {
+        case 'o':
+            salida = optarg;
+            break;
+        case 'g':
+            con_mapa = 1;
+            break;
+        case 'O':
+            optimizacion = 1;
+            break;
+        default:
+            uso(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        uso(argv[0]);
+        return 1;
+    }
+
+    static Ensamblador a;
+    a.archivo = argv[optind];
+    size_t len;
+    char *texto = leer_archivo(a.archivo, &len);
+    if (!texto) {
+        printf("Error: No se pudo leer %s\n", a.archivo);
+        return 1;
+    }
+
+    // Nombres de salida: programa.asm -> programa.img (y programa.map)
+    char ruta[4096], ruta_mapa[4096];
+    if (!salida) {
+        cambiar_extension(ruta, sizeof(ruta), a.archivo, ".img");
+        salida = ruta;
+    }
+    cambiar_extension(ruta_mapa, sizeof(ruta_mapa), salida, ".map");
+
+    int resultado = 1;
+    unsigned errores = ensamblar(&a, texto, len);
+    if (errores == 0 && optimizacion) optimizar(&a);
+    if (errores == 0 && imagen_escribir(salida, a.mem, a.fin) == 0 &&
+        (!con_mapa || escribir_mapa(&a, ruta_mapa) == 0)) {
+        printf("Ensamblado %s: %u palabras, %u símbolos -> %s\n", a.archivo, a.fin, a.num_simbolos, salida);
+        if (con_mapa) printf("Mapa de fuente: %s\n", ruta_mapa);
+        resultado = 0;
+    }
+    free(texto);
+    free(a.simbolos);
+    return resultado;
+}
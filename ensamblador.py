@@ -14,71 +14,241 @@ OPCODES = {
     "BZ": 4,
     "CLR": 5,
     "DEC": 6,
-    "HALT": 7
+    "HALT": 7,
+    "SUB": 8,
+    "AND": 9,
+    "OR": 10,
+    "XOR": 11,
+    "CMP": 12,
+    "SHL": 13,
+    "SHR": 14,
+    "JSR": 15,
+    "MUL": 16,
+    "DIV": 17,
+    "MOD": 18,
+    "MOVE": 19,
+    "FILL": 20,
+    "PUSH": 21,
+    "POP": 22,
+    "RTI": 23
 }
 
+# Instrucciones extendidas (opcode 7, extended opcode en bits 7-8)
+EXTENDIDAS = {
+    "HALT": 0,
+    "EI": 1,
+    "DI": 2,
+    "RTS": 3
+}
+
+# Instrucciones sin operandos con su propio opcode
+SIN_OPERANDOS = ("RTI",)
+
+# Instrucciones que solo usan el registro (sin operando de memoria)
+SOLO_REGISTRO = ("CLR", "DEC", "PUSH", "POP")
+
+# Instrucciones de salto: el registro no se usa, se permite omitirlo
+SALTOS = ("BR", "BZ", "JSR")
+
+# Instrucciones que admiten operando inmediato (#n): el operando es el propio
+# n en lugar de mem[EA]. Se marca con el bit 14; n va en CD si cabe en 6 bits
+# y si no en la palabra siguiente (formato largo), de -32768 a 65535.
+INMEDIATAS = ("LD", "ADD", "SUB", "AND", "OR", "XOR", "CMP", "SHL", "SHR", "MUL", "DIV", "MOD")
+INMEDIATO_BIT = 0x4000
+
+# Modos de direccionamiento (campo DIRM, bits 6-7):
+#   [n]      Directo            EA = n
+#   [[n]]    Indirecto          EA = mem[n]
+#   [n+X]    Indexado           EA = n + X
+#   [[n+X]]  Indirecto indexado EA = mem[n + X]
+# Si n no cabe en los 6 bits de CD se usa el formato largo: la instrucción
+# lleva el bit 15 y n va en la palabra siguiente (el sufijo .L lo fuerza).
+MAX_CD = 0x3F
+LARGO_BIT = 0x8000
+MEM_SIZE = 4096
+NUMERO = r'(0X[0-9A-F]+|\d+)'
+MODOS = [
+    (re.compile(r'^\[\[' + NUMERO + r'\]\]$'), 1),
+    (re.compile(r'^\[\[' + NUMERO + r'\+X\]\]$'), 3),
+    (re.compile(r'^\[' + NUMERO + r'\+X\]$'), 2),
+    (re.compile(r'^\[' + NUMERO + r'\]$'), 0),
+]
+
+def quitar_comentario(linea):
+    for marca in ("//", ";"):
+        pos = linea.find(marca)
+        if pos >= 0:
+            linea = linea[:pos]
+    return linea.strip()
+
+def parsear_operando(operando):
+    operando = operando.replace(" ", "")
+    for patron, dirm in MODOS:
+        match = patron.match(operando)
+        if match:
+            cd = int(match.group(1), 0)
+            if cd >= MEM_SIZE:
+                raise ValueError(f"Dirección fuera de la memoria (0-{MEM_SIZE - 1}): {operando}")
+            return dirm, cd
+    raise ValueError(f"Operando no válido: {operando}")
+
+def parsear_literal(operando, instr):
+    if instr not in INMEDIATAS:
+        raise ValueError(f"{instr} no admite un operando inmediato")
+    texto = operando.replace(" ", "")[1:]
+    try:
+        n = int(texto, 0)
+    except ValueError:
+        raise ValueError(f"Literal no válido: {operando}")
+    if not -0x8000 <= n <= 0xFFFF:
+        raise ValueError(f"Literal fuera de rango (-32768-65535): {operando}")
+    return n
+
 def ensamblar_linea(linea):
-    linea = linea.strip().upper()
+    """Devuelve (valor, texto, direccion) o None si la línea no tiene código.
+
+    direccion es la segunda palabra de una instrucción en formato largo, o None.
+    """
+    linea = quitar_comentario(linea.upper())
 
     # Ignorar líneas vacías o comentarios
-    if not linea or linea.startswith(";"):
+    if not linea:
         return None
 
-    # Instrucción HALT
-    if linea.startswith("HALT"):
-        return "0xE00, // HALT"
+    partes = linea.split(None, 1)
+    instr = partes[0]
+    resto = partes[1].strip() if len(partes) > 1 else ""
+    largo = instr.endswith(".L")
+    if largo:
+        instr = instr[:-2]
+
+    # Instrucciones extendidas: HALT, EI, DI, RTS
+    if instr in EXTENDIDAS:
+        ext = EXTENDIDAS[instr]
+        if largo:
+            raise ValueError(f"{instr} no lleva dirección: no tiene formato largo")
+        valor = (OPCODES["HALT"] << 9) | (ext << 7)
+        return valor, instr, None
 
-    # Coincidir instrucciones tipo: INSTR REG,[ADDR]
-    match = re.match(r'(\w+)\s+(\w+),\s*\[(\d+)\]', linea)
-    if not match:
-        return None  # Puede ser un dato (mem[...]) o comentario
+    if instr in SIN_OPERANDOS:
+        if largo:
+            raise ValueError(f"{instr} no lleva dirección: no tiene formato largo")
+        if resto:
+            raise ValueError(f"{instr} no lleva operandos: {linea}")
+        return OPCODES[instr] << 9, instr, None
 
-    instr, reg, addr = match.groups()
-    addr = int(addr)
     if instr not in OPCODES:
         raise ValueError(f"Instrucción desconocida: {instr}")
 
+    # Separar registro y operando: "ACC,[5]", "X", "[5]"
+    reg, operando = "ACC", ""
+    if resto.startswith("["):
+        if instr not in SALTOS:
+            raise ValueError(f"Falta el registro en: {linea}")
+        operando = resto
+    else:
+        reg, _, operando = (p.strip() for p in resto.partition(","))
+    if reg not in ("ACC", "X"):
+        raise ValueError(f"Registro desconocido: {reg}")
+
+    dirm, cd, inmediato = 0, 0, 0
+    if operando.startswith("#"):
+        cd = parsear_literal(operando, instr)
+        inmediato = INMEDIATO_BIT
+    elif instr in SOLO_REGISTRO:
+        if operando:
+            raise ValueError(f"{instr} no lleva operando: {linea}")
+        if largo:
+            raise ValueError(f"{instr} no lleva dirección: no tiene formato largo")
+    else:
+        dirm, cd = parsear_operando(operando)
+
     opcode = OPCODES[instr]
     reg_bit = 1 if reg == "ACC" else 0
-    dirm = 0  # modo directo
 
-    valor = (opcode << 9) | (reg_bit << 8) | (dirm << 6) | (addr & 0x3F)
-    return f"0x{valor:03X}, // {instr} {reg},[{addr}]"
+    texto = f"{instr} {reg}" + (f",{operando}" if operando else "")
+    if largo or not 0 <= cd <= MAX_CD:
+        valor = LARGO_BIT | inmediato | (opcode << 9) | (reg_bit << 8) | (dirm << 6)
+        return valor, texto, cd & 0xFFFF
+    valor = inmediato | (opcode << 9) | (reg_bit << 8) | (dirm << 6) | cd
+    return valor, texto, None
 
 def parsear_datos(linea):
     linea = linea.strip()
     # Coincidir: mem[xx] = valor
-    match = re.match(r'MEM\[(\d+)\]\s*=\s*(0X[0-9A-F]+|\d+)', linea, re.IGNORECASE)
+    match = re.match(r'MEM\[(0X[0-9A-F]+|\d+)\]\s*=\s*(0X[0-9A-F]+|\d+)', linea, re.IGNORECASE)
     if match:
-        direccion = int(match.group(1))
+        direccion = int(match.group(1), 0)
         valor_str = match.group(2)
         valor = int(valor_str, 0)  # interpreta decimal o hexadecimal
         return direccion, valor
     return None
 
-def ensamblar_archivo(nombre):
+def ensamblar_lineas(lineas):
+    """Ensambla líneas de código fuente.
+
+    Devuelve (instrucciones, datos): las instrucciones como (valor, texto) en
+    orden y los datos como (dirección, valor) ordenados por dirección.
+    """
     instrucciones = []
     datos = []
 
-    with open(nombre, "r") as f:
-        for linea in f:
-            # Intentar dato primero
-            dato = parsear_datos(linea)
-            if dato:
-                datos.append(dato)
-                continue
-
-            # Intentar instrucción
-            cod = ensamblar_linea(linea)
-            if cod:
-                instrucciones.append(cod)
+    for linea in lineas:
+        # Intentar dato primero
+        dato = parsear_datos(linea)
+        if dato:
+            datos.append(dato)
+            continue
+
+        # Intentar instrucción (en formato largo, dos palabras)
+        cod = ensamblar_linea(linea)
+        if cod:
+            valor, texto, direccion = cod
+            instrucciones.append((valor, texto))
+            if direccion is not None:
+                instrucciones.append((direccion, f"  dirección de {texto}"))
 
     # Ordenar datos por dirección
     datos.sort(key=lambda x: x[0])
+    return instrucciones, datos
+
+def colocar_datos(instrucciones, datos):
+    """Recorre los datos en el orden en que se cargan en memoria.
 
-    # Formatear salida
-    salida = "\n".join(instrucciones) + "\n\n"
+    El emulador carga las palabras en orden desde mem[0], así que los huecos
+    entre el código y los datos se rellenan con 0. Genera (dirección, valor)
+    para cada palabra a partir del final del código.
+    """
+    siguiente = len(instrucciones)
     for dir, val in datos:
+        if dir < siguiente:
+            raise ValueError(f"mem[{dir}] se solapa con el código o con otro dato")
+        for hueco in range(siguiente, dir):
+            yield hueco, 0
+        yield dir, val
+        siguiente = dir + 1
+
+def ensamblar_imagen(fuente):
+    """Ensambla en memoria, sin archivos.
+
+    fuente: texto del programa o iterable de líneas
+    Devuelve la imagen de memoria: lista de palabras desde mem[0], lista para
+    emu.Emulador.cargar().
+    """
+    if isinstance(fuente, str):
+        fuente = fuente.splitlines()
+    instrucciones, datos = ensamblar_lineas(fuente)
+    imagen = [v for v, _ in instrucciones]
+    imagen.extend(val & 0xFFFF for _, val in colocar_datos(instrucciones, datos))
+    return imagen
+
+def ensamblar_archivo(nombre):
+    with open(nombre, "r") as f:
+        instrucciones, datos = ensamblar_lineas(f)
+
+    # Formatear salida: código y después los datos con sus huecos
+    salida = "\n".join(f"0x{v:03X}, // {t}" for v, t in instrucciones) + "\n\n"
+    for dir, val in colocar_datos(instrucciones, datos):
         salida += f"{val}, // mem[{dir}]\n"
 
     return salida.strip()
@@ -109,3 +279,4 @@ if __name__ == "__main__":
 
     except Exception as e:
         print(f"⚠️ Error: {e}")
+        sys.exit(1)
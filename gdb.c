@@ -0,0 +1,603 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "gdb.h"
+#include "puntos.h"
+
+
+// Registros en el orden de "g"/"G" y de los números de "p"/"P"
+enum { REG_ACC, REG_X, REG_PC, REG_STATUS, REG_SP, NUM_REGISTROS };
+
+static const char target_xml[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+    "<target version=\"1.0\">\n"
+    "  <feature name=\"org.emulador.cpu\">\n"
+    "    <flags id=\"status_flags\" size=\"2\">\n"
+    "      <field name=\"Z\" start=\"0\" end=\"0\"/>\n"
+    "      <field name=\"N\" start=\"1\" end=\"1\"/>\n"
+    "      <field name=\"C\" start=\"2\" end=\"2\"/>\n"
+    "      <field name=\"I\" start=\"3\" end=\"3\"/>\n"
+    "      <field name=\"V\" start=\"4\" end=\"4\"/>\n"
+    "      <field name=\"H\" start=\"5\" end=\"5\"/>\n"
+    "    </flags>\n"
+    "    <reg name=\"acc\" bitsize=\"16\" type=\"uint16\" regnum=\"0\"/>\n"
+    "    <reg name=\"x\" bitsize=\"16\" type=\"uint16\"/>\n"
+    "    <reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+    "    <reg name=\"status\" bitsize=\"16\" type=\"status_flags\"/>\n"
+    "    <reg name=\"sp\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+    "  </feature>\n"
+    "</target>\n";
+
+/*
+ Sesión con un cliente
+ entrada: Bytes recibidos y aún no consumidos (entre ini y fin)
+ sin_ack: El cliente pidió QStartNoAckMode
+ swbreak: El cliente entiende "swbreak" en las respuestas de parada
+ */
+typedef struct {
+    int fd;
+    int sin_ack;
+    int swbreak;
+    unsigned char entrada[GDB_MAX_PAQUETE];
+    size_t ini, fin;
+    CPU *cpu;
+    Herramientas *h;
+} Sesion;
+
+
+// CONEXIÓN Y PAQUETES
+// ===================
+
+/*
+ escuchar - Abre el socket de escucha
+ direccion Puerto TCP (solo en 127.0.0.1) o ruta de un socket Unix (si lleva '/')
+ */
+static int escuchar(const char *direccion)
+{
+    int fd;
+    if (strchr(direccion, '/')) {
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        if (strlen(direccion) >= sizeof(un.sun_path)) {
+            printf("Error: ruta de socket demasiado larga: %s\n", direccion);
+            return -1;
+        }
+        strcpy(un.sun_path, direccion);
+        unlink(direccion);
+        if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+            bind(fd, (struct sockaddr *)&un, sizeof(un)) < 0) {
+            perror("socket unix");
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    } else {
+        char *fin;
+        long puerto = strtol(direccion, &fin, 10);
+        if (*fin != '\0' || puerto <= 0 || puerto > 65535) {
+            printf("Error: puerto no válido: %s\n", direccion);
+            return -1;
+        }
+        struct sockaddr_in in;
+        memset(&in, 0, sizeof(in));
+        in.sin_family = AF_INET;
+        in.sin_port = htons((uint16_t)puerto);
+        in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int si = 1;
+        if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &si, sizeof(si)) < 0 ||
+            bind(fd, (struct sockaddr *)&in, sizeof(in)) < 0) {
+            perror("socket tcp");
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, 1) < 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Siguiente byte del cliente (espera si no hay); -1 si cerró la conexión
+static int leer_byte(Sesion *s)
+{
+    if (s->ini == s->fin) {
+        ssize_t n = recv(s->fd, s->entrada, sizeof(s->entrada), 0);
+        if (n <= 0) return -1;
+        s->ini = 0;
+        s->fin = (size_t)n;
+    }
+    return s->entrada[s->ini++];
+}
+
+/*
+ interrumpido - Mientras la CPU ejecuta: ¿ha llegado un Ctrl-C (0x03)?
+ No espera; descarta lo que el cliente haya mandado antes del Ctrl-C.
+ */
+static int interrumpido(Sesion *s)
+{
+    if (s->ini == s->fin) {
+        struct pollfd pfd = {s->fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) <= 0) return 0;
+        ssize_t n = recv(s->fd, s->entrada, sizeof(s->entrada), MSG_DONTWAIT);
+        if (n <= 0) return 1;     // Conexión cerrada: parar y que lo vea el bucle principal
+        s->ini = 0;
+        s->fin = (size_t)n;
+    }
+    while (s->ini < s->fin) {
+        if (s->entrada[s->ini++] == 0x03) return 1;
+    }
+    return 0;
+}
+
+static int valor_hex(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*
+ recibir_paquete - Espera el siguiente paquete "$datos#cs" y lo confirma
+ Ignora lo que llegue fuera de un paquete (acks, Ctrl-C con la CPU parada).
+ Devuelve la longitud de los datos (terminados en '\0') o -1 si se cerró la conexión.
+ */
+static int recibir_paquete(Sesion *s, char *datos)
+{
+    for (;;) {
+        int c;
+        while ((c = leer_byte(s)) != '$') {
+            if (c < 0) return -1;
+        }
+
+        int n = 0;
+        uint8_t suma = 0;
+        while ((c = leer_byte(s)) != '#') {
+            if (c < 0) return -1;
+            if (n < GDB_MAX_PAQUETE - 1) datos[n] = (char)c;
+            n++;
+            suma += (uint8_t)c;
+        }
+        int hi = leer_byte(s), lo = leer_byte(s);
+        if (hi < 0 || lo < 0) return -1;
+
+        int valido = n < GDB_MAX_PAQUETE && valor_hex(hi) >= 0 && valor_hex(lo) >= 0 &&
+                     (valor_hex(hi) << 4 | valor_hex(lo)) == suma;
+        if (!s->sin_ack) send(s->fd, valido ? "+" : "-", 1, MSG_NOSIGNAL);
+        if (valido) {
+            datos[n] = '\0';
+            return n;
+        }
+    }
+}
+
+/*
+ enviar_paquete - Envía "$datos#cs"; sin QStartNoAckMode espera el '+'
+ y reenvía si llega '-'. Devuelve -1 si se cerró la conexión.
+ */
+static int enviar_paquete(Sesion *s, const char *datos)
+{
+    static char paquete[GDB_MAX_PAQUETE + 4];
+    size_t n = strlen(datos);
+    uint8_t suma = 0;
+
+    paquete[0] = '$';
+    for (size_t i = 0; i < n; i++) suma += (uint8_t)datos[i];
+    memcpy(paquete + 1, datos, n);
+    snprintf(paquete + 1 + n, 4, "#%02x", suma);
+
+    for (;;) {
+        if (send(s->fd, paquete, n + 4, MSG_NOSIGNAL) != (ssize_t)(n + 4)) return -1;
+        if (s->sin_ack) return 0;
+        int c;
+        do {
+            c = leer_byte(s);
+        } while (c >= 0 && c != '+' && c != '-');
+        if (c != '-') return c < 0 ? -1 : 0;
+    }
+}
+
+
+// REGISTROS Y MEMORIA
+// ===================
+
+// Lee un número hexadecimal y avanza *p hasta el primer carácter que no lo sea
+static uint64_t leer_hex(const char **p)
+{
+    uint64_t v = 0;
+    int d;
+    while ((d = valor_hex(**p)) >= 0) {
+        v = v << 4 | (uint64_t)d;
+        (*p)++;
+    }
+    return v;
+}
+
+static uint16_t leer_registro(const CPU *cpu, int n)
+{
+    switch (n) {
+    case REG_ACC: return cpu->acc;
+    case REG_X: return cpu->x;
+    case REG_PC: return (uint16_t)(cpu->pc * 2);     // En bytes
+    case REG_SP: return (uint16_t)(cpu->sp * 2);
+    default: return status_flags(&cpu->status);
+    }
+}
+
+static void escribir_registro(CPU *cpu, int n, uint16_t v)
+{
+    switch (n) {
+    case REG_ACC: cpu->acc = v; break;
+    case REG_X: cpu->x = v; break;
+    case REG_PC: cpu->pc = (uint16_t)(v / 2) & (MEM_SIZE - 1); break;
+    case REG_SP: cpu->sp = (uint16_t)(v / 2) & (MEM_SIZE - 1); break;
+    default: set_status_flags(&cpu->status, (uint8_t)v); break;
+    }
+}
+
+// Registros de 16 bits en little-endian, como los espera el cliente
+static char *escribir_hex16(char *p, uint16_t v)
+{
+    return p + sprintf(p, "%02x%02x", v & 0xff, v >> 8);
+}
+
+static uint16_t leer_hex16(const char *p)
+{
+    return (uint16_t)(valor_hex(p[0]) << 4 | valor_hex(p[1]) |
+                      (valor_hex(p[2]) << 4 | valor_hex(p[3])) << 8);
+}
+
+// Cada palabra de memoria ocupa dos bytes: el menos significativo en la dirección par
+static uint8_t leer_byte_mem(const CPU *cpu, uint32_t dir)
+{
+    uint16_t palabra = cpu->mem[dir / 2];
+    return (dir & 1) ? palabra >> 8 : palabra & 0xff;
+}
+
+static void escribir_byte_mem(CPU *cpu, uint32_t dir, uint8_t v)
+{
+    uint16_t *palabra = &cpu->mem[dir / 2];
+    *palabra = (dir & 1) ? (uint16_t)((*palabra & 0x00ff) | v << 8)
+                         : (uint16_t)((*palabra & 0xff00) | v);
+    if (dir / 2 > cpu->mem_hwm) cpu->mem_hwm = (uint16_t)(dir / 2);
+}
+
+// "addr,len" dentro de la memoria (2 * MEM_SIZE bytes)
+static int leer_rango(const char **p, uint32_t *dir, uint32_t *len)
+{
+    *dir = (uint32_t)leer_hex(p);
+    if (**p != ',') return -1;
+    (*p)++;
+    *len = (uint32_t)leer_hex(p);
+    return *dir <= 2 * MEM_SIZE && *len <= 2 * MEM_SIZE - *dir ? 0 : -1;
+}
+
+
+// PUNTOS DE PARADA
+// ================
+
+/*
+ Z/z tipo,addr,kind: 0/1 breakpoint, 2 watchpoint de escritura, 3 de
+ lectura, 4 de acceso. Los watchpoints cubren todas las palabras del rango.
+ Devuelve la respuesta.
+ */
+static const char *punto_parada(Sesion *s, const char *p, int poner)
+{
+    int tipo = *p++ - '0';
+    uint32_t dir, len;
+    if (tipo < 0 || tipo > 4 || *p++ != ',' || leer_rango(&p, &dir, &len) < 0) return "E01";
+
+    TipoPunto tipos[2];
+    int n = 0;
+    if (tipo <= 1) {
+        tipos[n++] = PUNTO_BREAKPOINT;
+        len = 1;
+    }
+    if (tipo == 2 || tipo == 4) tipos[n++] = PUNTO_ESCRITURA;
+    if (tipo == 3 || tipo == 4) tipos[n++] = PUNTO_LECTURA;
+
+    for (uint32_t w = dir / 2; w <= (dir + (len ? len : 1) - 1) / 2 && w < MEM_SIZE; w++) {
+        for (int t = 0; t < n; t++) {
+            if (poner) puntos_poner(s->h->puntos, tipos[t], (uint16_t)w, NULL);
+            else puntos_quitar(s->h->puntos, tipos[t], (uint16_t)w);
+        }
+    }
+    return "OK";
+}
+
+
+// EJECUCIÓN
+// =========
+
+/*
+ respuesta_parada - Paquete T con la señal, el motivo y el PC (para que el
+ cliente no tenga que pedir los registros en cada parada)
+ */
+static void respuesta_parada(Sesion *s, char *resp, int senal, MotivoParada motivo,
+                             const AccesoVigilado *a)
+{
+    const PuntosParada *p = s->h->puntos;
+    char *q = resp + sprintf(resp, "T%02x", senal);
+
+    if (motivo == PARADA_BREAKPOINT && s->swbreak) {
+        q += sprintf(q, "swbreak:;");
+    } else if (motivo == PARADA_WATCHPOINT) {
+        const char *clase = punto_bit(p, PUNTO_LECTURA, a->dir) && punto_bit(p, PUNTO_ESCRITURA, a->dir)
+                            ? "awatch"
+                            : a->tipo == PUNTO_ESCRITURA ? "watch" : "rwatch";
+        q += sprintf(q, "%s:%x;", clase, a->dir * 2);
+    }
+    q += sprintf(q, "%02x:", REG_PC);
+    q = escribir_hex16(q, leer_registro(s->cpu, REG_PC));
+    *q++ = ';';
+    *q = '\0';
+}
+
+/*
+ ejecutar - "c" o "s": ejecuta y prepara la respuesta de parada
+ Continuar avanza en tramos de GDB_TRAMO instrucciones a la velocidad del
+ motor batch y entre tramo y tramo mira si llegó un Ctrl-C.
+
+ Devuelve -1 si la sesión debe terminar (CPU detenida o reproducción divergente).
+ */
+static int ejecutar(Sesion *s, int paso, char *resp)
+{
+    CPU *cpu = s->cpu;
+    AccesoVigilado acceso;
+    MotivoParada motivo;
+    int senal = 5;        // SIGTRAP
+
+    if (cpu->status.h) {
+        strcpy(resp, "W00");
+        return -1;
+    }
+
+    if (paso) {
+        motivo = cpu_continuar(cpu, s->h, cpu->icount + 1, cpu->icount, &acceso);
+    } else {
+        // Tras una parada el cliente quita sus breakpoints antes de dar el paso: no hace falta saltar ninguno
+        do {
+            motivo = cpu_continuar(cpu, s->h, cpu->icount + GDB_TRAMO, UINT64_MAX, &acceso);
+        } while (motivo == PARADA_LIMITE && !interrumpido(s));
+        if (motivo == PARADA_LIMITE) senal = 2;     // SIGINT
+    }
+
+    if (motivo == PARADA_DIVERGENCIA) {
+        strcpy(resp, "W01");
+        return -1;
+    }
+    // Si ha ejecutado HALT el programa ha terminado, como en la comprobación de arriba
+    if (cpu->status.h) {
+        strcpy(resp, "W00");
+        return -1;
+    }
+    respuesta_parada(s, resp, senal, motivo, &acceso);
+    return 0;
+}
+
+
+// SERVIDOR
+// ========
+
+/*
+ qXfer:features:read:target.xml:offset,length - Trozo del target.xml
+ ('m' si queda más, 'l' si es el último)
+ */
+static void leer_target_xml(const char *p, char *resp)
+{
+    uint64_t offset, len;
+    if (strncmp(p, "target.xml:", 11) != 0) {
+        strcpy(resp, "E00");
+        return;
+    }
+    p += 11;
+    offset = leer_hex(&p);
+    if (*p++ != ',') {
+        strcpy(resp, "E01");
+        return;
+    }
+    len = leer_hex(&p);
+    if (len > GDB_MAX_PAQUETE - 2) len = GDB_MAX_PAQUETE - 2;
+
+    size_t total = sizeof(target_xml) - 1;
+    if (offset >= total) {
+        strcpy(resp, "l");
+        return;
+    }
+    size_t n = total - offset < len ? total - offset : len;
+    resp[0] = offset + n < total ? 'm' : 'l';
+    memcpy(resp + 1, target_xml + offset, n);
+    resp[n + 1] = '\0';
+}
+
+static void consulta(Sesion *s, const char *p, char *resp)
+{
+    if (strncmp(p, "qSupported", 10) == 0) {
+        s->swbreak = strstr(p, "swbreak+") != NULL;
+        sprintf(resp, "PacketSize=%x;qXfer:features:read+;swbreak+;hwbreak+;QStartNoAckMode+",
+                GDB_MAX_PAQUETE - 1);
+    } else if (strncmp(p, "qXfer:features:read:", 20) == 0) {
+        leer_target_xml(p + 20, resp);
+    } else if (strcmp(p, "QStartNoAckMode") == 0) {
+        strcpy(resp, "OK");
+    } else if (strcmp(p, "qAttached") == 0) {
+        strcpy(resp, "1");
+    } else if (strcmp(p, "qfThreadInfo") == 0) {
+        strcpy(resp, "m1");
+    } else if (strcmp(p, "qsThreadInfo") == 0) {
+        strcpy(resp, "l");
+    } else if (strcmp(p, "qC") == 0) {
+        strcpy(resp, "QC1");
+    }
+}
+
+/*
+ atender - Prepara en resp la respuesta a un paquete
+ Devuelve -1 si la sesión termina después de enviarla (sin respuesta si
+ resp queda NULL), 1 si el cliente se desconectó dejando la CPU
+ ejecutando (D) y 0 en otro caso.
+ */
+static int atender(Sesion *s, char *p, char *resp)
+{
+    CPU *cpu = s->cpu;
+    uint32_t dir, len;
+    char *q = resp;
+    const char *r = p + 1;
+
+    resp[0] = '\0';
+    switch (p[0]) {
+    case '?':
+        respuesta_parada(s, resp, 5, PARADA_LIMITE, NULL);
+        break;
+    case 'g':
+        for (int n = 0; n < NUM_REGISTROS; n++) q = escribir_hex16(q, leer_registro(cpu, n));
+        break;
+    case 'G':
+        if (strlen(r) < 4 * NUM_REGISTROS) {
+            strcpy(resp, "E01");
+            break;
+        }
+        for (int n = 0; n < NUM_REGISTROS; n++) escribir_registro(cpu, n, leer_hex16(r + 4 * n));
+        strcpy(resp, "OK");
+        break;
+    case 'p': {
+        uint64_t n = leer_hex(&r);
+        if (n >= NUM_REGISTROS) strcpy(resp, "E01");
+        else escribir_hex16(resp, leer_registro(cpu, (int)n));
+        break;
+    }
+    case 'P': {
+        uint64_t n = leer_hex(&r);
+        if (n >= NUM_REGISTROS || *r != '=' || strlen(r + 1) < 4) {
+            strcpy(resp, "E01");
+            break;
+        }
+        escribir_registro(cpu, (int)n, leer_hex16(r + 1));
+        strcpy(resp, "OK");
+        break;
+    }
+    case 'm':
+        if (leer_rango(&r, &dir, &len) < 0) {
+            strcpy(resp, "E01");
+            break;
+        }
+        if (len > (GDB_MAX_PAQUETE - 1) / 2) len = (GDB_MAX_PAQUETE - 1) / 2;
+        for (uint32_t i = 0; i < len; i++) q += sprintf(q, "%02x", leer_byte_mem(cpu, dir + i));
+        break;
+    case 'M':
+        if (leer_rango(&r, &dir, &len) < 0 || *r++ != ':' || strlen(r) < 2 * len) {
+            strcpy(resp, "E01");
+            break;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            escribir_byte_mem(cpu, dir + i, (uint8_t)(valor_hex(r[2 * i]) << 4 | valor_hex(r[2 * i + 1])));
+        }
+        strcpy(resp, "OK");
+        break;
+    case 'c':
+    case 's':
+        // Dirección opcional desde la que seguir
+        if (valor_hex(*r) >= 0) cpu->pc = (uint16_t)(leer_hex(&r) / 2) & (MEM_SIZE - 1);
+        return ejecutar(s, p[0] == 's', resp);
+    case 'Z':
+    case 'z':
+        strcpy(resp, punto_parada(s, r, p[0] == 'Z'));
+        break;
+    case 'H':
+        strcpy(resp, "OK");
+        break;
+    case 'D':
+        strcpy(resp, "OK");
+        return 1;
+    case 'k':
+        return -1;
+    case 'v':
+        if (strncmp(p, "vKill", 5) == 0) {
+            strcpy(resp, "OK");
+            return -1;
+        }
+        break;    // vCont y demás: vacío, el cliente usa c/s
+    case 'q':
+    case 'Q':
+        consulta(s, p, resp);
+        break;
+    }
+    return 0;
+}
+
+/*
+ gdb_servir - Espera a un cliente GDB en direccion y le deja controlar la CPU
+ direccion Puerto TCP en 127.0.0.1 o ruta de un socket Unix
+ h Herramientas: la traza y la grabación siguen funcionando; los puntos de
+   parada del cliente se añaden a h->puntos (se crean si no hay)
+
+ Al terminar la sesión con D (detach) la CPU sigue ejecutando hasta HALT;
+ con k (kill) o si se cierra la conexión se queda donde está.
+ Devuelve el número de instrucciones ejecutadas.
+ */
+uint64_t gdb_servir(CPU *cpu, Herramientas *h, const char *direccion)
+{
+    static Sesion s;
+    static char paquete[GDB_MAX_PAQUETE], resp[GDB_MAX_PAQUETE];
+    uint64_t inicio = cpu->icount;
+
+    int fd = escuchar(direccion);
+    if (fd < 0) return 0;
+    printf("Esperando a GDB en %s%s...\n", strchr(direccion, '/') ? "" : "127.0.0.1:", direccion);
+    fflush(stdout);
+
+    memset(&s, 0, sizeof(s));
+    s.fd = accept(fd, NULL, NULL);
+    close(fd);
+    if (strchr(direccion, '/')) unlink(direccion);
+    if (s.fd < 0) {
+        perror("accept");
+        return 0;
+    }
+    int si = 1;
+    setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &si, sizeof(si));   // Falla sin daño en Unix
+    printf("Cliente GDB conectado\n");
+    fflush(stdout);
+
+    s.cpu = cpu;
+    s.h = h;
+    PuntosParada *propios = h->puntos ? NULL : puntos_crear();
+    if (propios) h->puntos = propios;
+
+    int fin = 0;
+    while (!fin && recibir_paquete(&s, paquete) >= 0) {
+        fin = atender(&s, paquete, resp);
+        if (fin >= 0 || resp[0]) {
+            if (enviar_paquete(&s, resp) < 0) break;
+        }
+        // Tras aceptar QStartNoAckMode ya no hay acks en ninguna dirección
+        if (strcmp(paquete, "QStartNoAckMode") == 0) s.sin_ack = 1;
+    }
+    close(s.fd);
+    printf("Cliente GDB desconectado\n");
+
+    if (fin == 1) {
+        AccesoVigilado acceso;
+        cpu_continuar(cpu, h, UINT64_MAX, cpu->icount, &acceso);
+    }
+    if (propios) {
+        puntos_destruir(propios);
+        h->puntos = NULL;
+    }
+
+    if (cpu->status.h) printf("CPU Halted!\n");
+    printCPUState(cpu);
+    return cpu->icount - inicio;
+}
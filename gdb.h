@@ -0,0 +1,29 @@
+#ifndef GDB_H
+#define GDB_H
+
+/*
+ Servidor GDB (Remote Serial Protocol) integrado en el emulador
+
+ Con la opción -g el emulador no usa un motor: espera a que un cliente RSP
+ (gdb, lldb, un script) se conecte y le obedece. Los registros ACC, X, PC y
+ Status se describen en un target.xml (qXfer:features:read); la memoria se
+ ve como 2*MEM_SIZE bytes, cada palabra en little-endian, y PC se expone en
+ bytes (2 * pc) para que coincida con las direcciones de memoria y de los
+ breakpoints.
+
+ Los breakpoints (Z0) y watchpoints (Z2/Z3/Z4) se guardan en los puntos de
+ parada del emulador, así que entre parada y parada la CPU ejecuta en los
+ mismos tramos que el motor batch; solo cada GDB_TRAMO instrucciones se
+ mira si el cliente pidió interrumpir (Ctrl-C).
+ */
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define GDB_TRAMO (1u << 20)      // Instrucciones entre comprobaciones de Ctrl-C
+#define GDB_MAX_PAQUETE 4096      // Tamaño máximo de paquete (PacketSize)
+
+uint64_t gdb_servir(CPU *cpu, Herramientas *h, const char *direccion);
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grabacion.h"
+
+
+static void divergencia(Grabacion *g, const CPU *cpu, const char *motivo)
+{
+    if (!g->divergente) {
+        printf("DIVERGENCIA en la instrucción %llu: %s\n", (unsigned long long)cpu->icount, motivo);
+    }
+    g->divergente = 1;
+}
+
+// Reproducción: avanza al siguiente evento (GRAB_FIN si el archivo se acaba)
+static void leer_evento(Grabacion *g)
+{
+    if (fread(&g->pendiente, sizeof(EventoGrabacion), 1, g->f) != 1) {
+        memset(&g->pendiente, 0, sizeof(EventoGrabacion));
+        g->pendiente.tipo = GRAB_FIN;
+        g->pendiente.instruccion = UINT64_MAX;
+    }
+}
+
+static void escribir_evento(Grabacion *g, uint64_t instruccion, TipoEvento tipo, uint32_t dato,
+                            uint64_t valor)
+{
+    EventoGrabacion e;
+    e.instruccion = instruccion;
+    e.valor = valor;
+    e.tipo = tipo;
+    e.dato = dato;
+    fwrite(&e, sizeof(e), 1, g->f);
+}
+
+/*
+ Reproducción: consume el siguiente evento, que debe ser de tipo `tipo`
+ y haber ocurrido en la instrucción actual
+ */
+static int esperar_evento(Grabacion *g, const CPU *cpu, TipoEvento tipo, uint32_t dato)
+{
+    char motivo[128];
+    EventoGrabacion *e = &g->pendiente;
+
+    if (e->instruccion != cpu->icount || e->tipo != tipo || e->dato != dato) {
+        snprintf(motivo, sizeof(motivo),
+                 "se esperaba el evento %u(%u) de la instrucción %llu y llegó %u(%u)",
+                 e->tipo, e->dato, (unsigned long long)e->instruccion, tipo, dato);
+        divergencia(g, cpu, motivo);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ Reproducción: pide las líneas que cpu_interrumpir recibió antes de la
+ instrucción actual. Una que se quedó atrás es una divergencia: la
+ ejecución ya no para donde se grabó
+ */
+static int reproducir_interrupciones(Grabacion *g, CPU *cpu)
+{
+    while (g->pendiente.tipo == GRAB_INTERRUPCION && g->pendiente.instruccion <= cpu->icount) {
+        if (g->pendiente.instruccion < cpu->icount) {
+            divergencia(g, cpu, "una interrupción grabada no llegó a su instrucción");
+            return -1;
+        }
+        cpu->irq |= 1u << (g->pendiente.dato % INT_LINEAS);
+        leer_evento(g);
+    }
+    return g->divergente ? -1 : 0;
+}
+
+/*
+ grabacion_crear - Empieza a grabar una ejecución
+ ruta Archivo de salida (se trunca)
+ cpu CPU recién cargada: su estado es la imagen inicial. Queda conectada
+     a la grabación hasta grabacion_cerrar (ver cpu_interrumpir)
+ intervalo_hash Instrucciones entre hashes de estado
+
+ Devuelve NULL si no se pudo crear el archivo.
+ */
+Grabacion *grabacion_crear(const char *ruta, CPU *cpu, uint32_t intervalo_hash)
+{
+    Grabacion *g = calloc(1, sizeof(Grabacion));
+    if (!g) return NULL;
+    g->f = fopen(ruta, "wb");
+    if (!g->f) {
+        printf("Error: No se pudo crear la grabación %s\n", ruta);
+        free(g);
+        return NULL;
+    }
+    g->intervalo_hash = intervalo_hash;
+    g->siguiente_hash = cpu->icount + intervalo_hash;
+
+    CabeceraGrabacion cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, GRABACION_MAGIA, sizeof(cab.magia));
+    cab.version = GRABACION_VERSION;
+    cab.intervalo_hash = intervalo_hash;
+
+    ImagenGrabacion img;
+    memset(&img, 0, sizeof(img));
+    memcpy(img.mem, cpu->mem, sizeof(img.mem));
+    img.acc = cpu->acc;
+    img.x = cpu->x;
+    img.pc = cpu->pc;
+    img.sp = cpu->sp;
+    img.irq = cpu->irq;
+    img.mem_hwm = cpu->mem_hwm;
+    img.icount = cpu->icount;
+    img.flags = status_flags(&cpu->status);
+    img.periodo_temporizador = cpu->temporizador.periodo;
+    img.linea_temporizador = cpu->temporizador.linea;
+    for (int i = 0; i < 3; i++) img.latencia[i] = cpu->ciclos_latencia[16 + i];
+
+    fwrite(&cab, sizeof(cab), 1, g->f);
+    fwrite(&img, sizeof(img), 1, g->f);
+    cpu->grabacion = g;
+    return g;
+}
+
+/*
+ grabacion_abrir - Prepara la reproducción de una grabación
+ ruta Archivo creado con grabacion_crear
+ cpu Se carga con la imagen inicial grabada (también el temporizador y las
+     latencias) y queda conectada a la grabación
+
+ Devuelve NULL (tras avisar) si el archivo no existe o no es una grabación.
+ */
+Grabacion *grabacion_abrir(const char *ruta, CPU *cpu)
+{
+    Grabacion *g = calloc(1, sizeof(Grabacion));
+    if (!g) return NULL;
+    g->f = fopen(ruta, "rb");
+    if (!g->f) {
+        printf("Error: No se pudo abrir la grabación %s\n", ruta);
+        free(g);
+        return NULL;
+    }
+
+    CabeceraGrabacion cab;
+    ImagenGrabacion img;
+    if (fread(&cab, sizeof(cab), 1, g->f) != 1 || fread(&img, sizeof(img), 1, g->f) != 1 ||
+        memcmp(cab.magia, GRABACION_MAGIA, sizeof(cab.magia)) != 0 ||
+        cab.version != GRABACION_VERSION || cab.intervalo_hash == 0) {
+        printf("Error: %s no es una grabación válida\n", ruta);
+        fclose(g->f);
+        free(g);
+        return NULL;
+    }
+
+    resetCPU(cpu);
+    for (int i = 0; i < 3; i++) cpu->ciclos_latencia[16 + i] = img.latencia[i];
+    if (img.periodo_temporizador) {
+        cpu_temporizador(cpu, img.periodo_temporizador, img.linea_temporizador);
+    }
+    memcpy(cpu->mem, img.mem, sizeof(img.mem));
+    cpu->acc = img.acc;
+    cpu->x = img.x;
+    cpu->pc = img.pc;
+    cpu->sp = img.sp & (MEM_SIZE - 1);
+    cpu->irq = img.irq;
+    cpu->mem_hwm = img.mem_hwm;
+    cpu->icount = img.icount;
+    set_status_flags(&cpu->status, img.flags);
+
+    g->reproduciendo = 1;
+    g->intervalo_hash = cab.intervalo_hash;
+    g->siguiente_hash = img.icount + cab.intervalo_hash;
+    cpu->grabacion = g;
+    leer_evento(g);
+    // Las que llegaron antes de la primera instrucción
+    reproducir_interrupciones(g, cpu);
+    return g;
+}
+
+/*
+ grabacion_punto - Punto de control: graba o comprueba el hash del estado
+ y, al reproducir, pide las interrupciones grabadas para esta instrucción.
+ No hace nada si cpu->icount no ha llegado a grabacion_limite().
+
+ Devuelve -1 si la reproducción divergió (el motor debe parar).
+ */
+int grabacion_punto(Grabacion *g, CPU *cpu)
+{
+    // El hash va antes: se grabó al acabar el tramo, antes de que quien
+    // controla la CPU pudiera llamar a cpu_interrumpir
+    if (cpu->icount == g->siguiente_hash) {
+        g->siguiente_hash += g->intervalo_hash;
+        g->hashes++;
+
+        uint64_t hash = cpu_hash(cpu);
+        if (!g->reproduciendo) {
+            escribir_evento(g, cpu->icount, GRAB_HASH, 0, hash);
+            return 0;
+        }
+
+        if (esperar_evento(g, cpu, GRAB_HASH, 0) < 0) return -1;
+        if (g->pendiente.valor != hash) {
+            char motivo[96];
+            snprintf(motivo, sizeof(motivo), "hash %016llx, se esperaba %016llx",
+                     (unsigned long long)hash, (unsigned long long)g->pendiente.valor);
+            divergencia(g, cpu, motivo);
+            return -1;
+        }
+        leer_evento(g);
+    }
+    if (g->reproduciendo) return reproducir_interrupciones(g, cpu);
+    return g->divergente ? -1 : 0;
+}
+
+/*
+ grabacion_entrada - Pasa por la grabación un valor que viene de fuera de la CPU
+ tipo GRAB_ENTRADA (lectura de dispositivo) o GRAB_INTERRUPCION
+ dato Origen del valor (dispositivo, dirección, línea de interrupción)
+ valor Lo que dio el dispositivo real
+
+ Al grabar lo guarda y lo devuelve; al reproducir devuelve el valor grabado
+ e ignora el real.
+ */
+uint64_t grabacion_entrada(Grabacion *g, const CPU *cpu, TipoEvento tipo, uint32_t dato,
+                           uint64_t valor)
+{
+    if (!g->reproduciendo) {
+        escribir_evento(g, cpu->icount, tipo, dato, valor);
+        return valor;
+    }
+    if (esperar_evento(g, cpu, tipo, dato) < 0) return valor;
+    valor = g->pendiente.valor;
+    leer_evento(g);
+    return valor;
+}
+
+/*
+ grabacion_cerrar - Termina la grabación o la reproducción
+ Al grabar escribe el evento de fin con el hash final; al reproducir
+ comprueba que la ejecución acabó en la misma instrucción y estado. Desconecta
+ la CPU de la grabación.
+
+ Devuelve 0 si todo fue bien y -1 si la reproducción divergió.
+ */
+int grabacion_cerrar(Grabacion *g, CPU *cpu)
+{
+    uint64_t hash = cpu_hash(cpu);
+    int resultado = 0;
+
+    cpu->grabacion = NULL;
+
+    if (!g->reproduciendo) {
+        escribir_evento(g, cpu->icount, GRAB_FIN, 0, hash);
+        if (ferror(g->f) || fclose(g->f) != 0) {
+            printf("Error: Grabación incompleta\n");
+            resultado = -1;
+        }
+        free(g);
+        return resultado;
+    }
+
+    if (!g->divergente && esperar_evento(g, cpu, GRAB_FIN, 0) == 0 && g->pendiente.valor != hash) {
+        divergencia(g, cpu, "el estado final no coincide");
+    }
+    resultado = g->divergente ? -1 : 0;
+    fclose(g->f);
+    free(g);
+    return resultado;
+}
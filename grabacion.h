@@ -0,0 +1,103 @@
+#ifndef GRABACION_H
+#define GRABACION_H
+
+/*
+ Grabación y reproducción deterministas
+
+ La CPU es determinista: dado el mismo estado inicial ejecuta siempre lo
+ mismo. Lo que no lo es viene de fuera (interrupciones de los dispositivos,
+ lecturas de dispositivos de E/S), así que para reproducir una ejecución
+ basta con guardar:
+ - La imagen inicial de la CPU, tal como la deja el cargador, con la
+   configuración de la máquina que cambia lo que ejecuta: el temporizador
+   y las latencias del modelo de ciclos
+ - Cada entrada externa, con la instrucción (icount) en la que llegó
+
+ Al reproducir, la imagen se carga desde la grabación y cada entrada se toma
+ del archivo en lugar del dispositivo. Cada intervalo_hash instrucciones se
+ guarda (o se comprueba) un hash del estado de la CPU, de modo que una
+ divergencia se detecta a lo sumo intervalo_hash instrucciones después.
+
+ Formato del archivo: CabeceraGrabacion, ImagenGrabacion y una secuencia de
+ EventoGrabacion ordenados por instrucción que termina en GRAB_FIN. Orden de
+ bytes del host.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define GRABACION_MAGIA "EMUREC1"
+#define GRABACION_VERSION 1
+#define GRABACION_INTERVALO_HASH 100000   // Instrucciones entre hashes de estado
+
+typedef enum {
+    GRAB_HASH = 1,            // valor = cpu_hash() en esa instrucción
+    GRAB_ENTRADA,             // Lectura de un dispositivo: dato = origen, valor = lo leído
+    GRAB_INTERRUPCION,        // cpu_interrumpir() antes de la instrucción: dato = línea
+    GRAB_FIN                  // Fin de la ejecución: valor = cpu_hash() final
+} TipoEvento;
+
+typedef struct {
+    char magia[8];            // GRABACION_MAGIA
+    uint32_t version;         // GRABACION_VERSION
+    uint32_t intervalo_hash;
+} CabeceraGrabacion;
+
+// Estado inicial de la CPU y configuración de la máquina (-T y -c)
+typedef struct {
+    uint16_t mem[MEM_SIZE];
+    uint16_t acc;
+    uint16_t x;
+    uint16_t pc;
+    uint16_t mem_hwm;
+    uint64_t icount;
+    uint8_t flags;            // status_flags()
+    uint8_t linea_temporizador;
+    uint16_t sp;
+    uint8_t irq;              // Líneas de interrupción pendientes
+    uint8_t latencia[3];      // ciclos_latencia de MUL, DIV y MOD
+    uint32_t periodo_temporizador;    // 0: sin temporizador
+    uint32_t reservado;
+} ImagenGrabacion;
+
+typedef struct {
+    uint64_t instruccion;     // icount en el que ocurrió
+    uint64_t valor;
+    uint32_t tipo;            // TipoEvento
+    uint32_t dato;
+} EventoGrabacion;
+
+struct Grabacion {
+    FILE *f;
+    int reproduciendo;
+    uint32_t intervalo_hash;
+    uint64_t siguiente_hash;      // icount del próximo punto de control
+    EventoGrabacion pendiente;    // Reproducción: próximo evento del archivo
+    uint64_t hashes;              // Puntos de control escritos o verificados
+    int divergente;               // Reproducción: ya se encontró una divergencia
+};
+
+Grabacion *grabacion_crear(const char *ruta, CPU *cpu, uint32_t intervalo_hash);
+Grabacion *grabacion_abrir(const char *ruta, CPU *cpu);
+int grabacion_punto(Grabacion *g, CPU *cpu);
+uint64_t grabacion_entrada(Grabacion *g, const CPU *cpu, TipoEvento tipo, uint32_t dato,
+                           uint64_t valor);
+int grabacion_cerrar(Grabacion *g, CPU *cpu);
+
+/*
+ grabacion_limite - icount en el que el motor debe llamar a grabacion_punto
+ Hasta entonces puede ejecutar sin mirar la grabación. Al reproducir es
+ también la instrucción de la siguiente interrupción grabada.
+ */
+static inline uint64_t grabacion_limite(const Grabacion *g)
+{
+    if (g->reproduciendo && g->pendiente.tipo == GRAB_INTERRUPCION &&
+        g->pendiente.instruccion < g->siguiente_hash) {
+        return g->pendiente.instruccion;
+    }
+    return g->siguiente_hash;
+}
+
+#endif
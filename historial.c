@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "historial.h"
+
+
+/*
+ historial_crear - Empieza un historial con el estado actual como primera instantánea
+ intervalo Instrucciones entre instantáneas (mayor que 0)
+
+ Devuelve NULL si no hay memoria.
+ */
+Historial *historial_crear(const CPU *cpu, uint64_t intervalo)
+{
+    Historial *h = calloc(1, sizeof(Historial));
+    if (!h) return NULL;
+    h->instantaneas = malloc(HISTORIAL_MAX_INSTANTANEAS * sizeof(CPU));
+    if (!h->instantaneas) {
+        free(h);
+        return NULL;
+    }
+    h->intervalo = intervalo;
+    h->siguiente = cpu->icount;
+    historial_guardar(h, cpu);
+    return h;
+}
+
+void historial_destruir(Historial *h)
+{
+    if (!h) return;
+    free(h->instantaneas);
+    free(h);
+}
+
+/*
+ historial_guardar - Añade la instantánea de cpu->icount == h->siguiente
+ Con el historial lleno conserva una de cada dos y dobla el intervalo.
+ */
+void historial_guardar(Historial *h, const CPU *cpu)
+{
+    if (h->num == HISTORIAL_MAX_INSTANTANEAS) {
+        for (size_t i = 0; i < h->num / 2; i++) {
+            h->instantaneas[i] = h->instantaneas[2 * i];
+        }
+        h->num /= 2;
+        h->intervalo *= 2;
+    }
+    // Con un número par de instantáneas la actual sigue cayendo en el nuevo intervalo
+    h->instantaneas[h->num++] = *cpu;
+    h->siguiente = cpu->icount + h->intervalo;
+}
+
+uint64_t historial_inicio(const Historial *h)
+{
+    return h->instantaneas[0].icount;
+}
+
+/*
+ historial_anterior - icount de la última instantánea anterior a icount
+ (icount debe ser posterior al inicio del historial)
+ */
+uint64_t historial_anterior(const Historial *h, uint64_t icount)
+{
+    size_t i = (size_t)((icount - 1 - historial_inicio(h)) / h->intervalo);
+    if (i >= h->num) i = h->num - 1;
+    return h->instantaneas[i].icount;
+}
+
+/*
+ historial_ir_a - Lleva la CPU a la instrucción número icount
+ Restaura la última instantánea anterior y re-ejecuta desde ella (sin
+ salida); si icount está más allá de lo visto, ejecuta hacia delante
+ guardando instantáneas por el camino y para antes si la CPU se detiene.
+
+ Devuelve -1 si icount es anterior al inicio del historial.
+ */
+int historial_ir_a(Historial *h, CPU *cpu, uint64_t icount)
+{
+    if (icount < historial_inicio(h)) return -1;
+
+    // Restaurar si hay que retroceder o si la instantánea adelanta al estado actual
+    size_t i = (size_t)((icount - historial_inicio(h)) / h->intervalo);
+    if (i >= h->num) i = h->num - 1;
+    if (icount < cpu->icount || h->instantaneas[i].icount > cpu->icount) {
+        *cpu = h->instantaneas[i];
+    }
+    while (cpu->icount < icount && !cpu->status.h) {
+        cpu_paso(cpu);          // Con los eventos de los dispositivos, como los motores
+        historial_anotar(h, cpu);
+    }
+    return 0;
+}
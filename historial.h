@@ -0,0 +1,50 @@
+#ifndef HISTORIAL_H
+#define HISTORIAL_H
+
+/*
+ Historial de instantáneas para depurar hacia atrás
+
+ Los motores interactivos guardan en memoria una copia de la CPU cada
+ `intervalo` instrucciones. Para volver a la instrucción k se restaura la
+ última instantánea anterior a k y se re-ejecuta hacia delante lo que falte:
+ la CPU es determinista, así que se llega exactamente al mismo estado, y el
+ coste está acotado por el intervalo.
+
+ Un intervalo pequeño da saltos más rápidos y gasta más memoria (cada
+ instantánea ocupa sizeof(CPU), unos 8 KB). Si se llega a
+ HISTORIAL_MAX_INSTANTANEAS se descarta una de cada dos y el intervalo se
+ dobla, de modo que la memoria queda acotada en programas largos.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define HISTORIAL_INTERVALO 10000         // Intervalo por defecto (instrucciones)
+#define HISTORIAL_MAX_INSTANTANEAS 1024   // ~8 MB
+
+typedef struct {
+    CPU *instantaneas;        // Ordenadas por icount: base + i * intervalo
+    size_t num;
+    uint64_t intervalo;
+    uint64_t siguiente;       // icount de la próxima instantánea a guardar
+} Historial;
+
+Historial *historial_crear(const CPU *cpu, uint64_t intervalo);
+void historial_destruir(Historial *h);
+void historial_guardar(Historial *h, const CPU *cpu);
+int historial_ir_a(Historial *h, CPU *cpu, uint64_t icount);
+uint64_t historial_inicio(const Historial *h);
+uint64_t historial_anterior(const Historial *h, uint64_t icount);
+
+/*
+ historial_anotar - Llamar después de cada instrucción
+ Solo copia la CPU cuando toca una instantánea nueva.
+ */
+static inline void historial_anotar(Historial *h, const CPU *cpu)
+{
+    if (cpu->icount == h->siguiente) historial_guardar(h, cpu);
+}
+
+#endif
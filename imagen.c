@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "imagen.h"
+
+
+/*
+ imagen_escribir - Guarda mem[0..palabras-1] como imagen binaria
+ Devuelve -1 (tras avisar) si no se pudo escribir.
+ */
+int imagen_escribir(const char *ruta, const uint16_t *mem, uint32_t palabras)
+{
+    FILE *f = fopen(ruta, "wb");
+    if (!f) {
+        printf("Error: No se pudo crear la imagen %s\n", ruta);
+        return -1;
+    }
+
+    CabeceraImagen cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, IMAGEN_MAGIA, sizeof(cab.magia));
+    cab.version = IMAGEN_VERSION;
+    cab.palabras = palabras;
+
+    fwrite(&cab, sizeof(cab), 1, f);
+    fwrite(mem, sizeof(uint16_t), palabras, f);
+    if (ferror(f) | fclose(f)) {
+        printf("Error: Imagen incompleta: %s\n", ruta);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ imagen_es_binaria - ¿Empieza f con la cabecera de una imagen?
+ Deja f al principio, tanto si lo es como si no.
+ */
+int imagen_es_binaria(FILE *f)
+{
+    char magia[8];
+    int es = fread(magia, sizeof(magia), 1, f) == 1 &&
+             memcmp(magia, IMAGEN_MAGIA, sizeof(magia)) == 0;
+    rewind(f);
+    return es;
+}
+
+/*
+ imagen_leer - Carga una imagen abierta con imagen_es_binaria() en mem
+ max Palabras que caben en mem
+
+ Devuelve las palabras cargadas o -1 si la imagen no es válida o no cabe.
+ */
+long imagen_leer(FILE *f, uint16_t *mem, uint32_t max)
+{
+    CabeceraImagen cab;
+    if (fread(&cab, sizeof(cab), 1, f) != 1 || memcmp(cab.magia, IMAGEN_MAGIA, sizeof(cab.magia)) != 0 ||
+        cab.version != IMAGEN_VERSION || cab.palabras > max ||
+        fread(mem, sizeof(uint16_t), cab.palabras, f) != cab.palabras) {
+        return -1;
+    }
+    return cab.palabras;
+}
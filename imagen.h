@@ -0,0 +1,29 @@
+#ifndef IMAGEN_H
+#define IMAGEN_H
+
+/*
+ Imagen binaria de memoria
+
+ Lo que genera el ensamblador nativo (ensamblador.c) y carga el emulador
+ sin tener que interpretar texto: CabeceraImagen seguida de `palabras`
+ palabras de 16 bits que se copian en mem[0..palabras-1]. Orden de bytes
+ del host.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define IMAGEN_MAGIA "EMUIMG1"
+#define IMAGEN_VERSION 1
+
+typedef struct {
+    char magia[8];            // IMAGEN_MAGIA
+    uint32_t version;         // IMAGEN_VERSION
+    uint32_t palabras;
+} CabeceraImagen;
+
+int imagen_escribir(const char *ruta, const uint16_t *mem, uint32_t palabras);
+int imagen_es_binaria(FILE *f);
+long imagen_leer(FILE *f, uint16_t *mem, uint32_t max);
+
+#endif
@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "libemu.h"
+#include "cpu.h"
+#include "puntos.h"
+
+#if EMU_MEM_SIZE != MEM_SIZE
+#error "EMU_MEM_SIZE debe coincidir con MEM_SIZE"
+#endif
+
+// EmuPunto se corresponde uno a uno con TipoPunto
+#define TIPO_PUNTO(t) ((TipoPunto)(t))
+
+typedef struct {
+    EmuGancho fn;             // NULL: el punto solo para
+    void *usuario;
+} Gancho;
+
+/*
+ Estado de un emulador. Los puntos de parada y los ganchos (~300 KB) se
+ reservan con el primer punto: un Emu sin puntos ocupa poco más que su CPU.
+ reanudar: icount de la última parada en un punto de código; al volver a
+           ejecutar desde ahí no se para otra vez en él
+ */
+struct Emu {
+    CPU cpu;
+    Herramientas h;
+    Gancho (*ganchos)[MEM_SIZE];      // [NUM_TIPOS_PUNTO][MEM_SIZE]
+    uint64_t reanudar;
+};
+
+/*
+ emu_crear - Emulador nuevo con la CPU en reset y la memoria a cero
+ Devuelve NULL si no hay memoria.
+ */
+Emu *emu_crear(void)
+{
+    Emu *e = calloc(1, sizeof(Emu));
+    if (!e) return NULL;
+    resetCPU(&e->cpu);
+    e->reanudar = UINT64_MAX;
+    return e;
+}
+
+void emu_destruir(Emu *e)
+{
+    if (!e) return;
+    puntos_destruir(e->h.puntos);
+    free(e->ganchos);
+    free(e);
+}
+
+/*
+ emu_reiniciar - Reset de la CPU (registros, flags, memoria e icount)
+ Los puntos de parada, los ganchos y las latencias se conservan.
+ */
+void emu_reiniciar(Emu *e)
+{
+    uint8_t latencia[sizeof(e->cpu.ciclos_latencia)];
+    memcpy(latencia, e->cpu.ciclos_latencia, sizeof(latencia));
+    resetCPU(&e->cpu);
+    memcpy(e->cpu.ciclos_latencia, latencia, sizeof(latencia));
+    e->reanudar = UINT64_MAX;
+}
+
+/*
+ emu_cargar - Reinicia la CPU y copia una imagen a partir de mem[0]
+ imagen Palabras tal como las genera el ensamblador
+
+ Devuelve -1 si la imagen no cabe en memoria.
+ */
+int emu_cargar(Emu *e, const uint16_t *imagen, size_t palabras)
+{
+    if (palabras > MEM_SIZE) return -1;
+    emu_reiniciar(e);
+    memcpy(e->cpu.mem, imagen, palabras * sizeof(uint16_t));
+    if (palabras > 0) e->cpu.mem_hwm = (uint16_t)(palabras - 1);
+    return 0;
+}
+
+/*
+ emu_ejecutar - Ejecuta hasta max_instrucciones, HALT o un punto de parada
+ Entre puntos ejecuta por tramos como el motor batch. Los puntos con gancho
+ llaman al gancho y siguen si devuelve 0.
+ */
+EmuParada emu_ejecutar(Emu *e, uint64_t max_instrucciones)
+{
+    CPU *cpu = &e->cpu;
+    uint64_t limite = max_instrucciones > UINT64_MAX - cpu->icount ? UINT64_MAX
+                                                                    : cpu->icount + max_instrucciones;
+    uint64_t desde = e->reanudar;
+    AccesoVigilado acceso;
+
+    e->reanudar = UINT64_MAX;
+    for (;;) {
+        MotivoParada motivo = cpu_continuar(cpu, &e->h, limite, desde, &acceso);
+        desde = UINT64_MAX;
+
+        TipoPunto tipo;
+        uint16_t dir;
+        if (motivo == PARADA_BREAKPOINT) {
+            tipo = PUNTO_BREAKPOINT;
+            dir = cpu->pc & (MEM_SIZE - 1);
+        } else if (motivo == PARADA_WATCHPOINT) {
+            tipo = acceso.tipo;
+            dir = acceso.dir;
+        } else {
+            return motivo == PARADA_HALT ? EMU_HALT : EMU_LIMITE;
+        }
+
+        const Gancho *g = &e->ganchos[tipo][dir];
+        int parar = !g->fn || g->fn(e, (EmuPunto)tipo, dir, g->usuario);
+        if (tipo == PUNTO_BREAKPOINT) desde = cpu->icount;
+        if (parar) {
+            e->reanudar = desde;
+            if (!g->fn) return tipo == PUNTO_BREAKPOINT ? EMU_BREAKPOINT : EMU_WATCHPOINT;
+            return EMU_GANCHO;
+        }
+    }
+}
+
+/*
+ emu_paso - Ejecuta una sola instrucción (aunque haya un punto de código en
+ ella; los de memoria sí se atienden)
+ */
+EmuParada emu_paso(Emu *e)
+{
+    e->reanudar = e->cpu.icount;
+    return emu_ejecutar(e, 1);
+}
+
+uint64_t emu_instrucciones(const Emu *e)
+{
+    return e->cpu.icount;
+}
+
+// Ciclos emulados desde la carga (modelo de ciclos de cpu.h)
+uint64_t emu_ciclos(const Emu *e)
+{
+    return e->cpu.ciclos;
+}
+
+/*
+ emu_interrumpir - Pide la línea de interrupción linea (0-7, la 0 es la más
+ prioritaria); se atiende antes de la siguiente instrucción que se ejecute
+ si I = 1. Devuelve -1 si la línea no existe.
+ */
+int emu_interrumpir(Emu *e, unsigned linea)
+{
+    if (linea >= INT_LINEAS) return -1;
+    cpu_interrumpir(&e->cpu, linea);
+    return 0;
+}
+
+/*
+ emu_temporizador - Pide la línea linea cada periodo ciclos emulados,
+ contando desde ahora (periodo 0: lo para). Devuelve -1 si la línea no existe.
+ */
+int emu_temporizador(Emu *e, uint32_t periodo, unsigned linea)
+{
+    if (linea >= INT_LINEAS) return -1;
+    cpu_temporizador(&e->cpu, periodo, linea);
+    return 0;
+}
+
+/*
+ emu_latencias - Ciclos que MUL, DIV y MOD suman a sus accesos en el modelo
+ de ciclos de este emulador (por defecto 4, 12 y 12). Devuelve -1 si alguno
+ pasa de 255.
+ */
+int emu_latencias(Emu *e, unsigned mul, unsigned div, unsigned mod)
+{
+    if (mul > 255 || div > 255 || mod > 255) return -1;
+    e->cpu.ciclos_latencia[16] = (uint8_t)mul;
+    e->cpu.ciclos_latencia[17] = (uint8_t)div;
+    e->cpu.ciclos_latencia[18] = (uint8_t)mod;
+    return 0;
+}
+
+uint16_t emu_registro(const Emu *e, EmuRegistro r)
+{
+    switch (r) {
+    case EMU_ACC: return e->cpu.acc;
+    case EMU_X: return e->cpu.x;
+    case EMU_PC: return e->cpu.pc;
+    case EMU_STATUS: return status_flags(&e->cpu.status);
+    case EMU_SP: return e->cpu.sp;
+    default: return 0;
+    }
+}
+
+void emu_set_registro(Emu *e, EmuRegistro r, uint16_t valor)
+{
+    switch (r) {
+    case EMU_ACC: e->cpu.acc = valor; break;
+    case EMU_X: e->cpu.x = valor; break;
+    case EMU_PC: e->cpu.pc = valor & (MEM_SIZE - 1); break;
+    case EMU_STATUS: set_status_flags(&e->cpu.status, (uint8_t)valor); break;
+    case EMU_SP: e->cpu.sp = valor & (MEM_SIZE - 1); break;
+    default: break;
+    }
+}
+
+/*
+ emu_leer_memoria / emu_escribir_memoria - Copian palabras desde/hacia mem[dir]
+ Devuelven -1 si el rango se sale de la memoria.
+ */
+int emu_leer_memoria(const Emu *e, uint16_t dir, uint16_t *destino, size_t palabras)
+{
+    if (dir > MEM_SIZE || palabras > (size_t)(MEM_SIZE - dir)) return -1;
+    memcpy(destino, &e->cpu.mem[dir], palabras * sizeof(uint16_t));
+    return 0;
+}
+
+int emu_escribir_memoria(Emu *e, uint16_t dir, const uint16_t *origen, size_t palabras)
+{
+    if (dir > MEM_SIZE || palabras > (size_t)(MEM_SIZE - dir)) return -1;
+    memcpy(&e->cpu.mem[dir], origen, palabras * sizeof(uint16_t));
+    if (palabras > 0 && dir + palabras - 1 > e->cpu.mem_hwm) {
+        e->cpu.mem_hwm = (uint16_t)(dir + palabras - 1);
+    }
+    return 0;
+}
+
+/*
+ emu_memoria - Las EMU_MEM_SIZE palabras de la memoria, sin copiar
+ Válido hasta emu_destruir(). Escribir por aquí no actualiza la marca de agua.
+ */
+uint16_t *emu_memoria(Emu *e)
+{
+    return e->cpu.mem;
+}
+
+/*
+ emu_poner_punto - Define un punto de código o de memoria en dir
+ gancho Función a la que llamar al alcanzarlo, o NULL para que la
+        ejecución pare con EMU_BREAKPOINT/EMU_WATCHPOINT
+
+ Sustituye al punto que hubiera del mismo tipo en dir. Devuelve -1 si dir
+ está fuera de la memoria o no hay memoria para los mapas.
+ */
+int emu_poner_punto(Emu *e, EmuPunto tipo, uint16_t dir, EmuGancho gancho, void *usuario)
+{
+    if ((unsigned)tipo >= NUM_TIPOS_PUNTO || dir >= MEM_SIZE) return -1;
+    if (!e->h.puntos && !(e->h.puntos = puntos_crear())) return -1;
+    if (!e->ganchos && !(e->ganchos = calloc(NUM_TIPOS_PUNTO, sizeof(*e->ganchos)))) return -1;
+
+    if (puntos_poner(e->h.puntos, TIPO_PUNTO(tipo), dir, NULL) < 0) return -1;
+    e->ganchos[tipo][dir].fn = gancho;
+    e->ganchos[tipo][dir].usuario = usuario;
+    return 0;
+}
+
+// Devuelve -1 si no había un punto de ese tipo en dir
+int emu_quitar_punto(Emu *e, EmuPunto tipo, uint16_t dir)
+{
+    if ((unsigned)tipo >= NUM_TIPOS_PUNTO || !e->h.puntos) return -1;
+    if (puntos_quitar(e->h.puntos, TIPO_PUNTO(tipo), dir) < 0) return -1;
+    e->ganchos[tipo][dir].fn = NULL;
+    e->ganchos[tipo][dir].usuario = NULL;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef LIBEMU_H
+#define LIBEMU_H
+
+/*
+ libemu - El emulador como biblioteca
+
+ Cada Emu es independiente: tiene su propia CPU, sus puntos de parada y sus
+ ganchos, y la biblioteca no tiene estado global ni escribe en stdout. Un
+ proceso puede alojar tantos emuladores como quiera y usarlos desde hilos
+ distintos, siempre que cada Emu lo use un solo hilo a la vez.
+
+ Uso típico:
+
+     Emu *e = emu_crear();
+     emu_cargar(e, imagen, palabras);
+     while (emu_ejecutar(e, 1000000) == EMU_LIMITE) { ... }
+     uint16_t acc = emu_registro(e, EMU_ACC);
+     emu_destruir(e);
+
+ Compilación:
+     gcc -O2 -fPIC -shared libemu.c cpu.c traza.c grabacion.c historial.c puntos.c \
+         -o libemu.so -pthread
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU_MEM_SIZE 4096     // Palabras de 16 bits (igual que MEM_SIZE)
+
+typedef struct Emu Emu;
+
+// Motivo por el que emu_ejecutar() o emu_paso() devolvieron el control
+typedef enum {
+    EMU_LIMITE,               // Se ejecutaron las instrucciones pedidas
+    EMU_HALT,                 // La CPU ejecutó HALT
+    EMU_BREAKPOINT,           // Punto de código sin gancho (antes de ejecutar la instrucción)
+    EMU_WATCHPOINT,           // Punto de memoria sin gancho (después del acceso)
+    EMU_GANCHO,               // Un gancho devolvió distinto de 0
+    EMU_ERROR                 // Argumentos no válidos
+} EmuParada;
+
+typedef enum {
+    EMU_ACC,
+    EMU_X,
+    EMU_PC,
+    EMU_STATUS,               // Flags en los bits TRAZA_FLAG_* (Z=0, N=1, C=2, I=3, V=4, H=5)
+    EMU_SP,
+    EMU_NUM_REGISTROS
+} EmuRegistro;
+
+typedef enum {
+    EMU_PUNTO_CODIGO,         // Antes de ejecutar la instrucción de dir
+    EMU_PUNTO_LECTURA,        // Después de una instrucción que lee mem[dir]
+    EMU_PUNTO_ESCRITURA       // Después de una instrucción que escribe mem[dir]
+} EmuPunto;
+
+/*
+ Gancho en un punto: devuelve 0 para seguir ejecutando o distinto de 0
+ para que emu_ejecutar() vuelva con EMU_GANCHO. Puede leer y modificar el
+ emulador (registros, memoria, otros puntos).
+ */
+typedef int (*EmuGancho)(Emu *emu, EmuPunto tipo, uint16_t dir, void *usuario);
+
+Emu *emu_crear(void);
+void emu_destruir(Emu *emu);
+void emu_reiniciar(Emu *emu);
+
+int emu_cargar(Emu *emu, const uint16_t *imagen, size_t palabras);
+
+EmuParada emu_ejecutar(Emu *emu, uint64_t max_instrucciones);
+EmuParada emu_paso(Emu *emu);
+uint64_t emu_instrucciones(const Emu *emu);
+uint64_t emu_ciclos(const Emu *emu);
+int emu_interrumpir(Emu *emu, unsigned linea);
+int emu_temporizador(Emu *emu, uint32_t periodo, unsigned linea);
+int emu_latencias(Emu *emu, unsigned mul, unsigned div, unsigned mod);
+
+uint16_t emu_registro(const Emu *emu, EmuRegistro r);
+void emu_set_registro(Emu *emu, EmuRegistro r, uint16_t valor);
+int emu_leer_memoria(const Emu *emu, uint16_t dir, uint16_t *destino, size_t palabras);
+int emu_escribir_memoria(Emu *emu, uint16_t dir, const uint16_t *origen, size_t palabras);
+uint16_t *emu_memoria(Emu *emu);
+
+int emu_poner_punto(Emu *emu, EmuPunto tipo, uint16_t dir, EmuGancho gancho, void *usuario);
+int emu_quitar_punto(Emu *emu, EmuPunto tipo, uint16_t dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
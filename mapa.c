@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapa.h"
+
+
+// Parte s en el tabulador siguiente: termina el campo y devuelve el resto
+static char *campo(char **s)
+{
+    char *inicio = *s;
+    char *tab = strchr(inicio, '\t');
+    if (tab) {
+        *tab = '\0';
+        *s = tab + 1;
+    } else {
+        *s = inicio + strlen(inicio);
+    }
+    return inicio;
+}
+
+static void liberar(MapaFuente *m)
+{
+    free(m->contenido);
+    free(m->ubicaciones);
+    free(m);
+}
+
+/*
+ mapa_cargar - Lee un mapa de fuente generado con "ensamblador -g"
+ Las entradas apuntan al propio contenido del archivo (cada campo se
+ termina en su sitio) y las ubicaciones se formatean aquí, una sola vez.
+
+ Devuelve NULL (tras avisar) si no se puede leer o no es un mapa.
+ */
+MapaFuente *mapa_cargar(const char *ruta)
+{
+    FILE *f = fopen(ruta, "rb");
+    if (!f) {
+        printf("Error: No se pudo abrir el mapa de fuente %s\n", ruta);
+        return NULL;
+    }
+    MapaFuente *m = calloc(1, sizeof(MapaFuente));
+    long len = -1;
+    if (m && fseek(f, 0, SEEK_END) == 0) len = ftell(f);
+    rewind(f);
+    if (m && len >= 0 && (m->contenido = malloc((size_t)len + 1)) &&
+        fread(m->contenido, 1, (size_t)len, f) == (size_t)len) {
+        m->contenido[len] = '\0';
+    } else {
+        len = -1;
+    }
+    fclose(f);
+    if (len < 0) {
+        printf("Error: No se pudo leer el mapa de fuente %s\n", ruta);
+        if (m) liberar(m);
+        return NULL;
+    }
+
+    // Cabecera: MAPA1 <tab> archivo
+    char *linea = m->contenido;
+    char *siguiente = strchr(linea, '\n');
+    if (siguiente) *siguiente++ = '\0';
+    linea[strcspn(linea, "\r")] = '\0';
+    if (strcmp(campo(&linea), MAPA_MAGIA) != 0) {
+        printf("Error: %s no es un mapa de fuente\n", ruta);
+        liberar(m);
+        return NULL;
+    }
+    m->archivo = linea;
+
+    // dirección <tab> línea <tab> etiqueta <tab> texto
+    size_t espacio = 0;
+    while ((linea = siguiente)) {
+        siguiente = strchr(linea, '\n');
+        if (siguiente) *siguiente++ = '\0';
+        linea[strcspn(linea, "\r")] = '\0';
+        if (*linea == '\0') continue;
+
+        unsigned long dir = strtoul(campo(&linea), NULL, 10);
+        unsigned long num = strtoul(campo(&linea), NULL, 10);
+        char *etiqueta = campo(&linea);
+        if (dir >= MEM_SIZE) continue;
+
+        EntradaMapa *e = &m->entradas[dir];
+        e->linea = (uint32_t)num;
+        e->etiqueta = strcmp(etiqueta, "-") ? etiqueta : NULL;
+        e->texto = linea;
+        espacio += strlen(m->archivo) + strlen(e->texto) + 16;
+    }
+
+    // "archivo:línea texto" de cada entrada, todas en un mismo bloque
+    char *p = m->ubicaciones = malloc(espacio + 1);
+    if (!p) {
+        printf("Error: sin memoria para el mapa de fuente %s\n", ruta);
+        liberar(m);
+        return NULL;
+    }
+    for (int i = 0; i < MEM_SIZE; i++) {
+        EntradaMapa *e = &m->entradas[i];
+        if (!e->texto) continue;
+        e->ubicacion = p;
+        p += sprintf(p, "%s:%u %s", m->archivo, e->linea, e->texto) + 1;
+    }
+    return m;
+}
+
+void mapa_destruir(MapaFuente *m)
+{
+    if (m) liberar(m);
+}
@@ -0,0 +1,55 @@
+#ifndef MAPA_H
+#define MAPA_H
+
+/*
+ Mapa de fuente: de cada dirección de memoria a la línea del .asm que la generó
+
+ Lo escribe el ensamblador nativo con -g (programa.map junto a la imagen)
+ y lo cargan el emulador y el analizador para mostrar
+ "suma_v1.asm:3 ADD ACC,[7]" en lugar de la palabra en hexadecimal.
+
+ Formato (texto, campos separados por tabuladores):
+     MAPA1 <tab> archivo.asm
+     dirección <tab> línea <tab> etiqueta <tab> texto
+ Una línea por palabra de código o de datos. La etiqueta es la última
+ definida antes de la instrucción con su desplazamiento ("bucle+2"), o "-".
+
+ Se carga una sola vez en una tabla indexada por dirección con la ubicación
+ ya formateada, así que consultarla cuesta lo mismo que leer mem[dir].
+ */
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define MAPA_MAGIA "MAPA1"
+
+/*
+ Origen de una dirección; texto == NULL si el mapa no dice nada de ella
+ ubicacion: "archivo:línea texto", lista para imprimir
+ etiqueta: "bucle+2", o NULL
+ */
+typedef struct {
+    const char *ubicacion;
+    const char *texto;
+    const char *etiqueta;
+    uint32_t linea;
+} EntradaMapa;
+
+struct MapaFuente {
+    const char *archivo;
+    EntradaMapa entradas[MEM_SIZE];
+    char *contenido;              // El archivo leído: textos y etiquetas
+    char *ubicaciones;
+};
+
+MapaFuente *mapa_cargar(const char *ruta);
+void mapa_destruir(MapaFuente *m);
+
+// Ubicación de dir en el fuente, o NULL si no hay mapa o no está en él
+static inline const char *mapa_ubicacion(const MapaFuente *m, uint16_t dir)
+{
+    return m ? m->entradas[dir & (MEM_SIZE - 1)].ubicacion : NULL;
+}
+
+#endif
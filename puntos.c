@@ -0,0 +1,341 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "puntos.h"
+
+
+// PUNTOS DE PARADA
+// ================
+
+PuntosParada *puntos_crear(void)
+{
+    return calloc(1, sizeof(PuntosParada));
+}
+
+void puntos_destruir(PuntosParada *p)
+{
+    if (!p) return;
+    for (int t = 0; t < NUM_TIPOS_PUNTO; t++) {
+        for (int i = 0; i < MEM_SIZE; i++) free(p->condicion[t][i]);
+    }
+    free(p);
+}
+
+/*
+ puntos_poner - Define (o redefine) un punto de parada
+ tipo PUNTO_BREAKPOINT (dir = PC) o un watchpoint (dir = palabra de memoria)
+ condicion Expresión que debe cumplirse para parar, o NULL
+
+ Devuelve -1 (tras avisar) si la dirección o la condición no son válidas.
+ */
+int puntos_poner(PuntosParada *p, TipoPunto tipo, uint16_t dir, const char *condicion)
+{
+    Condicion *c = NULL;
+    if (dir >= MEM_SIZE) {
+        printf("Error: dirección %u fuera de la memoria\n", dir);
+        return -1;
+    }
+    if (condicion) {
+        const char *error;
+        if (!(c = condicion_compilar(condicion, &error))) {
+            printf("Error en la condición \"%s\": %s\n", condicion, error);
+            return -1;
+        }
+    }
+
+    if (!punto_bit(p, tipo, dir)) p->activos++;
+    p->mapa[tipo][dir >> 6] |= 1ull << (dir & 63);
+    free(p->condicion[tipo][dir]);
+    p->condicion[tipo][dir] = c;
+    return 0;
+}
+
+/*
+ puntos_definir - Define un punto de parada a partir de texto: "DIR [si COND]"
+ (también vale "if" en lugar de "si"). Lo usan -b/-w y los comandos del depurador.
+ */
+int puntos_definir(PuntosParada *p, TipoPunto tipo, const char *texto)
+{
+    char *fin;
+    unsigned long dir = strtoul(texto, &fin, 0);
+    if (fin == texto) {
+        printf("Error: falta la dirección en \"%s\"\n", texto);
+        return -1;
+    }
+    while (isspace((unsigned char)*fin)) fin++;
+    if (*fin == '\0') return puntos_poner(p, tipo, (uint16_t)(dir < MEM_SIZE ? dir : MEM_SIZE), NULL);
+
+    if ((strncmp(fin, "si", 2) != 0 && strncmp(fin, "if", 2) != 0) || !isspace((unsigned char)fin[2])) {
+        printf("Error: se esperaba \"si <condición>\" en \"%s\"\n", texto);
+        return -1;
+    }
+    return puntos_poner(p, tipo, (uint16_t)(dir < MEM_SIZE ? dir : MEM_SIZE), fin + 3);
+}
+
+/*
+ puntos_quitar - Borra un punto de parada. Devuelve -1 si no existía.
+ */
+int puntos_quitar(PuntosParada *p, TipoPunto tipo, uint16_t dir)
+{
+    if (dir >= MEM_SIZE || !punto_bit(p, tipo, dir)) return -1;
+    p->activos--;
+    p->mapa[tipo][dir >> 6] &= ~(1ull << (dir & 63));
+    free(p->condicion[tipo][dir]);
+    p->condicion[tipo][dir] = NULL;
+    return 0;
+}
+
+void puntos_listar(const PuntosParada *p)
+{
+    static const char *nombres[NUM_TIPOS_PUNTO] = {"breakpoint", "watch lectura", "watch escritura"};
+    if (!p->activos) {
+        printf("Sin puntos de parada\n");
+        return;
+    }
+    for (int t = 0; t < NUM_TIPOS_PUNTO; t++) {
+        for (int w = 0; w < MEM_SIZE / 64; w++) {
+            // Solo se visitan las palabras del mapa con algún bit activo
+            for (uint64_t bits = p->mapa[t][w]; bits; bits &= bits - 1) {
+                int dir = w * 64 + __builtin_ctzll(bits);
+                const Condicion *c = p->condicion[t][dir];
+                printf("  %-15s %4d%s%s\n", nombres[t], dir, c ? "  si " : "", c ? c->texto : "");
+            }
+        }
+    }
+}
+
+
+// CONDICIONES: COMPILADOR
+// =======================
+
+/*
+ Gramática (descenso recursivo, de menor a mayor precedencia):
+   o        := y ('||' y)*
+   y        := compara ('&&' compara)*
+   compara  := suma (('=='|'!='|'<'|'<='|'>'|'>=') suma)?
+   suma     := unario (('+'|'-') unario)*
+   unario   := '!' unario | primario
+   primario := número | ACC | X | PC | SP | Z | N | C | V | mem '[' o ']' | '(' o ')'
+ Los números admiten decimal y hexadecimal (0x...). Mayúsculas o minúsculas.
+ */
+typedef struct {
+    const char *p;
+    Condicion *c;
+    int pila;                 // Profundidad de pila en este punto del código
+    int pila_max;
+    const char *error;
+} Compilador;
+
+static void emitir(Compilador *k, OpCondicion op, uint16_t arg, int efecto_pila)
+{
+    if (k->error) return;
+    if (k->c->n == COND_MAX_CODIGO) {
+        k->error = "expresión demasiado larga";
+        return;
+    }
+    k->c->codigo[k->c->n].op = op;
+    k->c->codigo[k->c->n].arg = arg;
+    k->c->n++;
+    k->pila += efecto_pila;
+    if (k->pila > k->pila_max) k->pila_max = k->pila;
+}
+
+static void saltar_espacios(Compilador *k)
+{
+    while (isspace((unsigned char)*k->p)) k->p++;
+}
+
+// Consume el símbolo s si es lo siguiente en la entrada
+static int aceptar(Compilador *k, const char *s)
+{
+    saltar_espacios(k);
+    size_t n = strlen(s);
+    if (strncmp(k->p, s, n) != 0) return 0;
+    // Un nombre no puede ir pegado a más letras ("X" no acepta "XY")
+    if (isalpha((unsigned char)s[n - 1]) && isalnum((unsigned char)k->p[n])) return 0;
+    k->p += n;
+    return 1;
+}
+
+static int aceptar_nombre(Compilador *k, const char *mayus, const char *minus)
+{
+    return aceptar(k, mayus) || aceptar(k, minus);
+}
+
+static void compilar_o(Compilador *k);
+
+static void compilar_primario(Compilador *k)
+{
+    saltar_espacios(k);
+    if (isdigit((unsigned char)*k->p)) {
+        char *fin;
+        unsigned long v = strtoul(k->p, &fin, 0);
+        if (v > 0xFFFF) k->error = "número mayor que 16 bits";
+        k->p = fin;
+        emitir(k, COND_NUM, (uint16_t)v, 1);
+    } else if (aceptar_nombre(k, "ACC", "acc")) {
+        emitir(k, COND_ACC, 0, 1);
+    } else if (aceptar_nombre(k, "PC", "pc")) {
+        emitir(k, COND_PC, 0, 1);
+    } else if (aceptar_nombre(k, "SP", "sp")) {
+        emitir(k, COND_SP, 0, 1);
+    } else if (aceptar_nombre(k, "X", "x")) {
+        emitir(k, COND_X, 0, 1);
+    } else if (aceptar_nombre(k, "Z", "z")) {
+        emitir(k, COND_FLAG, TRAZA_FLAG_Z, 1);
+    } else if (aceptar_nombre(k, "N", "n")) {
+        emitir(k, COND_FLAG, TRAZA_FLAG_N, 1);
+    } else if (aceptar_nombre(k, "C", "c")) {
+        emitir(k, COND_FLAG, TRAZA_FLAG_C, 1);
+    } else if (aceptar_nombre(k, "V", "v")) {
+        emitir(k, COND_FLAG, TRAZA_FLAG_V, 1);
+    } else if (aceptar_nombre(k, "MEM", "mem")) {
+        if (!aceptar(k, "[")) {
+            k->error = "falta '[' después de mem";
+            return;
+        }
+        compilar_o(k);
+        if (!aceptar(k, "]")) k->error = "falta ']'";
+        emitir(k, COND_MEM, 0, 0);
+    } else if (aceptar(k, "(")) {
+        compilar_o(k);
+        if (!aceptar(k, ")")) k->error = "falta ')'";
+    } else {
+        k->error = "se esperaba un número, registro, flag o mem[...]";
+    }
+}
+
+static void compilar_unario(Compilador *k)
+{
+    if (aceptar(k, "!")) {
+        compilar_unario(k);
+        emitir(k, COND_NO, 0, 0);
+    } else {
+        compilar_primario(k);
+    }
+}
+
+static void compilar_suma(Compilador *k)
+{
+    compilar_unario(k);
+    while (!k->error) {
+        if (aceptar(k, "+")) {
+            compilar_unario(k);
+            emitir(k, COND_SUMA, 0, -1);
+        } else if (aceptar(k, "-")) {
+            compilar_unario(k);
+            emitir(k, COND_RESTA, 0, -1);
+        } else {
+            break;
+        }
+    }
+}
+
+static void compilar_compara(Compilador *k)
+{
+    // Los de dos caracteres antes que sus prefijos ("<=" antes que "<")
+    static const struct { const char *s; OpCondicion op; } ops[] = {
+        {"==", COND_IGUAL}, {"!=", COND_DISTINTO}, {"<=", COND_MENOR_IGUAL},
+        {">=", COND_MAYOR_IGUAL}, {"<", COND_MENOR}, {">", COND_MAYOR}
+    };
+    compilar_suma(k);
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (aceptar(k, ops[i].s)) {
+            compilar_suma(k);
+            emitir(k, ops[i].op, 0, -1);
+            return;
+        }
+    }
+}
+
+static void compilar_y(Compilador *k)
+{
+    compilar_compara(k);
+    while (!k->error && aceptar(k, "&&")) {
+        compilar_compara(k);
+        emitir(k, COND_Y, 0, -1);
+    }
+}
+
+static void compilar_o(Compilador *k)
+{
+    compilar_y(k);
+    while (!k->error && aceptar(k, "||")) {
+        compilar_y(k);
+        emitir(k, COND_O, 0, -1);
+    }
+}
+
+/*
+ condicion_compilar - Traduce una expresión a bytecode
+ Devuelve NULL y un mensaje en *error si la expresión no es válida.
+ */
+Condicion *condicion_compilar(const char *texto, const char **error)
+{
+    Condicion *c = calloc(1, sizeof(Condicion));
+    if (!c) {
+        *error = "sin memoria";
+        return NULL;
+    }
+    Compilador k = {texto, c, 0, 0, NULL};
+
+    compilar_o(&k);
+    saltar_espacios(&k);
+    if (!k.error && *k.p) k.error = "texto sobrante al final";
+    if (!k.error && k.pila_max > COND_MAX_PILA) k.error = "expresión demasiado anidada";
+    if (k.error) {
+        *error = k.error;
+        free(c);
+        return NULL;
+    }
+    snprintf(c->texto, sizeof(c->texto), "%s", texto);
+    return c;
+}
+
+
+// CONDICIONES: EVALUACIÓN
+// =======================
+
+/*
+ condicion_evaluar - Ejecuta el bytecode sobre el estado de la CPU
+ Devuelve 1 si el resultado es distinto de 0. La profundidad de pila ya se
+ comprobó al compilar.
+ */
+int condicion_evaluar(const Condicion *c, const CPU *cpu)
+{
+    uint32_t pila[COND_MAX_PILA];
+    int sp = 0;
+
+    for (int i = 0; i < c->n; i++) {
+        const InstrCondicion *ins = &c->codigo[i];
+        uint32_t b;
+        switch (ins->op) {
+        case COND_NUM:  pila[sp++] = ins->arg; break;
+        case COND_ACC:  pila[sp++] = cpu->acc; break;
+        case COND_X:    pila[sp++] = cpu->x; break;
+        case COND_PC:   pila[sp++] = cpu->pc; break;
+        case COND_SP:   pila[sp++] = cpu->sp; break;
+        case COND_FLAG: pila[sp++] = (status_flags(&cpu->status) & ins->arg) != 0; break;
+        case COND_MEM:  pila[sp - 1] = cpu->mem[pila[sp - 1] & (MEM_SIZE - 1)]; break;
+        case COND_NO:   pila[sp - 1] = !pila[sp - 1]; break;
+        default:
+            b = pila[--sp];
+            uint32_t *a = &pila[sp - 1];
+            switch (ins->op) {
+            case COND_SUMA:         *a = (*a + b) & 0xFFFF; break;
+            case COND_RESTA:        *a = (*a - b) & 0xFFFF; break;
+            case COND_IGUAL:        *a = *a == b; break;
+            case COND_DISTINTO:     *a = *a != b; break;
+            case COND_MENOR:        *a = *a < b; break;
+            case COND_MENOR_IGUAL:  *a = *a <= b; break;
+            case COND_MAYOR:        *a = *a > b; break;
+            case COND_MAYOR_IGUAL:  *a = *a >= b; break;
+            case COND_Y:            *a = *a && b; break;
+            case COND_O:            *a = *a || b; break;
+            }
+        }
+    }
+    return pila[0] != 0;
+}
@@ -0,0 +1,176 @@
+#ifndef PUNTOS_H
+#define PUNTOS_H
+
+/*
+ Puntos de parada del depurador: breakpoints y watchpoints
+
+ Cada tipo de punto es un mapa de bits con un bit por dirección, así que
+ comprobar si una instrucción debe parar cuesta leer un bit, haya uno o mil
+ puntos definidos. Cada punto puede llevar una condición (p. ej.
+ "ACC == 0x6" o "mem[12] != 0") que se compila a un bytecode de pila y solo
+ se evalúa cuando el bit está activo.
+
+ - Breakpoint: para antes de ejecutar la instrucción de esa dirección
+ - Watchpoint de lectura/escritura: para después de ejecutar una
+   instrucción que lee/escribe esa palabra de memoria
+
+ Sin puntos definidos (activos == 0) los motores usan su bucle sin comprobaciones.
+ */
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define COND_MAX_CODIGO 32    // Operaciones por condición
+#define COND_MAX_PILA 8       // Profundidad de pila al evaluar
+#define COND_MAX_TEXTO 64
+
+// Operaciones del bytecode de condiciones
+typedef enum {
+    COND_NUM,                 // Apila arg
+    COND_ACC, COND_X, COND_PC, COND_SP,
+    COND_FLAG,                // Apila el flag de máscara arg (TRAZA_FLAG_*)
+    COND_MEM,                 // Desapila una dirección y apila mem[dirección]
+    COND_SUMA, COND_RESTA,
+    COND_IGUAL, COND_DISTINTO, COND_MENOR, COND_MENOR_IGUAL, COND_MAYOR, COND_MAYOR_IGUAL,
+    COND_Y, COND_O, COND_NO
+} OpCondicion;
+
+typedef struct {
+    uint8_t op;               // OpCondicion
+    uint16_t arg;
+} InstrCondicion;
+
+typedef struct {
+    uint8_t n;
+    InstrCondicion codigo[COND_MAX_CODIGO];
+    char texto[COND_MAX_TEXTO];       // Expresión original, para listarla
+} Condicion;
+
+typedef enum {
+    PUNTO_BREAKPOINT,
+    PUNTO_LECTURA,            // Watchpoint de lectura
+    PUNTO_ESCRITURA,          // Watchpoint de escritura
+    NUM_TIPOS_PUNTO
+} TipoPunto;
+
+struct PuntosParada {
+    uint64_t mapa[NUM_TIPOS_PUNTO][MEM_SIZE / 64];
+    Condicion *condicion[NUM_TIPOS_PUNTO][MEM_SIZE];   // NULL: incondicional
+    unsigned activos;                                  // Puntos definidos en total
+};
+
+/*
+ Acceso a memoria de una instrucción que activó un watchpoint
+ */
+struct AccesoVigilado {
+    TipoPunto tipo;
+    uint16_t dir;
+    uint16_t antes;           // Valor de mem[dir] antes de ejecutar
+};
+
+PuntosParada *puntos_crear(void);
+void puntos_destruir(PuntosParada *p);
+int puntos_poner(PuntosParada *p, TipoPunto tipo, uint16_t dir, const char *condicion);
+int puntos_definir(PuntosParada *p, TipoPunto tipo, const char *texto);
+int puntos_quitar(PuntosParada *p, TipoPunto tipo, uint16_t dir);
+void puntos_listar(const PuntosParada *p);
+
+Condicion *condicion_compilar(const char *texto, const char **error);
+int condicion_evaluar(const Condicion *c, const CPU *cpu);
+
+static inline int punto_bit(const PuntosParada *p, TipoPunto tipo, uint16_t dir)
+{
+    dir &= MEM_SIZE - 1;
+    return (p->mapa[tipo][dir >> 6] >> (dir & 63)) & 1;
+}
+
+static inline int punto_cumple(const PuntosParada *p, TipoPunto tipo, uint16_t dir, const CPU *cpu)
+{
+    const Condicion *c = p->condicion[tipo][dir & (MEM_SIZE - 1)];
+    return !c || condicion_evaluar(c, cpu);
+}
+
+/*
+ punto_rango - Primera dirección de [dir, dir + n) con el bit activo (el
+ bloque da la vuelta al final de la memoria), o -1. Salta de 64 en 64 las
+ palabras del mapa sin ningún punto.
+ */
+static inline int punto_rango(const PuntosParada *p, TipoPunto tipo, uint16_t dir, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        uint16_t d = (dir + i) & (MEM_SIZE - 1);
+        if (!(d & 63) && i + 64 <= n && !p->mapa[tipo][d >> 6]) {
+            i += 63;
+        } else if (punto_bit(p, tipo, d)) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+/*
+ puntos_breakpoint - ¿Hay que parar antes de ejecutar la instrucción de cpu->pc?
+ */
+static inline int puntos_breakpoint(const PuntosParada *p, const CPU *cpu)
+{
+    return punto_bit(p, PUNTO_BREAKPOINT, cpu->pc) && punto_cumple(p, PUNTO_BREAKPOINT, cpu->pc, cpu);
+}
+
+/*
+ puntos_accesos - Antes de ejecutar: ¿la instrucción decodificada toca una
+ palabra vigilada? Rellena a con el primer acceso vigilado. La condición del
+ watchpoint se evalúa después de ejecutar, con punto_cumple.
+
+ Accesos de cada instrucción:
+ - Modos indirectos: leen el puntero mem[cd] o mem[cd + X] (cd es la
+   segunda palabra en formato largo)
+ - LD, ADD y la ALU leen mem[ea]; ST escribe mem[ea] (OPCODES_LEEN_DATO).
+   Con operando inmediato no hay acceso al dato
+ - MOVE y FILL escriben el bloque que empieza en mem[ea]; MOVE lee además
+   el que empieza en la dirección de su registro
+ - JSR y PUSH escriben mem[sp - 1]; POP y RTS leen mem[sp] y RTI además
+   mem[sp + 1]. La entrada en una interrupción no es una instrucción y no
+   se vigila
+ */
+static inline int puntos_accesos(const PuntosParada *p, const CPU *cpu,
+                                 const InstructionContext *ctx, AccesoVigilado *a)
+{
+    uint16_t puntero = (ctx->addr_mode == 3 ? ctx->address + cpu->x : ctx->address) & (MEM_SIZE - 1);
+    unsigned n = instruccion_bloque(ctx->inst_code) ? bloque_palabras(ctx->reg, cpu->acc, cpu->x) : 0;
+    uint16_t origen = ctx->reg ? cpu->acc : cpu->x;
+    int bloque;
+    if ((ctx->addr_mode & 1) && punto_bit(p, PUNTO_LECTURA, puntero)) {
+        a->tipo = PUNTO_LECTURA;
+        a->dir = puntero;
+    } else if (instruccion_apila(ctx->inst_code) && punto_bit(p, PUNTO_ESCRITURA, cpu->sp - 1)) {
+        a->tipo = PUNTO_ESCRITURA;
+        a->dir = cpu->sp - 1;
+    } else if (instruccion_desapila(ctx->inst_code) && punto_bit(p, PUNTO_LECTURA, cpu->sp)) {
+        a->tipo = PUNTO_LECTURA;
+        a->dir = cpu->sp;
+    } else if (ctx->opcode == OP_RTI && instruccion_desapila(ctx->inst_code) &&
+               punto_bit(p, PUNTO_LECTURA, cpu->sp + 1)) {
+        a->tipo = PUNTO_LECTURA;
+        a->dir = cpu->sp + 1;
+    } else if (n && (bloque = punto_rango(p, PUNTO_ESCRITURA, ctx->eff_addr, n)) >= 0) {
+        a->tipo = PUNTO_ESCRITURA;
+        a->dir = (uint16_t)bloque;
+    } else if (n && ctx->opcode == 19 && (bloque = punto_rango(p, PUNTO_LECTURA, origen, n)) >= 0) {
+        a->tipo = PUNTO_LECTURA;
+        a->dir = (uint16_t)bloque;
+    } else if (instruccion_escribe_dato(ctx->inst_code) && punto_bit(p, PUNTO_ESCRITURA, ctx->eff_addr)) {
+        a->tipo = PUNTO_ESCRITURA;
+        a->dir = ctx->eff_addr;
+    } else if (instruccion_lee_dato(ctx->inst_code) && punto_bit(p, PUNTO_LECTURA, ctx->eff_addr)) {
+        a->tipo = PUNTO_LECTURA;
+        a->dir = ctx->eff_addr;
+    } else {
+        return 0;
+    }
+    a->dir &= MEM_SIZE - 1;
+    a->antes = cpu->mem[a->dir];
+    return 1;
+}
+
+#endif
@@ -0,0 +1,533 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "traza.h"
+#include "cpu.h"
+
+#define TRAZA_LOTE_MIN 4096       // Registros: volcar en bloques de al menos 48 KB
+#define TRAZA_ESPERA_NS 100000    // Pausa del escritor cuando hay poco que volcar
+#define TRAZA_MAX_COMPRIMIDO 20   // Bytes máximos de un registro comprimido
+#define LECTOR_BUF (1 << 20)      // Buffer de lectura del LectorTraza
+
+
+static int escribir_todo(int fd, const void *datos, size_t n)
+{
+    const char *p = datos;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+
+// CODIFICACIÓN DELTA
+// ==================
+
+static inline uint8_t *poner_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// Diferencia de 16 bits con signo, en zigzag: valores pequeños de ambos signos ocupan 1 byte
+static inline uint8_t *poner_delta(uint8_t *p, uint16_t nuevo, uint16_t viejo)
+{
+    int32_t d = (int16_t)(uint16_t)(nuevo - viejo);
+    return poner_varint(p, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+}
+
+static inline const uint8_t *leer_varint(const uint8_t *p, uint32_t *v)
+{
+    uint32_t r = 0;
+    int desp = 0;
+    do {
+        r |= (uint32_t)(*p & 0x7F) << desp;
+        desp += 7;
+    } while (*p++ & 0x80 && desp < 35);
+    *v = r;
+    return p;
+}
+
+static inline const uint8_t *leer_delta(const uint8_t *p, uint16_t viejo, uint16_t *nuevo)
+{
+    uint32_t z;
+    p = leer_varint(p, &z);
+    *nuevo = (uint16_t)(viejo + (uint16_t)((z >> 1) ^ -(z & 1)));
+    return p;
+}
+
+static inline void actualizar_estado(EstadoDelta *e, const RegistroTraza *r)
+{
+    e->cache[r->pc].raw = r->raw;
+    e->cache[r->pc].eff_addr = r->eff_addr;
+    e->cache[r->pc].epoca = e->epoca;
+    e->prev = *r;
+    e->indice++;
+}
+
+/*
+ comprimir_registro - Codifica r a partir del estado y lo actualiza
+ Devuelve el final de lo escrito (como mucho TRAZA_MAX_COMPRIMIDO bytes).
+ */
+static uint8_t *comprimir_registro(EstadoDelta *e, uint8_t *p, const RegistroTraza *r, int clave)
+{
+    if (clave) {
+        e->epoca++;
+        *p++ = TC_CLAVE;
+        p = poner_varint(p, r->pc);
+        p = poner_varint(p, r->raw);
+        p = poner_varint(p, r->eff_addr);
+        p = poner_varint(p, r->acc);
+        p = poner_varint(p, r->x);
+        *p++ = r->flags;
+        actualizar_estado(e, r);
+        return p;
+    }
+
+    const RegistroTraza *prev = &e->prev;
+    int vigente = e->cache[r->pc].epoca == e->epoca;
+    uint16_t raw_previsto = vigente ? e->cache[r->pc].raw : 0;
+    uint16_t ea_prevista = vigente ? e->cache[r->pc].eff_addr : 0;
+
+    uint16_t secuencial = (uint16_t)(prev->pc + palabras_instruccion(prev->raw));
+
+    uint8_t *ctrl = p++;
+    *ctrl = 0;
+    if (r->pc != secuencial) {
+        *ctrl |= TC_PC;
+        p = poner_delta(p, r->pc, secuencial);
+    }
+    if (r->raw != raw_previsto) {
+        *ctrl |= TC_RAW;
+        p = poner_varint(p, r->raw);
+    }
+    if (r->eff_addr != ea_prevista) {
+        *ctrl |= TC_EA;
+        p = poner_delta(p, r->eff_addr, ea_prevista);
+    }
+    if (r->acc != prev->acc) {
+        *ctrl |= TC_ACC;
+        p = poner_delta(p, r->acc, prev->acc);
+    }
+    if (r->x != prev->x) {
+        *ctrl |= TC_X;
+        p = poner_delta(p, r->x, prev->x);
+    }
+    if (r->flags != prev->flags) {
+        *ctrl |= TC_FLAGS;
+        *p++ = r->flags;
+    }
+    actualizar_estado(e, r);
+    return p;
+}
+
+/*
+ descomprimir_registro - Inverso de comprimir_registro
+ p apunta al byte de control (que no es TC_FIN). Devuelve el final de lo leído.
+ */
+static const uint8_t *descomprimir_registro(EstadoDelta *e, const uint8_t *p, RegistroTraza *r)
+{
+    uint8_t ctrl = *p++;
+    uint32_t v;
+
+    memset(r, 0, sizeof(*r));
+    if (ctrl & TC_CLAVE) {
+        e->epoca++;
+        p = leer_varint(p, &v); r->pc = (uint16_t)v;
+        p = leer_varint(p, &v); r->raw = (uint16_t)v;
+        p = leer_varint(p, &v); r->eff_addr = (uint16_t)v;
+        p = leer_varint(p, &v); r->acc = (uint16_t)v;
+        p = leer_varint(p, &v); r->x = (uint16_t)v;
+        r->flags = *p++;
+        actualizar_estado(e, r);
+        return p;
+    }
+
+    const RegistroTraza *prev = &e->prev;
+    uint16_t secuencial = (uint16_t)(prev->pc + palabras_instruccion(prev->raw));
+    r->pc = secuencial;
+    if (ctrl & TC_PC) p = leer_delta(p, secuencial, &r->pc);
+
+    int vigente = e->cache[r->pc].epoca == e->epoca;
+    r->raw = vigente ? e->cache[r->pc].raw : 0;
+    r->eff_addr = vigente ? e->cache[r->pc].eff_addr : 0;
+    if (ctrl & TC_RAW) {
+        p = leer_varint(p, &v);
+        r->raw = (uint16_t)v;
+    }
+    if (ctrl & TC_EA) p = leer_delta(p, r->eff_addr, &r->eff_addr);
+
+    r->acc = prev->acc;
+    r->x = prev->x;
+    r->flags = prev->flags;
+    if (ctrl & TC_ACC) p = leer_delta(p, prev->acc, &r->acc);
+    if (ctrl & TC_X) p = leer_delta(p, prev->x, &r->x);
+    if (ctrl & TC_FLAGS) r->flags = *p++;
+    actualizar_estado(e, r);
+    return p;
+}
+
+/*
+ comprimir_lote - Codifica n registros en c->out y anota los fotogramas clave
+ */
+static int comprimir_lote(CompresorTraza *c, const RegistroTraza *regs, uint64_t n)
+{
+    uint8_t *p = c->out;
+    for (uint64_t i = 0; i < n; i++) {
+        int clave = c->estado.indice % c->intervalo == 0;
+        if (clave) {
+            if (c->num_claves == c->cap_claves) {
+                uint64_t cap = c->cap_claves ? c->cap_claves * 2 : 64;
+                EntradaIndice *nuevas = realloc(c->claves, cap * sizeof(EntradaIndice));
+                if (!nuevas) return -1;
+                c->claves = nuevas;
+                c->cap_claves = cap;
+            }
+            c->claves[c->num_claves].indice = c->estado.indice;
+            c->claves[c->num_claves].offset = c->offset + (uint64_t)(p - c->out);
+            c->num_claves++;
+        }
+        p = comprimir_registro(&c->estado, p, &regs[i], clave);
+    }
+    c->usados = (size_t)(p - c->out);
+    return 0;
+}
+
+
+// ESCRITURA
+// =========
+
+/*
+ hilo_escritor - Consumidor: vuelca al archivo los registros publicados
+ Espera a tener un lote grande salvo al terminar o si el buffer se llena.
+ */
+static void *hilo_escritor(void *arg)
+{
+    Traza *t = arg;
+    const struct timespec pausa = {0, TRAZA_ESPERA_NS};
+
+    for (;;) {
+        // terminar se lee antes que cabeza: si vale 1, cabeza ya es la definitiva
+        int fin = atomic_load_explicit(&t->terminar, memory_order_acquire);
+        uint64_t cola = atomic_load_explicit(&t->cola, memory_order_relaxed);
+        uint64_t cabeza = atomic_load_explicit(&t->cabeza, memory_order_acquire);
+        uint64_t pendientes = cabeza - cola;
+
+        if (pendientes == 0 && fin) break;
+        if (pendientes < TRAZA_LOTE_MIN && !fin) {
+            nanosleep(&pausa, NULL);
+            continue;
+        }
+
+        // Tramo contiguo hasta el final del buffer (el resto en la siguiente vuelta)
+        uint64_t inicio = cola & t->mascara;
+        uint64_t n = pendientes < t->capacidad - inicio ? pendientes : t->capacidad - inicio;
+        if (t->comp) {
+            // La compresión se hace aquí, fuera del hilo del emulador
+            CompresorTraza *c = t->comp;
+            if (!t->error && comprimir_lote(c, &t->buf[inicio], n) < 0) {
+                t->error = ENOMEM;
+            }
+            if (!t->error && escribir_todo(t->fd, c->out, c->usados) < 0) {
+                t->error = errno;
+            }
+            c->offset += c->usados;
+        } else if (!t->error && escribir_todo(t->fd, &t->buf[inicio], n * sizeof(RegistroTraza)) < 0) {
+            t->error = errno;
+        }
+        atomic_store_explicit(&t->cola, cola + n, memory_order_release);
+    }
+    return NULL;
+}
+
+/*
+ traza_abrir - Crea el archivo de traza y arranca el hilo escritor
+ ruta Archivo de salida (se trunca)
+ capacidad_log2 Tamaño del buffer circular: 2^capacidad_log2 registros
+ comprimir Si no es 0, usa el formato comprimido con índice de fotogramas clave
+
+ Devuelve NULL si no se pudo crear el archivo o el hilo.
+ */
+Traza *traza_abrir(const char *ruta, unsigned capacidad_log2, int comprimir)
+{
+    Traza *t = calloc(1, sizeof(Traza));
+    if (!t) return NULL;
+
+    t->capacidad = 1ull << capacidad_log2;
+    t->mascara = t->capacidad - 1;
+    t->buf = malloc(t->capacidad * sizeof(RegistroTraza));
+    t->fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (comprimir) {
+        t->comp = calloc(1, sizeof(CompresorTraza));
+        if (t->comp) {
+            t->comp->intervalo = TRAZA_INTERVALO_CLAVE;
+            t->comp->offset = sizeof(CabeceraTraza);
+            t->comp->out = malloc(t->capacidad * TRAZA_MAX_COMPRIMIDO);
+        }
+    }
+    if (!t->buf || t->fd < 0 || (comprimir && (!t->comp || !t->comp->out))) {
+        printf("Error: No se pudo crear la traza %s\n", ruta);
+        goto error;
+    }
+
+    CabeceraTraza cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, comprimir ? TRAZA_MAGIA_COMPRIMIDA : TRAZA_MAGIA, sizeof(cab.magia));
+    cab.version = TRAZA_VERSION;
+    cab.tam_registro = comprimir ? TRAZA_INTERVALO_CLAVE : sizeof(RegistroTraza);
+    if (escribir_todo(t->fd, &cab, sizeof(cab)) < 0) {
+        printf("Error: No se pudo escribir la traza %s\n", ruta);
+        goto error;
+    }
+
+    if (pthread_create(&t->hilo, NULL, hilo_escritor, t) != 0) {
+        printf("Error: No se pudo crear el hilo de la traza\n");
+        goto error;
+    }
+    return t;
+
+error:
+    if (t->fd >= 0) close(t->fd);
+    if (t->comp) free(t->comp->out);
+    free(t->comp);
+    free(t->buf);
+    free(t);
+    return NULL;
+}
+
+/*
+ traza_esperar_hueco - Camino lento de traza_emitir: el buffer está lleno
+ Cede la CPU hasta que el escritor libere sitio.
+ */
+void traza_esperar_hueco(Traza *t)
+{
+    uint64_t h = atomic_load_explicit(&t->cabeza, memory_order_relaxed);
+    t->esperas++;
+    for (;;) {
+        t->cola_cache = atomic_load_explicit(&t->cola, memory_order_acquire);
+        if (h - t->cola_cache < t->capacidad) break;
+        sched_yield();
+    }
+}
+
+/*
+ traza_cerrar - Vuelca lo pendiente, para el hilo y cierra el archivo
+ Devuelve el número de registros escritos.
+ */
+uint64_t traza_cerrar(Traza *t)
+{
+    atomic_store_explicit(&t->terminar, 1, memory_order_release);
+    pthread_join(t->hilo, NULL);
+
+    uint64_t registros = atomic_load(&t->cola);
+    CompresorTraza *c = t->comp;
+    if (c) {
+        // Marca de fin, índice de fotogramas clave y pie
+        uint8_t fin = TC_FIN;
+        PieTraza pie;
+        memset(&pie, 0, sizeof(pie));
+        pie.num_claves = c->num_claves;
+        pie.total = registros;
+        pie.offset_indice = c->offset + 1;
+        memcpy(pie.magia, TRAZA_MAGIA_INDICE, sizeof(pie.magia));
+        if (!t->error && (escribir_todo(t->fd, &fin, 1) < 0 ||
+                          escribir_todo(t->fd, c->claves, c->num_claves * sizeof(EntradaIndice)) < 0 ||
+                          escribir_todo(t->fd, &pie, sizeof(pie)) < 0)) {
+            t->error = errno;
+        }
+        free(c->claves);
+        free(c->out);
+        free(c);
+    }
+    if (t->error) {
+        printf("Error: Traza incompleta: %s\n", strerror(t->error));
+    }
+    close(t->fd);
+    free(t->buf);
+    free(t);
+    return registros;
+}
+
+
+// LECTURA
+// =======
+
+// Rellena el buffer conservando lo no consumido. Devuelve los bytes disponibles.
+static size_t lector_rellenar(LectorTraza *l)
+{
+    size_t quedan = l->fin - l->pos;
+    memmove(l->buf, l->buf + l->pos, quedan);
+    l->offset_buf += l->pos;
+    l->pos = 0;
+    l->fin = quedan;
+    while (l->fin < LECTOR_BUF) {
+        ssize_t r = read(l->fd, l->buf + l->fin, LECTOR_BUF - l->fin);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        l->fin += (size_t)r;
+    }
+    return l->fin;
+}
+
+static int lector_posicionar(LectorTraza *l, uint64_t offset)
+{
+    if (lseek(l->fd, (off_t)offset, SEEK_SET) < 0) return -1;
+    l->pos = l->fin = 0;
+    l->offset_buf = offset;
+    return 0;
+}
+
+/*
+ lector_abrir - Abre una traza en cualquiera de los dos formatos
+ Devuelve NULL (tras avisar) si el archivo no existe o no es una traza.
+ */
+LectorTraza *lector_abrir(const char *ruta)
+{
+    LectorTraza *l = calloc(1, sizeof(LectorTraza));
+    if (!l) return NULL;
+    l->buf = malloc(LECTOR_BUF + TRAZA_MAX_COMPRIMIDO);
+    l->fd = open(ruta, O_RDONLY);
+    if (!l->buf || l->fd < 0) {
+        printf("Error: No se pudo abrir la traza %s\n", ruta);
+        goto error;
+    }
+
+    CabeceraTraza cab;
+    if (read(l->fd, &cab, sizeof(cab)) != sizeof(cab) || cab.version != TRAZA_VERSION) {
+        printf("Error: %s no es una traza válida\n", ruta);
+        goto error;
+    }
+    off_t tam = lseek(l->fd, 0, SEEK_END);
+
+    if (memcmp(cab.magia, TRAZA_MAGIA, sizeof(cab.magia)) == 0) {
+        if (cab.tam_registro != sizeof(RegistroTraza)) {
+            printf("Error: %s no es una traza válida\n", ruta);
+            goto error;
+        }
+        l->total = ((uint64_t)tam - sizeof(cab)) / sizeof(RegistroTraza);
+    } else if (memcmp(cab.magia, TRAZA_MAGIA_COMPRIMIDA, sizeof(cab.magia)) == 0) {
+        l->comprimida = 1;
+        l->estado = calloc(1, sizeof(EstadoDelta));
+        if (!l->estado) goto error;
+
+        // Sin pie (traza interrumpida) se puede leer igual, pero sin saltos rápidos
+        PieTraza pie;
+        l->total = UINT64_MAX;
+        if (tam >= (off_t)(sizeof(cab) + sizeof(pie)) &&
+            pread(l->fd, &pie, sizeof(pie), tam - (off_t)sizeof(pie)) == sizeof(pie) &&
+            memcmp(pie.magia, TRAZA_MAGIA_INDICE, sizeof(pie.magia)) == 0) {
+            size_t bytes = pie.num_claves * sizeof(EntradaIndice);
+            l->claves = malloc(bytes ? bytes : 1);
+            if (l->claves && pread(l->fd, l->claves, bytes, (off_t)pie.offset_indice) == (ssize_t)bytes) {
+                l->num_claves = pie.num_claves;
+                l->total = pie.total;
+            }
+        }
+    } else {
+        printf("Error: %s no es una traza válida\n", ruta);
+        goto error;
+    }
+
+    if (lector_posicionar(l, sizeof(cab)) < 0) goto error;
+    return l;
+
+error:
+    lector_cerrar(l);
+    return NULL;
+}
+
+/*
+ lector_saltar - Coloca el lector para que el siguiente registro sea el número indice
+ En la traza comprimida se va al fotograma clave anterior (búsqueda binaria en
+ el índice) y se decodifica desde ahí. Devuelve -1 si indice está fuera de la traza.
+ */
+int lector_saltar(LectorTraza *l, uint64_t indice)
+{
+    if (indice > l->total) return -1;
+    if (!l->comprimida) {
+        l->siguiente = indice;
+        return lector_posicionar(l, sizeof(CabeceraTraza) + indice * sizeof(RegistroTraza));
+    }
+
+    uint64_t desde = 0, offset = sizeof(CabeceraTraza);
+    uint64_t bajo = 0, alto = l->num_claves;
+    while (bajo < alto) {
+        uint64_t medio = bajo + (alto - bajo) / 2;
+        if (l->claves[medio].indice <= indice) bajo = medio + 1;
+        else alto = medio;
+    }
+    if (bajo > 0) {
+        desde = l->claves[bajo - 1].indice;
+        offset = l->claves[bajo - 1].offset;
+    }
+    if (desde < l->siguiente && l->siguiente <= indice) {
+        desde = l->siguiente;         // Ya estamos más cerca avanzando
+    } else if (lector_posicionar(l, offset) < 0) {
+        return -1;
+    } else {
+        l->siguiente = desde;
+    }
+
+    RegistroTraza r;
+    while (l->siguiente < indice) {
+        if (lector_siguiente(l, &r) <= 0) return -1;
+    }
+    return 0;
+}
+
+/*
+ lector_siguiente - Lee el siguiente registro
+ Devuelve 1 si lo leyó, 0 al final de la traza y -1 si está corrupta.
+ */
+int lector_siguiente(LectorTraza *l, RegistroTraza *r)
+{
+    if (!l->comprimida) {
+        if (l->fin - l->pos < sizeof(RegistroTraza) && lector_rellenar(l) < sizeof(RegistroTraza)) {
+            return 0;
+        }
+        memcpy(r, l->buf + l->pos, sizeof(RegistroTraza));
+        l->pos += sizeof(RegistroTraza);
+        l->siguiente++;
+        return 1;
+    }
+
+    if (l->fin - l->pos < TRAZA_MAX_COMPRIMIDO) {
+        lector_rellenar(l);
+        // Relleno para que un registro truncado no lea fuera del buffer
+        memset(l->buf + l->fin, 0, LECTOR_BUF + TRAZA_MAX_COMPRIMIDO - l->fin);
+    }
+    if (l->pos >= l->fin || l->buf[l->pos] == TC_FIN) return 0;
+    if (l->buf[l->pos] & 0x40) return -1;
+
+    const uint8_t *p = descomprimir_registro(l->estado, l->buf + l->pos, r);
+    l->pos = (size_t)(p - l->buf);
+    if (l->pos > l->fin) return -1;
+    l->siguiente++;
+    return 1;
+}
+
+void lector_cerrar(LectorTraza *l)
+{
+    if (!l) return;
+    if (l->fd >= 0) close(l->fd);
+    free(l->claves);
+    free(l->estado);
+    free(l->buf);
+    free(l);
+}
@@ -0,0 +1,185 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+/*
+ Traza binaria de ejecución
+
+ Cada instrucción ejecutada produce un RegistroTraza de tamaño fijo. El hilo
+ que emula los deja en un buffer circular lock-free de un solo productor y un
+ solo consumidor; un hilo de fondo lo vacía al archivo con escrituras grandes.
+
+ Si el disco no da abasto el productor espera a que haya hueco (no se pierden
+ registros): el coste por instrucción queda acotado a copiar 12 bytes y
+ publicar un índice.
+
+ Formato del archivo: CabeceraTraza seguida de registros, en el orden de
+ bytes del host (little-endian en x86/ARM).
+
+ Formato comprimido (opción -z): el hilo escritor codifica cada registro
+ como diferencia respecto al anterior, fuera del camino crítico:
+ - Un byte de control con un bit por campo presente (TC_*)
+ - PC: solo si no es el anterior + 1, como diferencia
+ - raw y eff_addr: solo si difieren de los vistos la última vez en ese PC
+ - ACC y X: solo si cambiaron, como diferencia; flags: solo si cambiaron
+ Los números van en varint (LEB128, con zigzag para las diferencias).
+ Cada TRAZA_INTERVALO_CLAVE registros hay un fotograma clave con el estado
+ completo que reinicia las predicciones: se puede empezar a decodificar en
+ cualquiera de ellos. Al final, un índice (instrucción, offset) de los
+ fotogramas clave y un PieTraza permiten saltar a cualquier instrucción.
+ */
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define TRAZA_MAGIA "EMUTRZ1"       // 7 caracteres + '\0'
+#define TRAZA_VERSION 1
+
+// Bits del campo flags (mismo orden que la estructura Status)
+#define TRAZA_FLAG_Z 0x01
+#define TRAZA_FLAG_N 0x02
+#define TRAZA_FLAG_C 0x04
+#define TRAZA_FLAG_I 0x08
+#define TRAZA_FLAG_V 0x10
+#define TRAZA_FLAG_H 0x20
+
+#define TRAZA_MAGIA_COMPRIMIDA "EMUTRZC"
+#define TRAZA_MAGIA_INDICE "EMUIDX1"
+#define TRAZA_INTERVALO_CLAVE 65536  // Registros entre fotogramas clave
+
+// Byte de control del formato comprimido: qué campos siguen
+#define TC_PC     0x01            // PC no secuencial (diferencia con el pc que sigue a la anterior)
+#define TC_RAW    0x02            // Palabra distinta de la última vista en este PC
+#define TC_EA     0x04            // eff_addr distinta de la última vista en este PC
+#define TC_ACC    0x08            // ACC cambió
+#define TC_X      0x10            // X cambió
+#define TC_FLAGS  0x20            // Flags cambiaron
+#define TC_CLAVE  0x80            // Fotograma clave: estado completo
+#define TC_FIN    0xC0            // Fin de los registros, sigue el índice
+
+typedef struct {
+    char magia[8];                // TRAZA_MAGIA
+    uint32_t version;             // TRAZA_VERSION
+    uint32_t tam_registro;        // sizeof(RegistroTraza); en la comprimida, el intervalo clave
+} CabeceraTraza;
+
+typedef struct {
+    uint64_t indice;              // Número de instrucción del fotograma clave
+    uint64_t offset;              // Posición en el archivo de su byte de control
+} EntradaIndice;
+
+typedef struct {
+    uint64_t num_claves;          // Entradas del índice
+    uint64_t total;               // Registros en la traza
+    uint64_t offset_indice;       // Posición de la primera EntradaIndice
+    char magia[8];                // TRAZA_MAGIA_INDICE
+} PieTraza;
+
+/*
+ Registro de una instrucción ejecutada (12 bytes)
+ pc: Dirección de la instrucción
+ raw: Palabra de instrucción tal como estaba en memoria
+ eff_addr: Dirección efectiva calculada por fetch_and_decode
+ acc, x: Registros después de ejecutarla
+ flags: Flags después de ejecutarla (TRAZA_FLAG_Z, TRAZA_FLAG_N...)
+ */
+typedef struct {
+    uint16_t pc;
+    uint16_t raw;
+    uint16_t eff_addr;
+    uint16_t acc;
+    uint16_t x;
+    uint8_t flags;
+    uint8_t reservado;
+} RegistroTraza;
+
+/*
+ Estado de predicción compartido por compresor y descompresor
+ cache: última palabra y eff_addr vistas en cada PC; una entrada de otra
+        época (anterior al último fotograma clave) cuenta como 0
+ */
+typedef struct {
+    RegistroTraza prev;
+    uint64_t indice;              // Registros procesados
+    uint32_t epoca;
+    struct {
+        uint16_t raw;
+        uint16_t eff_addr;
+        uint32_t epoca;
+    } cache[1 << 16];
+} EstadoDelta;
+
+typedef struct {
+    EstadoDelta estado;
+    uint32_t intervalo;
+    uint8_t *out;                 // Bytes codificados pendientes de escribir
+    size_t usados;
+    uint64_t offset;              // Bytes ya escritos en el archivo
+    EntradaIndice *claves;
+    uint64_t num_claves;
+    uint64_t cap_claves;
+} CompresorTraza;
+
+/*
+ Estado de una traza abierta. El productor (hilo del emulador) solo escribe
+ cabeza y cola_cache; el consumidor (hilo escritor) solo escribe cola.
+ Cada índice va en su propia línea de caché para no compartirla entre hilos.
+ */
+typedef struct {
+    RegistroTraza *buf;
+    uint64_t capacidad;           // Potencia de 2
+    uint64_t mascara;             // capacidad - 1
+
+    _Alignas(64) _Atomic uint64_t cabeza;   // Siguiente registro a escribir (productor)
+    uint64_t cola_cache;                    // Última cola vista por el productor
+    uint64_t esperas;                       // Veces que el productor encontró el buffer lleno
+
+    _Alignas(64) _Atomic uint64_t cola;     // Siguiente registro a volcar (consumidor)
+    _Atomic int terminar;
+
+    pthread_t hilo;
+    int fd;
+    int error;                    // errno de la primera escritura fallida
+    CompresorTraza *comp;         // NULL: registros sin comprimir
+} Traza;
+
+/*
+ Lector de trazas (ambos formatos) para herramientas offline
+ */
+typedef struct {
+    int fd;
+    int comprimida;
+    uint64_t total;               // Registros en la traza (si se conoce)
+    uint64_t siguiente;           // Índice del próximo registro a leer
+    EntradaIndice *claves;
+    uint64_t num_claves;
+    uint8_t *buf;                 // Buffer de lectura
+    size_t pos, fin;
+    uint64_t offset_buf;          // Posición en el archivo de buf[0]
+    EstadoDelta *estado;
+} LectorTraza;
+
+Traza *traza_abrir(const char *ruta, unsigned capacidad_log2, int comprimir);
+uint64_t traza_cerrar(Traza *t);
+void traza_esperar_hueco(Traza *t);
+
+LectorTraza *lector_abrir(const char *ruta);
+int lector_saltar(LectorTraza *l, uint64_t indice);
+int lector_siguiente(LectorTraza *l, RegistroTraza *r);
+void lector_cerrar(LectorTraza *l);
+
+/*
+ traza_emitir - Añade un registro (solo desde el hilo del emulador)
+ Camino rápido: comprobar hueco con la cola cacheada, copiar y publicar.
+ */
+static inline void traza_emitir(Traza *t, const RegistroTraza *r)
+{
+    uint64_t h = atomic_load_explicit(&t->cabeza, memory_order_relaxed);
+    if (h - t->cola_cache == t->capacidad) {
+        traza_esperar_hueco(t);
+    }
+    t->buf[h & t->mascara] = *r;
+    atomic_store_explicit(&t->cabeza, h + 1, memory_order_release);
+}
+
+#endif